@@ -71,6 +71,8 @@
 #include "ns3/internet-module.h"
 #include "ns3/mobility-module.h"
 #include "ns3/applications-module.h"
+#include "parallel-experiments.h"
+#include "table-error-rate-model.h"
 
 
 using namespace ns3;
@@ -91,6 +93,9 @@ public:
 
                       const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel);
 
+  /// \return the points of the output dataset, as sent back by ParallelExperiments
+  const ParallelExperiments::Points &GetPoints() const { return m_points; }
+
 private:
 
   void ReceivePacket(Ptr<Socket> socket);
@@ -99,8 +104,12 @@ private:
 
   uint32_t m_bytesTotal;
 
+  std::string m_name;
+
   Gnuplot2dDataset m_output;
 
+  ParallelExperiments::Points m_points;
+
 };
 
 Experiment::Experiment()
@@ -111,7 +120,8 @@ Experiment::Experiment()
 
 Experiment::Experiment(std::string name)
 
-  : m_output(name)
+  : m_name(name),
+    m_output(name)
 
 {
 
@@ -216,7 +226,7 @@ Experiment::Run(const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
   }
 
   Ptr<Socket> recvSink = SetupPacketReceive(c.Get(0));
-  AnimationInterface anim("3nodesM.xml");
+  AnimationInterface anim("3nodesM-" + m_name + ".xml");
 
   Simulator::Run();
   Simulator::Destroy();
@@ -224,22 +234,44 @@ Experiment::Run(const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
   return m_output;
 }
 
+/**
+ * Node 0 sends to node 1 and the two others to node 0 at 60 Mb/s while all
+ * three walk at random, and node 0 is metered.
+ */
+static ParallelExperiments::Job
+MakeJob(const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
+        const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel)
+{
+  return [wifi, wifiPhy, wifiMac, wifiChannel](std::string name) {
+    Experiment experiment(name);
+    experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
+    return experiment.GetPoints();
+  };
+}
+
 int main(int argc, char *argv[])
 {
   CommandLine cmd(__FILE__);
+  uint32_t jobs = 0;
+  bool tableErrors = false;
+  cmd.AddValue("jobs", "Experiments run in parallel, 0 for one per core", jobs);
+  cmd.AddValue("tableErrors", "Look chunk success rates up in precomputed SNR tables", tableErrors);
   cmd.Parse(argc, argv);
 
   Gnuplot gnuplot = Gnuplot("reference-rates.png");
 
-  Experiment experiment;
   WifiHelper wifi;
   wifi.SetStandard(WIFI_STANDARD_80211a);
   WifiMacHelper wifiMac;
   YansWifiPhyHelper wifiPhy;
+  if (tableErrors)
+  {
+    wifiPhy.SetErrorRateModel("ns3::TableErrorRateModel");
+  }
   YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default();
-  Gnuplot2dDataset dataset;
 
   wifiMac.SetType("ns3::AdhocWifiMac");
+  ParallelExperiments experiments(jobs);
 
   for (uint32_t i = 0; i < 5; ++i)
   {
@@ -264,13 +296,12 @@ int main(int argc, char *argv[])
     }
 
     std::string rateName = "Rate" + std::to_string(i);
-    experiment = Experiment(rateName);
     wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
                                 "DataMode", StringValue(dataMode));
-    dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-    gnuplot.AddDataset(dataset);
+    experiments.Add(rateName, MakeJob(wifi, wifiPhy, wifiMac, wifiChannel));
   }
 
+  experiments.Run(gnuplot);
   gnuplot.GenerateOutput(std::cout);
 
   gnuplot = Gnuplot("rate-control.png");
@@ -298,12 +329,11 @@ int main(int argc, char *argv[])
     }
 
     std::string rateControlName = "RateControl" + std::to_string(i);
-    experiment = Experiment(rateControlName);
     wifi.SetRemoteStationManager(rateControl);
-    dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-    gnuplot.AddDataset(dataset);
+    experiments.Add(rateControlName, MakeJob(wifi, wifiPhy, wifiMac, wifiChannel));
   }
 
+  experiments.Run(gnuplot);
   gnuplot.GenerateOutput(std::cout);
 
   return 0;
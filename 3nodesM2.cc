@@ -56,8 +56,6 @@
 
 #include "ns3/ipv4-address-helper.h"
 
-#include "ns3/on-off-helper.h"
-
 #include "ns3/yans-wifi-channel.h"
 
 #include "ns3/packet-socket-helper.h"
@@ -71,6 +69,7 @@
 #include "ns3/internet-module.h"
 #include "ns3/mobility-module.h"
 #include "ns3/applications-module.h"
+#include "saturation-source.h"
 
 
 using namespace ns3;
@@ -192,26 +191,24 @@ Experiment::Run(const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
 
   mobility.Install(c);
 
-  // Create On/Off applications for each pair of nodes to communicate with each other
-for (uint32_t i = 0; i < c.GetN(); ++i)
+  // Create a saturation source on each node sending to the nodes after it
+for (uint32_t i = 0; i + 1 < c.GetN(); ++i)
 {
+  Ptr<SaturationSource> source = CreateObject<SaturationSource>();
+  source->SetAttribute("PacketSize", UintegerValue(2000));
   for (uint32_t j = i + 1; j < c.GetN(); ++j)
   {
     PacketSocketAddress socket;
     socket.SetSingleDevice(devices.Get(i)->GetIfIndex());
 
-    // Set the destination address for the On/Off application (other nodes)
+    // Set the destination address of the source (other nodes)
     socket.SetPhysicalAddress(devices.Get(j)->GetAddress());
     socket.SetProtocol(1);
-
-    OnOffHelper onoff("ns3::PacketSocketFactory", Address(socket));
-    onoff.SetConstantRate(DataRate(60000000));
-    onoff.SetAttribute("PacketSize", UintegerValue(2000));
-
-    ApplicationContainer apps = onoff.Install(c.Get(i));
-    apps.Start(Seconds(0.5));
-    apps.Stop(Seconds(250.0));
+    source->AddDestination(socket);
   }
+  c.Get(i)->AddApplication(source);
+  source->SetStartTime(Seconds(0.5));
+  source->SetStopTime(Seconds(250.0));
 }
   Ptr<Socket> recvSink = SetupPacketReceive(c.Get(0));
   AnimationInterface anim("adhoc.xml");
@@ -20,217 +20,67 @@
 
 #include "ns3/gnuplot.h"
 #include "ns3/command-line.h"
-#include "ns3/config.h"
-#include "ns3/uinteger.h"
 #include "ns3/string.h"
 #include "ns3/log.h"
 #include "ns3/yans-wifi-helper.h"
-#include "ns3/mobility-helper.h"
-#include "ns3/ipv4-address-helper.h"
-#include "ns3/on-off-helper.h"
-#include "ns3/yans-wifi-channel.h"
-#include "ns3/mobility-model.h"
-#include "ns3/packet-socket-helper.h"
-#include "ns3/packet-socket-address.h"
-#include "ns3/netanim-module.h"
+#include "experiment-harness.h"
+#include "table-error-rate-model.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("Wifi-Adhoc");
 
 /**
- * WiFi adhoc experiment class.
- * 
- * It handles the creation and run of an experiment.
+ * Node 0 sends to node 4 at 60 Mb/s while the four others walk along x from
+ * 1.5 s, and node 1 is metered from then on.
  */
-class Experiment
+static ParallelExperiments::CurvesJob
+MakeJob (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
+         const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel,
+         uint32_t window)
 {
-public:
-  Experiment ();
-  /**
-   * Constructor.
-   * \param name The name of the experiment.
-   */
-  Experiment (std::string name);
-
-  /**
-   * Run an experiment.
-   * \param wifi      //!< The WifiHelper class.
-   * \param wifiPhy   //!< The YansWifiPhyHelper class.
-   * \param wifiMac   //!< The WifiMacHelper class.
-   * \param wifiChannel //!< The YansWifiChannelHelper class.
-   * \return a 2D dataset of the experiment data. 
-   */
-  Gnuplot2dDataset Run (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
-                        const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel);
-private:
-  /**
-   * Receive a packet.
-   * \param socket The receiving socket.
-   */
-  void ReceivePacket (Ptr<Socket> socket);
-  /**
-   * Set the position of a node.
-   * \param node The node.
-   * \param position The position of the node.
-   */
-  void SetPosition (Ptr<Node> node, Vector position);
-  /**
-   * Get the position of a node.
-   * \param node The node.
-   * \return the position of the node.
-   */
-  Vector GetPosition (Ptr<Node> node);
-  /**
-   * Move a node by 1m on the x-axis, stops at 210m.
-   * \param node The node.
-   */
-  void AdvancePosition (Ptr<Node> node);
-  /**
-   * Setup the receiving socket.
-   * \param node The receiving node.
-   * \return the socket.
-   */
-  Ptr<Socket> SetupPacketReceive (Ptr<Node> node);
-
-  uint32_t m_bytesTotal;      //!< The number of received bytes.
-  Gnuplot2dDataset m_output;  //!< The output dataset.
-};
-
-Experiment::Experiment ()
-{
-}
-
-Experiment::Experiment (std::string name)
-  : m_output (name)
-{
-  m_output.SetStyle (Gnuplot2dDataset::LINES);
-}
-
-void
-Experiment::SetPosition (Ptr<Node> node, Vector position)
-{
-  Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
-  mobility->SetPosition (position);
-}
-
-Vector
-Experiment::GetPosition (Ptr<Node> node)
-{
-  Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
-  return mobility->GetPosition ();
-}
-
-void
-Experiment::AdvancePosition (Ptr<Node> node)
-{
-  Vector pos = GetPosition (node);
-  double mbs = ((m_bytesTotal * 8.0) / 1000000);
-  m_bytesTotal = 0;
-  m_output.Add (pos.x, mbs);
-  pos.x += 1.0;
-  if (pos.x >= 210.0)
-    {
-      return;
-    }
-  SetPosition (node, pos);
-  Simulator::Schedule (Seconds (1.0), &Experiment::AdvancePosition, this, node);
-}
-
-void
-Experiment::ReceivePacket (Ptr<Socket> socket)
-{
-  Ptr<Packet> packet;
-  while ((packet = socket->Recv ()))
-    {
-      m_bytesTotal += packet->GetSize ();
-    }
-}
-
-Ptr<Socket>
-Experiment::SetupPacketReceive (Ptr<Node> node)
-{
-  TypeId tid = TypeId::LookupByName ("ns3::PacketSocketFactory");
-  Ptr<Socket> sink = Socket::CreateSocket (node, tid);
-  sink->Bind ();
-  sink->SetRecvCallback (MakeCallback (&Experiment::ReceivePacket, this));
-  return sink;
-}
-
-Gnuplot2dDataset
-Experiment::Run (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
-                 const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel)
-{
-  m_bytesTotal = 0;
-
-  NodeContainer c;
-  c.Create (5); // Create 5 nodes instead of 2
-
-  PacketSocketHelper packetSocket;
-  packetSocket.Install (c);
-
-  YansWifiPhyHelper phy = wifiPhy;
-  phy.SetChannel (wifiChannel.Create ());
-
-  WifiMacHelper mac = wifiMac;
-  NetDeviceContainer devices = wifi.Install (phy, mac, c);
-
-  MobilityHelper mobility;
-  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
-  // Add positions for 5 nodes
-  positionAlloc->Add (Vector (2.0, 0.0, 3.0));
-  positionAlloc->Add (Vector (5.0, 8.0, 0.0));
-  positionAlloc->Add (Vector (10.0, 5.0, 8.0));
-  positionAlloc->Add (Vector (15.0, 10.0, 6.0));
-  positionAlloc->Add (Vector (20.0, 10.0, 3.0));
-  mobility.SetPositionAllocator (positionAlloc);
-  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-
-  mobility.Install (c);
-
-  PacketSocketAddress socket;
-  socket.SetSingleDevice (devices.Get (0)->GetIfIndex ());
-  socket.SetPhysicalAddress (devices.Get (4)->GetAddress ());
-  socket.SetProtocol (4);
-  
-  OnOffHelper onoff ("ns3::PacketSocketFactory", Address (socket));
-  onoff.SetConstantRate (DataRate (60000000));
-  onoff.SetAttribute ("PacketSize", UintegerValue (2000));
-
-  ApplicationContainer apps = onoff.Install (c.Get (0));
-  apps.Start (Seconds (0.5));
-  apps.Stop (Seconds (250.0));
-
-  // Schedule position advancement for all nodes except the first one
-  for (uint32_t i = 1; i < c.GetN (); ++i) {
-    Simulator::Schedule (Seconds (1.5), &Experiment::AdvancePosition, this, c.Get (i));
-  }
-  Ptr<Socket> recvSink = SetupPacketReceive (c.Get (1));
-  
-  AnimationInterface anim("adhoc.xml");
-  Simulator::Run ();
-
-  Simulator::Destroy ();
-
-  return m_output;
+  std::vector<Vector> positions = {Vector (2.0, 0.0, 3.0), Vector (5.0, 8.0, 0.0),
+                                   Vector (10.0, 5.0, 8.0), Vector (15.0, 10.0, 6.0),
+                                   Vector (20.0, 10.0, 3.0)};
+  TopologyPolicy topology = TopologyPolicy::List (positions);
+  TrafficPolicy traffic = TrafficPolicy::Pair (0, 4);
+  traffic.SetRate (DataRate (60000000));
+  MobilityPolicy mobility = MobilityPolicy::Walk ({1, 2, 3, 4}, 1.0, 210.0);
+  mobility.SetTimes (Seconds (1.5), Seconds (1.0));
+  return [=] (std::string name) {
+    ExperimentHarness harness (name, topology, traffic, mobility);
+    harness.SetReceivers ({1});
+    harness.SetMeter (Seconds (1.0), window, Seconds (1.5), Seconds (211.0));
+    harness.SetAnimation ("adhoc");
+    return harness.Run (wifi, wifiPhy, wifiMac, wifiChannel);
+  };
 }
 
 int main (int argc, char *argv[])
 {
   CommandLine cmd (__FILE__);
+  uint32_t jobs = 0;
+  uint32_t window = 1;
+  bool tableErrors = false;
+  cmd.AddValue ("jobs", "Experiments run in parallel, 0 for one per core", jobs);
+  cmd.AddValue ("tableErrors", "Look chunk success rates up in precomputed SNR tables", tableErrors);
+  cmd.AddValue ("window", "Seconds each throughput sample averages over", window);
   cmd.Parse (argc, argv);
 
   Gnuplot gnuplot = Gnuplot ("reference-rates.png");
 
-  Experiment experiment;
   WifiHelper wifi;
   wifi.SetStandard (WIFI_STANDARD_80211a);
   WifiMacHelper wifiMac;
   YansWifiPhyHelper wifiPhy;
+  if (tableErrors)
+    {
+      wifiPhy.SetErrorRateModel ("ns3::TableErrorRateModel");
+    }
   YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
-  Gnuplot2dDataset dataset;
 
   wifiMac.SetType ("ns3::AdhocWifiMac");
+  ParallelExperiments experiments (jobs);
 
   for (uint32_t i = 0; i < 5; ++i) {
     std::string dataMode;
@@ -243,13 +93,12 @@ int main (int argc, char *argv[])
       // Add more cases if needed
     }
     std::string rateName = "Rate" + std::to_string(i);
-    experiment = Experiment (rateName);
     wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                   "DataMode", StringValue (dataMode));
-    dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-    gnuplot.AddDataset (dataset);
+    experiments.AddCurves (rateName, MakeJob (wifi, wifiPhy, wifiMac, wifiChannel, window));
   }
 
+  experiments.Run (gnuplot);
   gnuplot.GenerateOutput (std::cout);
 
   gnuplot = Gnuplot ("rate-control.png");
@@ -265,12 +114,11 @@ int main (int argc, char *argv[])
       // Add more cases if needed
     }
     std::string rateControlName = "RateControl" + std::to_string(i);
-    experiment = Experiment (rateControlName);
     wifi.SetRemoteStationManager (rateControl);
-    dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-    gnuplot.AddDataset (dataset);
+    experiments.AddCurves (rateControlName, MakeJob (wifi, wifiPhy, wifiMac, wifiChannel, window));
   }
 
+  experiments.Run (gnuplot);
   gnuplot.GenerateOutput (std::cout);
 
   return 0;
@@ -0,0 +1,335 @@
+#include "cosim-bridge.h"
+#include "node-pool.h"
+#include "ns3/abort.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace ns3
+{
+  NS_LOG_COMPONENT_DEFINE ("CosimBridge");
+
+  namespace
+  {
+    double
+    Since (std::chrono::steady_clock::time_point start)
+    {
+      return std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+    }
+  }
+
+  CosimBridge::CosimBridge (NodeContainer nodes, Time step, bool pipelined)
+    : m_nodes (nodes),
+      m_step (step),
+      m_pipelined (pipelined),
+      m_stop (0),
+      m_fd (-1),
+      m_server (0),
+      m_steps (0),
+      m_vehicles (0)
+  {
+    NS_ABORT_MSG_IF (!m_step.IsStrictlyPositive (), "The co-simulation step must be positive");
+    m_slots.resize (m_nodes.GetN ());
+    for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+      {
+        Ptr<Node> node = m_nodes.Get (i);
+        if (!node->GetObject<MobilityModel> ())
+          {
+            node->AggregateObject (CreateObject<ConstantVelocityMobilityModel> ());
+          }
+        NS_ABORT_MSG_IF (!node->GetObject<ConstantVelocityMobilityModel> (), "Node " << node->GetId () << " already has a mobility model that is not ConstantVelocity");
+        m_slots[i].used = false;
+        m_slot_of_node[node->GetId ()] = i;
+        // the first free slots are taken first
+        m_free.push_back (m_nodes.GetN () - 1 - i);
+      }
+  }
+
+  CosimBridge::~CosimBridge ()
+  {
+    Close ();
+  }
+
+  void
+  CosimBridge::Connect (std::string path)
+  {
+    NS_ABORT_MSG_IF (m_fd >= 0, "The bridge is already connected");
+    struct sockaddr_un address;
+    NS_ABORT_MSG_IF (path.size () >= sizeof (address.sun_path), "Socket path too long: " << path);
+    std::memset (&address, 0, sizeof (address));
+    address.sun_family = AF_UNIX;
+    std::strncpy (address.sun_path, path.c_str (), sizeof (address.sun_path) - 1);
+    m_fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    NS_ABORT_MSG_IF (m_fd < 0, "Cannot create a socket");
+    NS_ABORT_MSG_IF (connect (m_fd, reinterpret_cast<struct sockaddr *> (&address), sizeof (address)) != 0,
+                     "Cannot connect to the traffic simulator at " << path);
+  }
+
+  void
+  CosimBridge::SpawnServer (StandInMobilityServer::Config config)
+  {
+    NS_ABORT_MSG_IF (m_fd >= 0, "The bridge is already connected");
+    int fds[2];
+    NS_ABORT_MSG_IF (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) != 0, "Cannot create a socket pair");
+    pid_t pid = fork ();
+    NS_ABORT_MSG_IF (pid < 0, "Cannot fork the mobility server");
+    if (pid == 0)
+      {
+        close (fds[0]);
+        StandInMobilityServer server (config);
+        server.Serve (fds[1]);
+        _exit (0);
+      }
+    close (fds[1]);
+    m_fd = fds[0];
+    m_server = pid;
+  }
+
+  void
+  CosimBridge::Start (Time stop)
+  {
+    NS_ABORT_MSG_IF (m_fd < 0, "Connect the bridge or spawn a server first");
+    m_stop = stop.GetSeconds ();
+    for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+      {
+        // after the nodes are initialized, before the first step
+        Simulator::Schedule (Seconds (0), &NodePool::Park, m_nodes.Get (i));
+      }
+    m_records.push_back (StepRecord ());
+    if (m_pipelined)
+      {
+        // the traffic simulator computes time 0 while ns-3 starts
+        Request (0, m_records.back ());
+      }
+    Simulator::Schedule (Seconds (0), &CosimBridge::Step, this);
+    m_resumed = std::chrono::steady_clock::now ();
+  }
+
+  void
+  CosimBridge::Request (double time, StepRecord &record)
+  {
+    cosim::Message request (cosim::STEP);
+    request.Put (time);
+    request.Put (uint32_t (m_commands.size ()));
+    for (const cosim::SpeedCommand &command : m_commands)
+      {
+        request.Put (command.vehicle);
+        request.Put (command.speed);
+        request.Put (command.duration);
+      }
+    record.commands += m_commands.size ();
+    record.bytes_sent += request.GetSize ();
+    m_commands.clear ();
+    NS_ABORT_MSG_IF (!request.Send (m_fd), "The traffic simulator went away");
+  }
+
+  void
+  CosimBridge::Step ()
+  {
+    double now = Simulator::Now ().GetSeconds ();
+    size_t current = m_records.size () - 1;
+    StepRecord &record = m_records[current];
+    record.time = now;
+    record.simulate = Since (m_resumed);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+    if (!m_pipelined)
+      {
+        Request (now, record);
+      }
+    NS_ABORT_MSG_IF (!m_reader.Receive (m_fd) || m_reader.GetCommand () != cosim::STATE,
+                     "The traffic simulator went away");
+    record.wait = Since (start);
+    record.bytes_received = m_reader.GetSize ();
+
+    start = std::chrono::steady_clock::now ();
+    double time;
+    uint32_t n;
+    NS_ABORT_MSG_IF (!m_reader.Get (time) || !m_reader.Get (n), "Malformed message from the traffic simulator");
+    // before anything is allocated for them, the vehicles must fill the rest of the message exactly
+    NS_ABORT_MSG_IF (m_reader.GetRemaining () != uint64_t (n) * (sizeof (uint32_t) + 4 * sizeof (double)),
+                     "Malformed message from the traffic simulator: " << n << " vehicles in "
+                     << m_reader.GetRemaining () << " bytes");
+    NS_ABORT_MSG_IF (std::fabs (time - now) > 1e-6, "The traffic simulator is at " << time << " s, not " << now << " s");
+    m_steps++;
+    m_vehicles = n;
+    record.vehicles = n;
+    m_state.resize (n);
+    for (uint32_t i = 0; i < n; i++)
+      {
+        cosim::VehicleState &v = m_state[i];
+        NS_ABORT_MSG_IF (!m_reader.Get (v.vehicle) || !m_reader.Get (v.x) || !m_reader.Get (v.y)
+                         || !m_reader.Get (v.speed) || !m_reader.Get (v.angle),
+                         "Malformed message from the traffic simulator");
+
+        uint32_t slot;
+        std::unordered_map<uint32_t, uint32_t>::iterator it = m_slot_of_vehicle.find (v.vehicle);
+        if (it != m_slot_of_vehicle.end ())
+          {
+            slot = it->second;
+          }
+        else if (!m_free.empty ())
+          {
+            slot = m_free.back ();
+            m_free.pop_back ();
+            m_slots[slot].used = true;
+            m_slots[slot].vehicle = v.vehicle;
+            m_slot_of_vehicle[v.vehicle] = slot;
+            NodePool::Activate (m_nodes.Get (slot));
+            record.entered++;
+          }
+        else
+          {
+            record.unplaced++;
+            continue;
+          }
+        m_slots[slot].seen = m_steps;
+        // straight on at the speed and heading of the vehicle until the next step
+        Ptr<ConstantVelocityMobilityModel> model = m_nodes.Get (slot)->GetObject<ConstantVelocityMobilityModel> ();
+        double heading = v.angle * M_PI / 180;
+        model->SetPosition (Vector (v.x, v.y, 0));
+        model->SetVelocity (Vector (v.speed * std::sin (heading), v.speed * std::cos (heading), 0));
+      }
+    for (uint32_t slot = 0; slot < m_slots.size (); slot++)
+      {
+        Slot &s = m_slots[slot];
+        if (s.used && s.seen != m_steps)
+          {
+            m_slot_of_vehicle.erase (s.vehicle);
+            s.used = false;
+            m_free.push_back (slot);
+            m_nodes.Get (slot)->GetObject<ConstantVelocityMobilityModel> ()->SetVelocity (Vector (0, 0, 0));
+            NodePool::Park (m_nodes.Get (slot));
+            record.exited++;
+          }
+      }
+
+    // record is not used past this point, the next step's may move it
+    double next = now + m_step.GetSeconds ();
+    if (next <= m_stop + 1e-9)
+      {
+        m_records.push_back (StepRecord ());
+        if (m_pipelined)
+          {
+            // the traffic simulator computes t+Δ while ns-3 simulates [t, t+Δ)
+            Request (next, m_records.back ());
+          }
+        Simulator::Schedule (m_step, &CosimBridge::Step, this);
+      }
+    else
+      {
+        Close ();
+      }
+    m_records[current].apply = Since (start);
+    m_resumed = std::chrono::steady_clock::now ();
+  }
+
+  void
+  CosimBridge::Close ()
+  {
+    if (m_fd >= 0)
+      {
+        cosim::Message close_request (cosim::CLOSE);
+        close_request.Send (m_fd);
+        close (m_fd);
+        m_fd = -1;
+      }
+    if (m_server > 0)
+      {
+        waitpid (m_server, nullptr, 0);
+        m_server = 0;
+      }
+  }
+
+  void
+  CosimBridge::SetSpeed (Ptr<Node> node, double speed, Time duration)
+  {
+    std::unordered_map<uint32_t, uint32_t>::iterator it = m_slot_of_node.find (node->GetId ());
+    if (it == m_slot_of_node.end () || !m_slots[it->second].used)
+      {
+        return;
+      }
+    cosim::SpeedCommand command;
+    command.vehicle = m_slots[it->second].vehicle;
+    command.speed = speed;
+    command.duration = duration.GetSeconds ();
+    m_commands.push_back (command);
+  }
+
+  uint32_t
+  CosimBridge::GetNVehicles ()
+  {
+    return m_vehicles;
+  }
+
+  const std::vector<cosim::VehicleState> &
+  CosimBridge::GetState ()
+  {
+    return m_state;
+  }
+
+  const std::vector<CosimBridge::StepRecord> &
+  CosimBridge::GetSteps ()
+  {
+    return m_records;
+  }
+
+  void
+  CosimBridge::WriteSteps (std::ostream &os)
+  {
+    os << "time,vehicles,entered,exited,unplaced,commands,bytesSent,bytesReceived,simulateMs,waitMs,applyMs\n";
+    for (const StepRecord &r : m_records)
+      {
+        os << r.time << "," << r.vehicles << "," << r.entered << "," << r.exited << "," << r.unplaced << ","
+           << r.commands << "," << r.bytes_sent << "," << r.bytes_received << "," << r.simulate * 1e3 << ","
+           << r.wait * 1e3 << "," << r.apply * 1e3 << "\n";
+      }
+  }
+
+  void
+  CosimBridge::PrintSummary (std::ostream &os)
+  {
+    std::vector<double> wait;
+    double simulate = 0, waited = 0, apply = 0;
+    uint64_t bytes = 0, commands = 0, unplaced = 0;
+    for (const StepRecord &r : m_records)
+      {
+        wait.push_back (r.wait);
+        simulate += r.simulate;
+        waited += r.wait;
+        apply += r.apply;
+        bytes += r.bytes_sent + r.bytes_received;
+        commands += r.commands;
+        unplaced += r.unplaced;
+      }
+    double total = simulate + waited + apply;
+    os << m_records.size () << " co-simulation steps (" << (m_pipelined ? "pipelined" : "lockstep") << "): ns-3 "
+       << simulate << " s, waiting " << waited << " s, applying " << apply << " s";
+    if (total > 0)
+      {
+        os << ", synchronization " << 100 * (waited + apply) / total << "% of the wall time";
+      }
+    os << std::endl;
+    std::sort (wait.begin (), wait.end ());
+    double mean = wait.empty () ? 0 : waited / wait.size ();
+    double p50 = wait.empty () ? 0 : wait[(wait.size () - 1) / 2];
+    double p99 = wait.empty () ? 0 : wait[(wait.size () - 1) * 99 / 100];
+    os << "  wait per step: mean " << mean * 1e3 << " ms, p50 " << p50 * 1e3 << " ms, p99 " << p99 * 1e3
+       << " ms; " << bytes << " bytes, " << commands << " speed commands";
+    if (unplaced)
+      {
+        os << ", " << unplaced << " vehicle steps without a free node";
+      }
+    os << std::endl;
+  }
+}
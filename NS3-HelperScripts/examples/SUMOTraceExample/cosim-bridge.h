@@ -0,0 +1,139 @@
+#ifndef SUMOTRACEEXAMPLE_COSIM_BRIDGE_H
+#define SUMOTRACEEXAMPLE_COSIM_BRIDGE_H
+#include "mobility-server.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+    /** \brief Drives the nodes from a traffic simulator running next to ns-3, and lets the vehicles react to V2X.
+     *
+     * Every step of length Δ the bridge receives the state of all vehicles in one STATE message (see
+     * cosim::Message), gives the vehicles that entered a parked node of the pool (NodePool::Activate),
+     * parks the nodes of the vehicles that left and moves every node at the speed and heading of its
+     * vehicle until the next step. The speed commands the applications asked for go back in one batch
+     * with the next STEP request.
+     *
+     * Stepping is pipelined: at time t the bridge asks for the state at t+Δ before ns-3 simulates
+     * [t, t+Δ), so the traffic simulator computes the next step while ns-3 computes this one and the
+     * bridge only waits for whatever is left of it. The price is one step of latency: commands sent at t
+     * are applied by the traffic simulator from t to t+Δ, and their effect is seen at t+Δ. Without
+     * pipelining the two simulators take turns.
+     *
+     * The wall time of every step is recorded: ns-3 simulating, the bridge blocked on the socket, and the
+     * bridge decoding and applying the state.
+     */
+    class CosimBridge
+    {
+        public:
+            /** \brief What one step cost, in wall seconds */
+            struct StepRecord
+            {
+                double time; /**< simulated */
+                uint32_t vehicles;
+                uint32_t entered;
+                uint32_t exited;
+                uint32_t unplaced; /**< vehicles on the road without a node, the pool is too small */
+                uint32_t commands;
+                uint64_t bytes_sent;
+                uint64_t bytes_received;
+                double simulate; /**< ns-3 running since the previous step */
+                double wait; /**< blocked until the state arrived */
+                double apply; /**< decoding and applying it, sending the next request */
+            };
+
+            /**
+             * \param nodes the pool, with a WaveNetDevice and a CustomApplication each
+             * \param step Δ, the simulated time between two exchanges
+             * \param pipelined whether the request for t+Δ goes out before ns-3 simulates [t, t+Δ)
+             */
+            CosimBridge (NodeContainer nodes, Time step, bool pipelined = true);
+            ~CosimBridge ();
+
+            /** \brief Connect to a traffic simulator listening on a Unix socket
+             */
+            void Connect (std::string path);
+
+            /** \brief Fork a StandInMobilityServer and talk to it over a socket pair
+             */
+            void SpawnServer (StandInMobilityServer::Config config);
+
+            /** \brief Park the pool and exchange the first step at time 0, the last at stop
+             */
+            void Start (Time stop);
+
+            /** \brief Cap the speed of the vehicle a node carries, from the next step on
+             * \param node a node of the pool, ignored while it is parked
+             * \param speed m/s, negative to lift the cap
+             * \param duration how long the cap holds
+             */
+            void SetSpeed (Ptr<Node> node, double speed, Time duration);
+
+            /** \return the vehicles on the road at the last step
+             */
+            uint32_t GetNVehicles ();
+
+            /** \return the state of those vehicles, as the traffic simulator sent it
+             */
+            const std::vector<cosim::VehicleState> &GetState ();
+
+            /** \return the cost of every step so far
+             */
+            const std::vector<StepRecord> &GetSteps ();
+
+            /** \brief Write the steps as CSV, wall times in milliseconds
+             */
+            void WriteSteps (std::ostream &os);
+
+            /** \brief Print the totals and the distribution of the time spent waiting
+             */
+            void PrintSummary (std::ostream &os);
+
+        private:
+            struct Slot
+            {
+                bool used;
+                uint32_t vehicle;
+                uint64_t seen; /**< last step the vehicle was on the road */
+            };
+
+            /** \brief Ask for the state at a time, with the commands gathered since the last request
+             */
+            void Request (double time, StepRecord &record);
+            /** \brief Receive the state at the current time and apply it
+             */
+            void Step ();
+            /** \brief Tell the traffic simulator to stop and wait for the stand-in to exit
+             */
+            void Close ();
+
+            NodeContainer m_nodes;
+            Time m_step;
+            bool m_pipelined;
+            double m_stop;
+            int m_fd; /**< the socket, -1 when closed */
+            pid_t m_server; /**< the stand-in process, 0 for none */
+
+            std::vector<Slot> m_slots; /**< by index in m_nodes */
+            std::vector<uint32_t> m_free; /**< slots without a vehicle */
+            std::unordered_map<uint32_t, uint32_t> m_slot_of_vehicle;
+            std::unordered_map<uint32_t, uint32_t> m_slot_of_node; /**< by node id */
+            std::vector<cosim::SpeedCommand> m_commands; /**< for the next request */
+            cosim::Reader m_reader;
+            uint64_t m_steps;
+            uint32_t m_vehicles;
+            std::vector<cosim::VehicleState> m_state; /**< at the last step */
+            std::chrono::steady_clock::time_point m_resumed; /**< when ns-3 got control back */
+            std::vector<StepRecord> m_records;
+    };
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include "ns3/mobility-model.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
 
 #define RED_CODE "\033[91m"
 #define GREEN_CODE "\033[32m"
@@ -24,6 +25,9 @@ TypeId CustomApplication::GetTypeId()
                       MakeTimeAccessor (&CustomApplication::m_broadcast_time),
                       MakeTimeChecker()
                       )
+                .AddTraceSource ("BeaconRx", "A beacon was received from a neighbor",
+                      MakeTraceSourceAccessor (&CustomApplication::m_beaconRx),
+                      "ns3::CustomApplication::BeaconRxCallback")
                 ;
     return tid;
 }
@@ -39,7 +43,9 @@ CustomApplication::CustomApplication()
     m_broadcast_time = MilliSeconds (100); //every 100ms
     m_packetSize = 1000; //1000 bytes
     m_time_limit = Seconds (5);
+    m_neighbors.SetTimeout (m_time_limit);
     m_mode = WifiMode("OfdmRate6MbpsBW10MHz");
+    m_active = true;
 }
 CustomApplication::~CustomApplication()
 {
@@ -75,21 +81,56 @@ CustomApplication::StartApplication()
             break;
         } 
     }
-    if (m_waveDevice)
+    if (!m_waveDevice)
     {
-        //Let's create a bit of randomness with the first broadcast packet time to avoid collision
-        Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable> ();
-        Time random_offset = MicroSeconds (rand->GetValue(50,200));
-
-        Simulator::Schedule (m_broadcast_time+random_offset, &CustomApplication::BroadcastInformation, this);
+        NS_FATAL_ERROR ("There's no WaveNetDevice in your node");
     }
-    else
+    if (m_active)
     {
-        NS_FATAL_ERROR ("There's no WaveNetDevice in your node");
+        ScheduleEvents ();
     }
+}
+void
+CustomApplication::StopApplication()
+{
+    NS_LOG_FUNCTION (this);
+    m_broadcast_event.Cancel ();
+    m_cleanup_event.Cancel ();
+}
+void
+CustomApplication::ScheduleEvents()
+{
+    //Let's create a bit of randomness with the first broadcast packet time to avoid collision
+    Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable> ();
+    Time random_offset = MicroSeconds (rand->GetValue(50,200));
+
+    m_broadcast_event = Simulator::Schedule (m_broadcast_time+random_offset, &CustomApplication::BroadcastInformation, this);
+
     //We will periodically (every 1 second) check the list of neighbors, and remove old ones (older than 5 seconds)
-    Simulator::Schedule (Seconds (1), &CustomApplication::RemoveOldNeighbors, this);
-      
+    m_cleanup_event = Simulator::Schedule (Seconds (1), &CustomApplication::RemoveOldNeighbors, this);
+}
+void
+CustomApplication::Suspend()
+{
+    NS_LOG_FUNCTION (this);
+    m_active = false;
+    StopApplication ();
+    m_neighbors.Clear (Now ());
+}
+void
+CustomApplication::Resume()
+{
+    NS_LOG_FUNCTION (this);
+    if (m_active)
+    {
+        return;
+    }
+    m_active = true;
+    //Before StartApplication there is no device yet, it will schedule the events itself
+    if (m_waveDevice)
+    {
+        ScheduleEvents ();
+    }
 }
 void 
 CustomApplication::SetBroadcastInterval (Time interval)
@@ -130,7 +171,7 @@ CustomApplication::BroadcastInformation()
 
     //NS_LOG_DEBUG ("Node " << GetNode()->GetId() << " is BROADCASTING a packet. " << Now ());
     //Schedule next broadcast 
-    Simulator::Schedule (m_broadcast_time, &CustomApplication::BroadcastInformation, this);
+    m_broadcast_event = Simulator::Schedule (m_broadcast_time, &CustomApplication::BroadcastInformation, this);
 }
 
 void
@@ -166,6 +207,7 @@ CustomApplication::ReceivePacket (Ptr<NetDevice> device, Ptr<const Packet> packe
     {
         NS_LOG_INFO ("\tFrom Node Id: " << tag.GetNodeId() << " at " << tag.GetPosition() 
                         << "\tPacket Timestamp: " << tag.GetTimestamp() << " delay="<< Now()-tag.GetTimestamp());
+        m_beaconRx (tag.GetNodeId (), tag.GetPosition ());
     }
 
     return true;
@@ -189,7 +231,7 @@ CustomApplication::PromiscRx (Ptr<const Packet> packet, uint16_t channelFreq, Wi
         Mac48Address destination = hdr.GetAddr1();
         Mac48Address source = hdr.GetAddr2();
 
-        //UpdateNeighbor (source);
+        UpdateNeighbor (source);
 
         Mac48Address myMacAddress = m_waveDevice->GetMac(CCH)->GetAddress();
         //A packet is intened to me if it targets my MAC address, or it's a broadcast message
@@ -207,31 +249,18 @@ CustomApplication::PromiscRx (Ptr<const Packet> packet, uint16_t channelFreq, Wi
 
 void CustomApplication::UpdateNeighbor (Mac48Address addr)
 {
-    bool found = false;
-    //Go over all neighbors, find one matching the address, and updates its 'last_beacon' time.
-    for (std::vector<NeighborInformation>::iterator it = m_neighbors.begin(); it != m_neighbors.end(); it++ )
-    {
-        if (it->neighbor_mac == addr)
-        {
-            it->last_beacon = Now();
-            found = true;
-            break;
-        }
-    }
-    if (!found) //If no node with this address exist, add a new table entry
+    //Updates the 'last_beacon' time of the neighbor, or adds a new table entry
+    if (m_neighbors.Update (addr, Now ()))
     {
         NS_LOG_INFO ( GREEN_CODE << Now() << " : Node " << GetNode()->GetId() << " is adding a neighbor with MAC="<<addr << END_CODE);
-        NeighborInformation new_n;
-        new_n.neighbor_mac = addr;
-        new_n.last_beacon = Now ();
-        m_neighbors.push_back (new_n);
     }
 }
 
 void CustomApplication::PrintNeighbors ()
 {
     std::cout << "Neighbor Info for Node: " << GetNode()->GetId() << std::endl;
-    for (std::vector<NeighborInformation>::iterator it = m_neighbors.begin(); it != m_neighbors.end(); it++ )
+    std::vector<NeighborInformation> neighbors = m_neighbors.GetNeighbors ();
+    for (std::vector<NeighborInformation>::iterator it = neighbors.begin(); it != neighbors.end(); it++ )
     {
         std::cout << "\tMAC: " << it->neighbor_mac << "\tLast Contact: " << it->last_beacon << std::endl;
     }
@@ -239,23 +268,25 @@ void CustomApplication::PrintNeighbors ()
 
 void CustomApplication::RemoveOldNeighbors ()
 {
-    //Go over the list of neighbors
-    for (std::vector<NeighborInformation>::iterator it = m_neighbors.begin(); it != m_neighbors.end(); it++ )
+    //Remove every neighbor we haven't heard from in m_time_limit, all at once
+    uint32_t removed = m_neighbors.Expire (Now ());
+    if (removed)
     {
-        //Get the time passed since the last time we heard from a node
-        Time last_contact = Now () - it->last_beacon;
-
-        if (last_contact >= Seconds (5)) //if it has been more than 5 seconds, we will remove it. You can change this to whatever value you want.
-        {
-            NS_LOG_INFO (RED_CODE << Now () << " Node " << GetNode()->GetId()<<" is removing old neighbor " << it->neighbor_mac <<END_CODE);
-            //Remove an old entry from the table
-            m_neighbors.erase (it);
-            break;
-        }    
+        NS_LOG_INFO (RED_CODE << Now () << " Node " << GetNode()->GetId()<<" removed " << removed << " old neighbors, " << m_neighbors.GetSize () << " left" <<END_CODE);
     }
     //Check the list again after 1 second.
-    Simulator::Schedule (Seconds (1), &CustomApplication::RemoveOldNeighbors, this);
+    m_cleanup_event = Simulator::Schedule (Seconds (1), &CustomApplication::RemoveOldNeighbors, this);
+
+}
 
+uint32_t CustomApplication::GetNNeighbors () const
+{
+    return m_neighbors.GetSize ();
+}
+
+const NeighborTable &CustomApplication::GetNeighborTable () const
+{
+    return m_neighbors;
 }
 
 }//end of ns3
@@ -1,26 +1,23 @@
 #ifndef SUMOTRACEEXAMPLE_CUSTOM_APPLICATION_H
 #define SUMOTRACEEXAMPLE_CUSTOM_APPLICATION_H
+#include "neighbor-table.h"
 #include "ns3/application.h"
+#include "ns3/traced-callback.h"
+#include "ns3/vector.h"
 #include "ns3/wave-net-device.h"
 #include "ns3/wifi-phy.h"
-#include <vector>
 
 namespace ns3
 {
-    /** \brief A struct to represent information about this node's neighbors. I chose MAC address and the time last message was received form that node
-     * The time 'last_beacon' is used to determine whether we should remove the neighbor from the list.
-     */
-    typedef struct 
-    {
-        Mac48Address neighbor_mac;
-        Time last_beacon;
-    } NeighborInformation;
-
     class CustomApplication : public ns3::Application
     {
         public: 
             
             static TypeId GetTypeId (void);
+
+            /** \brief Signature of the BeaconRx trace: id of the node that sent the beacon, and where it was
+             */
+            typedef void (* BeaconRxCallback) (uint32_t sender, Vector position);
             virtual TypeId GetInstanceTypeId (void) const;
 
             CustomApplication();
@@ -60,21 +57,50 @@ namespace ns3
              */
             void RemoveOldNeighbors ();
 
+            /** \return the number of neighbors
+             */
+            uint32_t GetNNeighbors () const;
+
+            /** \brief The neighbors, with the degree statistics of this node
+             */
+            const NeighborTable &GetNeighborTable () const;
+
+            /** \brief Stop broadcasting and forget the neighbors, as if the node left the simulation.
+             * A pooled node is suspended between the vehicles it carries.
+             */
+            void Suspend ();
+
+            /** \brief Broadcast again after Suspend, from a random offset like at start
+             */
+            void Resume ();
+
             //You can create more functions like getters, setters, and others
 
         private:
             /** \brief This is an inherited function. Code that executes once the application starts
              */
             void StartApplication();
+            /** \brief This is an inherited function. Cancels the broadcasts and the neighbor checks
+             */
+            void StopApplication();
+            /** \brief Schedule the first broadcast and the first neighbor check
+             */
+            void ScheduleEvents();
             Time m_broadcast_time; /**< How often do you broadcast messages */ 
             uint32_t m_packetSize; /**< Packet size in bytes */
             Ptr<WaveNetDevice> m_waveDevice; /**< A WaveNetDevice that is attached to this device */  
             
-            std::vector <NeighborInformation> m_neighbors; /**< A table representing neighbors of this node */
+            NeighborTable m_neighbors; /**< A table representing neighbors of this node */
 
             Time m_time_limit; /**< Time limit to keep neighbors in a list */
             
             WifiMode m_mode; /**< data rate used for broadcasts */
+
+            TracedCallback<uint32_t, Vector> m_beaconRx; /**< a beacon with a CustomDataTag was received */
+
+            bool m_active; /**< false while suspended */
+            EventId m_broadcast_event; /**< next BroadcastInformation */
+            EventId m_cleanup_event; /**< next RemoveOldNeighbors */
             //You can define more stuff to record statistics, etc.
     };
 }
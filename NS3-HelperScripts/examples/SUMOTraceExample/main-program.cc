@@ -4,48 +4,255 @@
 #include "ns3/core-module.h"
 #include "ns3/mobility-module.h"
 #include "ns2-node-utility.h"
+#include "node-pool.h"
+#include "sumo-fcd-importer.h"
+#include "cosim-bridge.h"
+#include "ns2-stream-mobility-helper.h"
+
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <vector>
 
 using namespace ns3;
 
+/** For the co-simulation: a vehicle that hears a beacon from a vehicle ahead in its lane,
+ * less than two seconds ahead at its speed, slows down to open the gap. Offline traces can't do that.
+ */
+static void
+KeepGap (CosimBridge *bridge, Ptr<Node> node, uint32_t sender, Vector position)
+{
+  Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+  Vector me = mobility->GetPosition ();
+  Vector velocity = mobility->GetVelocity ();
+  double speed = std::sqrt (velocity.x * velocity.x + velocity.y * velocity.y);
+  if (speed < 1)
+    {
+      return;
+    }
+  double ahead = ((position.x - me.x) * velocity.x + (position.y - me.y) * velocity.y) / speed;
+  double aside = std::fabs ((position.y - me.y) * velocity.x - (position.x - me.x) * velocity.y) / speed;
+  if (ahead > 0 && ahead < 2 * speed && aside < 1)
+    {
+      bridge->SetSpeed (node, 0.9 * speed, Seconds (1));
+    }
+}
+
+static void
+SampleState (CosimBridge *bridge, std::vector<std::vector<cosim::VehicleState> > *states)
+{
+  states->push_back (bridge->GetState ());
+}
+
+/** For --cosimCheck: co-simulate with the stand-in server without speed commands and
+ * \return the state of the vehicles at every step, sampled halfway to the next one.
+ */
+static std::vector<std::vector<cosim::VehicleState> >
+RunCosimCheck (uint32_t pool, double step, double time, bool pipelined)
+{
+  NodeContainer nodes;
+  nodes.Create (pool);
+  WaveSetup wave;
+  wave.ConfigureDevices(nodes);
+  CosimBridge bridge (nodes, Seconds (step), pipelined);
+  for (uint32_t i=0 ; i<pool; i++)
+    {
+      Ptr<CustomApplication> app = CreateObject <CustomApplication>  ();
+      app->SetStartTime (Seconds (0));
+      nodes.Get(i)->AddApplication(app);
+    }
+  bridge.SpawnServer (StandInMobilityServer::Config ());
+  bridge.Start (Seconds (time));
+
+  std::vector<std::vector<cosim::VehicleState> > states;
+  for (uint32_t i = 0; (i + 0.5) * step < time; i++)
+    {
+      Simulator::Schedule (Seconds ((i + 0.5) * step), &SampleState, &bridge, &states);
+    }
+  Simulator::Stop (Seconds (time + step / 2));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return states;
+}
+
 int main (int argc, char *argv[])
 {
   CommandLine cmd;
+  bool pool_nodes = true;
+  std::string fcd_file;
+  double fcd_tolerance = 0.01;
+  cmd.AddValue ("pool", "Recycle nodes between vehicles that are not in the trace at the same time", pool_nodes);
+  cmd.AddValue ("fcd", "SUMO floating car data (sumo --fcd-output) to read instead of the ns-2 trace", fcd_file);
+  cmd.AddValue ("fcdTolerance", "Meters a dropped FCD sample may be off the constant velocity segment that replaces it", fcd_tolerance);
+  bool cosim = false;
+  std::string cosim_socket;
+  uint32_t cosim_nodes = 200;
+  double cosim_step = 0.1;
+  double cosim_time = 60;
+  bool cosim_pipelined = true;
+  double cosim_step_cost = 0;
+  bool cosim_react = true;
+  std::string cosim_log;
+  cmd.AddValue ("cosim", "Co-simulate with the bundled stand-in mobility server instead of reading a trace", cosim);
+  cmd.AddValue ("cosimSocket", "Unix socket of a traffic simulator to co-simulate with", cosim_socket);
+  cmd.AddValue ("cosimNodes", "Nodes of the pool the co-simulated vehicles borrow", cosim_nodes);
+  cmd.AddValue ("cosimStep", "Seconds between two exchanges with the traffic simulator", cosim_step);
+  cmd.AddValue ("cosimTime", "Seconds to co-simulate", cosim_time);
+  cmd.AddValue ("cosimPipelined", "Let the traffic simulator compute the next step while ns-3 simulates this one", cosim_pipelined);
+  cmd.AddValue ("cosimStepCost", "Milliseconds of extra work per step of the stand-in server", cosim_step_cost);
+  cmd.AddValue ("cosimReact", "Slow down vehicles that hear a beacon from a vehicle close ahead", cosim_react);
+  cmd.AddValue ("cosimLog", "CSV file the wall time of every co-simulation step goes to", cosim_log);
+  bool cosim_check = false;
+  cmd.AddValue ("cosimCheck", "Co-simulate with the stand-in server pipelined and in lockstep, and check that the vehicles agree", cosim_check);
   cmd.Parse (argc, argv);
 
+  if (cosim_check)
+    {
+      // without speed commands the one step of pipelining latency does not show: the states must match
+      std::vector<std::vector<cosim::VehicleState> > pipelined = RunCosimCheck (cosim_nodes, cosim_step, cosim_time, true);
+      std::vector<std::vector<cosim::VehicleState> > lockstep = RunCosimCheck (cosim_nodes, cosim_step, cosim_time, false);
+      NS_ABORT_MSG_IF (pipelined.size () != lockstep.size (), pipelined.size () << " pipelined steps, " << lockstep.size () << " in lockstep");
+      uint64_t vehicles = 0;
+      for (uint32_t i = 0; i < pipelined.size (); i++)
+        {
+          NS_ABORT_MSG_IF (pipelined[i].size () != lockstep[i].size (), "Step " << i << ": " << pipelined[i].size () << " vehicles pipelined, " << lockstep[i].size () << " in lockstep");
+          for (uint32_t j = 0; j < pipelined[i].size (); j++)
+            {
+              const cosim::VehicleState &a = pipelined[i][j];
+              const cosim::VehicleState &b = lockstep[i][j];
+              NS_ABORT_MSG_IF (a.vehicle != b.vehicle || a.x != b.x || a.y != b.y || a.speed != b.speed || a.angle != b.angle,
+                               "Step " << i << ": vehicle " << a.vehicle << " at (" << a.x << ", " << a.y << ") pipelined, vehicle "
+                               << b.vehicle << " at (" << b.x << ", " << b.y << ") in lockstep");
+            }
+          vehicles += pipelined[i].size ();
+        }
+      std::cout << "Pipelined and lockstep co-simulations agree on " << vehicles << " vehicle states over " << pipelined.size () << " steps" << std::endl;
+      return 0;
+    }
+
+  if (cosim || !cosim_socket.empty ())
+    {
+      NodeContainer nodes;
+      nodes.Create (cosim_nodes);
+      WaveSetup wave;
+      wave.ConfigureDevices(nodes);
+
+      CosimBridge bridge (nodes, Seconds (cosim_step), cosim_pipelined);
+      for (uint32_t i=0 ; i<cosim_nodes; i++)
+        {
+          Ptr<Node> n = nodes.Get(i);
+          Ptr<CustomApplication> app = CreateObject <CustomApplication>  ();
+          //the bridge resumes and suspends the application as vehicles enter and leave the road
+          app->SetStartTime (Seconds (0));
+          n->AddApplication(app);
+          if (cosim_react)
+            {
+              app->TraceConnectWithoutContext ("BeaconRx", MakeBoundCallback (&KeepGap, &bridge, n));
+            }
+        }
+      if (cosim_socket.empty ())
+        {
+          StandInMobilityServer::Config config;
+          config.step_cost = cosim_step_cost / 1000;
+          bridge.SpawnServer (config);
+        }
+      else
+        {
+          bridge.Connect (cosim_socket);
+        }
+      bridge.Start (Seconds (cosim_time));
+      std::cout << "Co-simulation of " << cosim_time << " s with " << cosim_nodes << " nodes set up" << std::endl;
+
+      Simulator::Stop (Seconds (cosim_time + cosim_step / 2)); //just after the last step
+      Simulator::Run ();
+      bridge.PrintSummary (std::cout);
+      if (!cosim_log.empty ())
+        {
+          std::ofstream log (cosim_log);
+          bridge.WriteSteps (log);
+        }
+      Simulator::Destroy ();
+      std::cout << "End of Program" << std::endl;
+      return 0;
+    }
+
   std::string mobility_file = "scratch/SUMOTraceExample/ns2mobility.tcl";
 
   //A tool I created so that we only start the applications within nodes when they actually enter the simulation.
-  Ns2NodeUtility ns2_utility (mobility_file);
+  //The FCD importer gives the same times, and the waypoints of every vehicle.
+  std::unique_ptr<Ns2NodeUtility> ns2_utility;
+  std::unique_ptr<SumoFcdImporter> fcd;
+  if (fcd_file.empty ())
+    {
+      ns2_utility.reset (new Ns2NodeUtility (mobility_file));
+    }
+  else
+    {
+      fcd.reset (new SumoFcdImporter (fcd_file, 0, fcd_tolerance));
+      std::cout << fcd->GetNSamples () << " FCD samples collapsed into " << fcd->GetNWaypoints () << " waypoints" << std::endl;
+    }
+
+  uint32_t nvehicles = fcd ? fcd->GetNNodes() : ns2_utility->GetNNodes();
+  double sim_time = fcd ? fcd->GetSimulationTime() : ns2_utility->GetSimulationTime();
 
-  uint32_t nnodes = ns2_utility.GetNNodes();
-  double sim_time = ns2_utility.GetSimulationTime();
+  //Most vehicles are only in the trace for a while: the pool needs as many nodes as there are vehicles at once
+  NodePool pool = fcd ? NodePool (*fcd) : NodePool (*ns2_utility);
+  uint32_t nnodes = pool_nodes ? pool.GetNNodes() : nvehicles;
+  std::cout << nvehicles << " vehicles on " << nnodes << " nodes" << std::endl;
 
   NodeContainer nodes;
   nodes.Create (nnodes);
 
-  //Using the bulit-in ns-2 mobility helper
-  Ns2MobilityHelper sumo_trace (mobility_file);
-  sumo_trace.Install(); //install ns-2 mobility in all nodes
-
   //To write shorter code, I put the code to setup WaveNetDevice in a separate file.
   WaveSetup wave;
   wave.ConfigureDevices(nodes);
 
-  std::cout << "NS2 mobility & devices configured..." << std::endl;
+  std::cout << "Devices configured..." << std::endl;
   //Let's install my CustomApplication to all nodes and start them at the appropriate time using my utilitiy.
   ApplicationContainer apps;
   for (uint32_t i=0 ; i<nnodes; i++)
     {
       Ptr<Node> n = nodes.Get(i);
       Ptr<CustomApplication> app = CreateObject <CustomApplication>  ();
-      //app->SetStartTime (Seconds (0));
-      //app->SetStopTime (Seconds (sim_time));
-      app->SetStartTime(Seconds (ns2_utility.GetEntryTimeForNode(i)));
-      app->SetStopTime (Seconds (ns2_utility.GetExitTimeForNode(i)));
+      if (pool_nodes)
+        {
+          //the pool resumes and suspends the application as vehicles enter and exit
+          app->SetStartTime (Seconds (0));
+        }
+      else
+        {
+          app->SetStartTime(Seconds (fcd ? fcd->GetEntryTimeForNode(i) : ns2_utility->GetEntryTimeForNode(i)));
+          app->SetStopTime (Seconds (fcd ? fcd->GetExitTimeForNode(i) : ns2_utility->GetExitTimeForNode(i)));
+        }
       n->AddApplication(app);
 
     }
   std::cout << "Applications setup done!" << std::endl;
+
+  //Like the bulit-in ns-2 mobility helper, but only the next 5 seconds of the trace are scheduled at a time
+  Ns2StreamMobilityHelper sumo_trace (mobility_file, Seconds (5));
+  if (pool_nodes)
+    {
+      pool.Install (nodes);
+      //every vehicle drives the node it borrows
+      if (fcd)
+        {
+          fcd->Install (pool.GetVehicleNodes ());
+        }
+      else
+        {
+          sumo_trace.Install (pool.GetVehicleNodes ());
+        }
+    }
+  else if (fcd)
+    {
+      fcd->Install (); //the waypoints were read with the FCD
+    }
+  else
+    {
+      sumo_trace.Install(); //install ns-2 mobility in all nodes
+    }
+  std::cout << "Mobility configured..." << std::endl;
   Simulator::Stop(Seconds (sim_time)); //because this is the last timestamp in your ns-2 trace
   Simulator::Run ();
 
@@ -0,0 +1,244 @@
+#include "mobility-server.h"
+#include "ns3/abort.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace ns3
+{
+  namespace
+  {
+    const double VEHICLE_LENGTH = 5;
+
+    bool
+    ReadAll (int fd, char *data, size_t size)
+    {
+      while (size > 0)
+        {
+          ssize_t n = read (fd, data, size);
+          if (n < 0 && errno == EINTR)
+            {
+              continue;
+            }
+          if (n <= 0)
+            {
+              return false;
+            }
+          data += n;
+          size -= n;
+        }
+      return true;
+    }
+  }
+
+  namespace cosim
+  {
+    bool
+    Message::Send (int fd)
+    {
+      uint32_t length = m_buffer.size () - 5;
+      std::memcpy (&m_buffer[0], &length, sizeof (length));
+      const char *data = m_buffer.data ();
+      size_t size = m_buffer.size ();
+      while (size > 0)
+        {
+          // a peer that went away is an error to report, not a SIGPIPE
+          ssize_t n = send (fd, data, size, MSG_NOSIGNAL);
+          if (n < 0 && errno == EINTR)
+            {
+              continue;
+            }
+          if (n <= 0)
+            {
+              return false;
+            }
+          data += n;
+          size -= n;
+        }
+      return true;
+    }
+
+    bool
+    Reader::Receive (int fd)
+    {
+      char header[5];
+      if (!ReadAll (fd, header, sizeof (header)))
+        {
+          return false;
+        }
+      uint32_t length;
+      std::memcpy (&length, header, sizeof (length));
+      m_command = static_cast<Command> (header[4]);
+      NS_ABORT_MSG_IF (length > MAX_LENGTH, "Message of " << length << " bytes, over the limit of " << MAX_LENGTH);
+      m_buffer.resize (length);
+      m_at = 0;
+      return length == 0 || ReadAll (fd, &m_buffer[0], length);
+    }
+  }
+
+  StandInMobilityServer::StandInMobilityServer (Config config)
+    : m_config (config),
+      m_random (config.seed * 0x9E3779B97F4A7C15ull + 1),
+      m_time (0),
+      m_next_id (0),
+      m_lanes (config.lanes),
+      m_next_arrival (config.lanes)
+  {
+    for (uint32_t l = 0; l < m_config.lanes; l++)
+      {
+        m_next_arrival[l] = -std::log (1 - Uniform ()) / m_config.arrival_rate;
+      }
+  }
+
+  double
+  StandInMobilityServer::Uniform ()
+  {
+    // xorshift64*
+    m_random ^= m_random >> 12;
+    m_random ^= m_random << 25;
+    m_random ^= m_random >> 27;
+    return ((m_random * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  void
+  StandInMobilityServer::Serve (int fd)
+  {
+    cosim::Reader request;
+    std::vector<cosim::SpeedCommand> commands;
+    while (request.Receive (fd) && request.GetCommand () == cosim::STEP)
+      {
+        double time;
+        uint32_t n;
+        NS_ABORT_MSG_IF (!request.Get (time) || !request.Get (n), "Malformed message from the bridge");
+        // exactly the commands announced, no more, no less
+        NS_ABORT_MSG_IF (request.GetRemaining () != uint64_t (n) * (sizeof (uint32_t) + 2 * sizeof (double)),
+                         "Malformed message from the bridge: " << n << " speed commands in "
+                         << request.GetRemaining () << " bytes");
+        commands.resize (n);
+        for (cosim::SpeedCommand &command : commands)
+          {
+            NS_ABORT_MSG_IF (!request.Get (command.vehicle) || !request.Get (command.speed)
+                             || !request.Get (command.duration),
+                             "Malformed message from the bridge");
+          }
+        Step (time, commands);
+
+        const std::vector<cosim::VehicleState> &state = GetState ();
+        cosim::Message reply (cosim::STATE);
+        reply.Put (m_time);
+        reply.Put (uint32_t (state.size ()));
+        for (const cosim::VehicleState &vehicle : state)
+          {
+            reply.Put (vehicle.vehicle);
+            reply.Put (vehicle.x);
+            reply.Put (vehicle.y);
+            reply.Put (vehicle.speed);
+            reply.Put (vehicle.angle);
+          }
+        if (!reply.Send (fd))
+          {
+            break;
+          }
+      }
+  }
+
+  void
+  StandInMobilityServer::Step (double time, const std::vector<cosim::SpeedCommand> &commands)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+    for (const cosim::SpeedCommand &command : commands)
+      {
+        for (std::deque<Vehicle> &lane : m_lanes)
+          {
+            for (Vehicle &v : lane)
+              {
+                if (v.id == command.vehicle)
+                  {
+                    v.cap = command.speed < 0 ? std::numeric_limits<double>::infinity () : command.speed;
+                    v.cap_until = m_time + command.duration;
+                  }
+              }
+          }
+      }
+
+    while (m_time < time - 1e-9)
+      {
+        double dt = std::min (m_config.substep, time - m_time);
+        m_time += dt;
+        for (uint32_t l = 0; l < m_config.lanes; l++)
+          {
+            std::deque<Vehicle> &lane = m_lanes[l];
+            // the leader drives freely, everyone else keeps the time gap to the one ahead
+            for (uint32_t i = 0; i < lane.size (); i++)
+              {
+                Vehicle &v = lane[i];
+                double limit = std::min (v.desired, v.speed + m_config.acceleration * dt);
+                if (m_time < v.cap_until)
+                  {
+                    limit = std::min (limit, v.cap);
+                  }
+                if (i > 0)
+                  {
+                    double gap = std::max (0.0, lane[i - 1].x - v.x - VEHICLE_LENGTH - m_config.min_gap);
+                    limit = std::min (limit, std::min (gap / m_config.time_gap, gap / dt));
+                  }
+                v.speed = std::max (0.0, limit);
+                v.x += v.speed * dt;
+              }
+            while (!lane.empty () && lane.front ().x > m_config.length)
+              {
+                lane.pop_front ();
+              }
+            // Poisson arrivals, dropped while the entry of the lane is blocked
+            while (m_next_arrival[l] <= m_time)
+              {
+                m_next_arrival[l] += -std::log (1 - Uniform ()) / m_config.arrival_rate;
+                if (!lane.empty () && lane.back ().x < VEHICLE_LENGTH + m_config.min_gap)
+                  {
+                    continue;
+                  }
+                Vehicle v;
+                v.id = m_next_id++;
+                v.x = 0;
+                v.desired = m_config.min_speed + (m_config.max_speed - m_config.min_speed) * Uniform ();
+                v.speed = lane.empty () ? v.desired : std::min (v.desired, lane.back ().speed);
+                v.cap = std::numeric_limits<double>::infinity ();
+                v.cap_until = 0;
+                lane.push_back (v);
+              }
+          }
+      }
+
+    if (m_config.step_cost > 0)
+      {
+        std::this_thread::sleep_until (start + std::chrono::duration<double> (m_config.step_cost));
+      }
+  }
+
+  const std::vector<cosim::VehicleState> &
+  StandInMobilityServer::GetState ()
+  {
+    m_state.clear ();
+    for (uint32_t l = 0; l < m_config.lanes; l++)
+      {
+        for (const Vehicle &v : m_lanes[l])
+          {
+            cosim::VehicleState state;
+            state.vehicle = v.id;
+            state.x = v.x;
+            state.y = (l + 0.5) * m_config.lane_width;
+            state.speed = v.speed;
+            state.angle = 90; // east
+            m_state.push_back (state);
+          }
+      }
+    return m_state;
+  }
+}
@@ -0,0 +1,182 @@
+#ifndef SUMOTRACEEXAMPLE_MOBILITY_SERVER_H
+#define SUMOTRACEEXAMPLE_MOBILITY_SERVER_H
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace ns3
+{
+    /** \brief The messages CosimBridge and a traffic simulator exchange over a local socket.
+     *
+     * Like TraCI, every message is a 32-bit length, a command byte and the payload, but a step carries the
+     * whole batch each way: the bridge sends the commands of the vehicles with the step request, and the
+     * server answers with the state of every vehicle on the road. Numbers are in host byte order, the two
+     * ends share the machine.
+     *
+     *   STEP   double time, uint32 n, n x {uint32 vehicle, double speed, double duration}
+     *   STATE  double time, uint32 n, n x {uint32 vehicle, double x, double y, double speed, double angle}
+     *   CLOSE
+     *
+     * A speed command caps the speed of a vehicle for duration seconds, a negative speed lifts the cap.
+     * The angle is SUMO's: degrees clockwise from north.
+     */
+    namespace cosim
+    {
+        enum Command : uint8_t
+        {
+            STEP = 0x02,
+            STATE = 0x82,
+            CLOSE = 0x7f
+        };
+
+        struct SpeedCommand
+        {
+            uint32_t vehicle;
+            double speed;
+            double duration;
+        };
+
+        struct VehicleState
+        {
+            uint32_t vehicle;
+            double x;
+            double y;
+            double speed;
+            double angle;
+        };
+
+        /** \brief A message being written, its length filled in by Send */
+        class Message
+        {
+            public:
+                explicit Message (Command command) : m_buffer (5, 0)
+                {
+                    m_buffer[4] = command;
+                }
+                template <typename T>
+                void Put (const T &value)
+                {
+                    size_t at = m_buffer.size ();
+                    m_buffer.resize (at + sizeof (T));
+                    std::memcpy (&m_buffer[at], &value, sizeof (T));
+                }
+                /** \brief Write the whole message, retrying short writes. \return false if the peer is gone */
+                bool Send (int fd);
+                size_t GetSize () const
+                {
+                    return m_buffer.size ();
+                }
+
+            private:
+                std::vector<char> m_buffer;
+        };
+
+        /** \brief A message being read */
+        class Reader
+        {
+            public:
+                /** Longest payload accepted, so that a bad length cannot make Receive allocate gigabytes */
+                static constexpr uint32_t MAX_LENGTH = 16 << 20;
+
+                /** \brief Block until a whole message has arrived, aborting on one over MAX_LENGTH.
+                 * \return false if the peer is gone
+                 */
+                bool Receive (int fd);
+                Command GetCommand () const
+                {
+                    return m_command;
+                }
+                template <typename T>
+                bool Get (T &value)
+                {
+                    if (m_at + sizeof (T) > m_buffer.size ())
+                    {
+                        return false;
+                    }
+                    std::memcpy (&value, &m_buffer[m_at], sizeof (T));
+                    m_at += sizeof (T);
+                    return true;
+                }
+                size_t GetSize () const
+                {
+                    return m_buffer.size () + 5;
+                }
+                /** \return payload bytes not read by Get yet */
+                size_t GetRemaining () const
+                {
+                    return m_buffer.size () - m_at;
+                }
+
+            private:
+                Command m_command;
+                std::vector<char> m_buffer; /**< payload, reused from message to message */
+                size_t m_at;
+        };
+    }
+
+    /** \brief A stand-in for the traffic simulator, enough to run and test CosimBridge without SUMO.
+     *
+     * Vehicles enter a straight road of parallel lanes at x = 0, heading east, and leave it at its end.
+     * Each keeps its lane and drives at its desired speed, slowed by the vehicle ahead (it never gets
+     * closer than the time gap allows) and by the speed caps the bridge sends. Runs are repeatable for
+     * a given seed.
+     */
+    class StandInMobilityServer
+    {
+        public:
+            struct Config
+            {
+                uint32_t lanes = 3;
+                double length = 3000; /**< meters of road */
+                double lane_width = 3.2;
+                double arrival_rate = 0.5; /**< vehicles per second and lane */
+                double min_speed = 22; /**< desired speeds are uniform in [min_speed, max_speed] m/s */
+                double max_speed = 33;
+                double time_gap = 1.2; /**< seconds */
+                double min_gap = 2.5; /**< meters, plus one vehicle length */
+                double acceleration = 2.6; /**< m/s^2 */
+                double substep = 0.1; /**< seconds the road is advanced by, within a step */
+                double step_cost = 0; /**< extra seconds of work per step, to stand in for a heavier simulator */
+                uint32_t seed = 1;
+            };
+
+            explicit StandInMobilityServer (Config config);
+
+            /** \brief Answer the requests on fd until CLOSE or until the peer goes away
+             */
+            void Serve (int fd);
+
+            /** \brief Advance the road to a time, applying the speed caps first
+             */
+            void Step (double time, const std::vector<cosim::SpeedCommand> &commands);
+
+            /** \return the vehicles on the road
+             */
+            const std::vector<cosim::VehicleState> &GetState ();
+
+        private:
+            struct Vehicle
+            {
+                uint32_t id;
+                double x;
+                double speed;
+                double desired;
+                double cap;
+                double cap_until;
+            };
+
+            /** \return a uniform number in [0, 1) */
+            double Uniform ();
+
+            Config m_config;
+            uint64_t m_random;
+            double m_time;
+            uint32_t m_next_id;
+            std::vector<std::deque<Vehicle> > m_lanes; /**< leader first */
+            std::vector<double> m_next_arrival; /**< by lane */
+            std::vector<cosim::VehicleState> m_state;
+    };
+}
+
+#endif
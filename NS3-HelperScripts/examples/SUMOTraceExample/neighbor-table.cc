@@ -0,0 +1,306 @@
+#include "neighbor-table.h"
+#include "ns3/abort.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+  namespace
+  {
+    const uint32_t INITIAL_INDEX_BITS = 4;
+  }
+
+  NeighborTable::NeighborTable (Time timeout, Time granularity)
+    : m_timeout (timeout.GetTimeStep ()),
+      m_granularity (granularity.GetTimeStep ())
+  {
+    NS_ABORT_MSG_IF (m_timeout <= 0, "The neighbor timeout must be positive");
+    NS_ABORT_MSG_IF (m_granularity <= 0, "The neighbor table granularity must be positive");
+    Clear (Seconds (0));
+  }
+
+  void
+  NeighborTable::Clear (Time now)
+  {
+    m_entries.clear ();
+    m_free = NONE;
+    m_index.assign (1u << INITIAL_INDEX_BITS, 0);
+    m_shift = 64 - INITIAL_INDEX_BITS;
+    m_tick = now.GetTimeStep () / m_granularity;
+    BuildWheel ();
+
+    m_size = 0;
+    m_max = 0;
+    m_added = 0;
+    m_expired = 0;
+    m_integral = 0;
+    m_since = now.GetTimeStep ();
+    m_changed = m_since;
+  }
+
+  void
+  NeighborTable::SetTimeout (Time timeout)
+  {
+    NS_ABORT_MSG_IF (!timeout.IsStrictlyPositive (), "The neighbor timeout must be positive");
+    m_timeout = timeout.GetTimeStep ();
+    BuildWheel ();
+  }
+
+  void
+  NeighborTable::BuildWheel ()
+  {
+    // a new neighbor is due at most ceil(timeout / granularity) + 1 ticks after the last Expire,
+    // so that many slots and one more never wrap onto the slot being emptied
+    int64_t ticks = (m_timeout + m_granularity - 1) / m_granularity + 2;
+    size_t slots = 1;
+    while (int64_t (slots) < ticks)
+      {
+        slots <<= 1;
+      }
+    m_wheel.assign (slots, NONE);
+    for (uint32_t e = 0; e < m_entries.size (); e++)
+      {
+        if (m_entries[e].key != FREE)
+          {
+            Link (e, ExpiryTick (m_entries[e].last));
+          }
+      }
+  }
+
+  uint64_t
+  NeighborTable::Key (Mac48Address addr)
+  {
+    uint8_t buffer[6];
+    addr.CopyTo (buffer);
+    uint64_t key = 0;
+    for (uint32_t i = 0; i < 6; i++)
+      {
+        key = (key << 8) | buffer[i];
+      }
+    return key;
+  }
+
+  uint32_t
+  NeighborTable::Find (uint64_t key) const
+  {
+    uint32_t mask = m_index.size () - 1;
+    // Fibonacci hashing, the top bits spread well even for consecutive addresses
+    uint32_t i = (key * 0x9E3779B97F4A7C15ull) >> m_shift;
+    while (m_index[i] && m_entries[m_index[i] - 1].key != key)
+      {
+        i = (i + 1) & mask;
+      }
+    return i;
+  }
+
+  void
+  NeighborTable::Grow ()
+  {
+    m_index.assign (m_index.size () * 2, 0);
+    m_shift--;
+    for (uint32_t e = 0; e < m_entries.size (); e++)
+      {
+        if (m_entries[e].key != FREE)
+          {
+            m_index[Find (m_entries[e].key)] = e + 1;
+          }
+      }
+  }
+
+  void
+  NeighborTable::EraseIndex (uint32_t i)
+  {
+    uint32_t mask = m_index.size () - 1;
+    uint32_t j = i;
+    while (true)
+      {
+        j = (j + 1) & mask;
+        if (!m_index[j])
+          {
+            break;
+          }
+        uint32_t home = (m_entries[m_index[j] - 1].key * 0x9E3779B97F4A7C15ull) >> m_shift;
+        // the cell at j may move back to i unless its home lies cyclically in (i, j]
+        bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays)
+          {
+            m_index[i] = m_index[j];
+            i = j;
+          }
+      }
+    m_index[i] = 0;
+  }
+
+  int64_t
+  NeighborTable::ExpiryTick (int64_t last) const
+  {
+    return (last + m_timeout + m_granularity - 1) / m_granularity;
+  }
+
+  void
+  NeighborTable::Link (uint32_t entry, int64_t tick)
+  {
+    uint32_t &head = m_wheel[tick & (m_wheel.size () - 1)];
+    m_entries[entry].next = head;
+    head = entry;
+  }
+
+  void
+  NeighborTable::Account (int64_t now)
+  {
+    m_integral += double (m_size) * (now - m_changed);
+    m_changed = now;
+  }
+
+  bool
+  NeighborTable::Update (Mac48Address addr, Time now)
+  {
+    uint64_t key = Key (addr);
+    uint32_t i = Find (key);
+    if (m_index[i])
+      {
+        // the neighbor stays in its slot, Expire moves it if it is still heard from then
+        m_entries[m_index[i] - 1].last = now.GetTimeStep ();
+        return false;
+      }
+
+    Account (now.GetTimeStep ());
+    uint32_t e;
+    if (m_free != NONE)
+      {
+        e = m_free;
+        m_free = m_entries[e].next;
+      }
+    else
+      {
+        e = m_entries.size ();
+        m_entries.push_back (Entry ());
+      }
+    m_entries[e].key = key;
+    m_entries[e].last = now.GetTimeStep ();
+    m_index[i] = e + 1;
+    Link (e, ExpiryTick (m_entries[e].last));
+
+    m_size++;
+    m_added++;
+    m_max = std::max (m_max, m_size);
+    if (2 * m_size > m_index.size ())
+      {
+        Grow ();
+      }
+    return true;
+  }
+
+  uint32_t
+  NeighborTable::Expire (Time now)
+  {
+    int64_t current = now.GetTimeStep () / m_granularity;
+    if (current <= m_tick)
+      {
+        return 0;
+      }
+    Account (now.GetTimeStep ());
+    uint32_t removed = 0;
+    // after a long pause every slot is emptied once, whatever it wrapped onto
+    int64_t end = std::min (current, m_tick + int64_t (m_wheel.size ()));
+    for (int64_t tick = m_tick + 1; tick <= end; tick++)
+      {
+        uint32_t &head = m_wheel[tick & (m_wheel.size () - 1)];
+        uint32_t e = head;
+        head = NONE;
+        while (e != NONE)
+          {
+            Entry &entry = m_entries[e];
+            uint32_t next = entry.next;
+            int64_t due = ExpiryTick (entry.last);
+            if (due <= current)
+              {
+                EraseIndex (Find (entry.key));
+                entry.key = FREE;
+                entry.next = m_free;
+                m_free = e;
+                removed++;
+              }
+            else
+              {
+                Link (e, due);
+              }
+            e = next;
+          }
+      }
+    m_tick = current;
+    m_size -= removed;
+    m_expired += removed;
+    return removed;
+  }
+
+  Time
+  NeighborTable::GetLastBeacon (Mac48Address addr) const
+  {
+    uint32_t i = Find (Key (addr));
+    if (!m_index[i])
+      {
+        return Seconds (-1);
+      }
+    return TimeStep (m_entries[m_index[i] - 1].last);
+  }
+
+  uint32_t
+  NeighborTable::GetSize () const
+  {
+    return m_size;
+  }
+
+  uint32_t
+  NeighborTable::GetMaxDegree () const
+  {
+    return m_max;
+  }
+
+  double
+  NeighborTable::GetMeanDegree (Time now) const
+  {
+    int64_t span = now.GetTimeStep () - m_since;
+    if (span <= 0)
+      {
+        return m_size;
+      }
+    return (m_integral + double (m_size) * (now.GetTimeStep () - m_changed)) / span;
+  }
+
+  uint64_t
+  NeighborTable::GetAdded () const
+  {
+    return m_added;
+  }
+
+  uint64_t
+  NeighborTable::GetExpired () const
+  {
+    return m_expired;
+  }
+
+  std::vector<NeighborInformation>
+  NeighborTable::GetNeighbors () const
+  {
+    std::vector<NeighborInformation> neighbors;
+    neighbors.reserve (m_size);
+    for (const Entry &entry : m_entries)
+      {
+        if (entry.key == FREE)
+          {
+            continue;
+          }
+        uint8_t buffer[6];
+        for (uint32_t i = 0; i < 6; i++)
+          {
+            buffer[i] = entry.key >> (8 * (5 - i));
+          }
+        NeighborInformation info;
+        info.neighbor_mac.CopyFrom (buffer);
+        info.last_beacon = TimeStep (entry.last);
+        neighbors.push_back (info);
+      }
+    return neighbors;
+  }
+}
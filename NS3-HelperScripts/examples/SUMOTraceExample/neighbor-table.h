@@ -0,0 +1,130 @@
+#ifndef SUMOTRACEEXAMPLE_NEIGHBOR_TABLE_H
+#define SUMOTRACEEXAMPLE_NEIGHBOR_TABLE_H
+#include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+    /** \brief A struct to represent information about this node's neighbors. I chose MAC address and the time last message was received form that node
+     * The time 'last_beacon' is used to determine whether we should remove the neighbor from the list.
+     */
+    typedef struct
+    {
+        Mac48Address neighbor_mac;
+        Time last_beacon;
+    } NeighborInformation;
+
+    /** \brief The neighbors of a node, with O(1) updates, expiry on a timing wheel and degree statistics.
+     *
+     * Neighbors are found by MAC address in an open addressing hash table, so hearing a beacon is a hash,
+     * a probe or two and a store. A neighbor expires timeout after its last beacon. Expiry runs on a
+     * timing wheel of one slot per granularity: a neighbor waits in the slot of its expiry, and Expire
+     * empties the slots time has passed in one go. A beacon does not move its neighbor; a neighbor that
+     * was heard again is moved to its new slot when its old one is emptied, at most once per timeout.
+     * Neighbors expire up to one granularity late.
+     *
+     * The number of neighbors is kept, and so are the maximum and the time average of it (the degree of
+     * the node), each updated in O(1) when a neighbor is added or expires.
+     */
+    class NeighborTable
+    {
+        public:
+            /**
+             * \param timeout how long a neighbor is kept after its last beacon
+             * \param granularity the time one slot of the wheel covers, how often Expire is worth calling
+             */
+            NeighborTable (Time timeout = Seconds (5), Time granularity = Seconds (1));
+
+            /** \brief Record a beacon from a neighbor
+             * \return true if it is a new neighbor
+             */
+            bool Update (Mac48Address addr, Time now);
+
+            /** \brief Remove every neighbor whose timeout has passed
+             * \return the number of neighbors removed
+             */
+            uint32_t Expire (Time now);
+
+            /** \brief Forget every neighbor and restart the statistics
+             */
+            void Clear (Time now);
+
+            /** \return the last beacon of a neighbor, or a negative time if it is not one
+             */
+            Time GetLastBeacon (Mac48Address addr) const;
+
+            /** \return the number of neighbors
+             */
+            uint32_t GetSize () const;
+
+            /** \return the largest number of neighbors since the last Clear
+             */
+            uint32_t GetMaxDegree () const;
+
+            /** \return the number of neighbors averaged over the time since the last Clear
+             */
+            double GetMeanDegree (Time now) const;
+
+            /** \return the neighbors added since the last Clear
+             */
+            uint64_t GetAdded () const;
+
+            /** \return the neighbors expired since the last Clear
+             */
+            uint64_t GetExpired () const;
+
+            /** \return a copy of the neighbors, in no particular order
+             */
+            std::vector<NeighborInformation> GetNeighbors () const;
+
+            void SetTimeout (Time timeout);
+
+        private:
+            static constexpr uint32_t NONE = UINT32_MAX;
+            static constexpr uint64_t FREE = UINT64_MAX;
+
+            struct Entry
+            {
+                uint64_t key; /**< the 48 bits of the address, FREE for a free entry */
+                int64_t last; /**< last beacon, in time steps */
+                uint32_t next; /**< in the list of its wheel slot, or of free entries */
+            };
+
+            static uint64_t Key (Mac48Address addr);
+            /** \return the index in m_index of a key, or of the empty cell it would go to */
+            uint32_t Find (uint64_t key) const;
+            void Grow ();
+            /** \brief Delete the cell i of m_index, shifting back the cells after it */
+            void EraseIndex (uint32_t i);
+            /** \return the wheel tick of the expiry of a beacon: the first tick at or after it */
+            int64_t ExpiryTick (int64_t last) const;
+            void Link (uint32_t entry, int64_t tick);
+            /** \brief Size the wheel for the timeout and put every neighbor in its slot */
+            void BuildWheel ();
+            /** \brief Account for the degree up to now, before it changes */
+            void Account (int64_t now);
+
+            int64_t m_timeout; /**< in time steps */
+            int64_t m_granularity; /**< in time steps */
+
+            std::vector<Entry> m_entries;
+            uint32_t m_free; /**< first free entry */
+            std::vector<uint32_t> m_index; /**< open addressing, entry + 1 or 0 for an empty cell */
+            uint32_t m_shift; /**< 64 - log2 of the size of m_index */
+
+            std::vector<uint32_t> m_wheel; /**< first entry of every slot */
+            int64_t m_tick; /**< the last tick Expire went through */
+
+            uint32_t m_size;
+            uint32_t m_max;
+            uint64_t m_added;
+            uint64_t m_expired;
+            double m_integral; /**< of the degree, in neighbor time steps */
+            int64_t m_since; /**< last Clear */
+            int64_t m_changed; /**< last change of the degree */
+    };
+}
+
+#endif
@@ -0,0 +1,225 @@
+#include "node-pool.h"
+#include "custom-application.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/wave-net-device.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+
+namespace ns3
+{
+  NS_LOG_COMPONENT_DEFINE ("NodePool");
+
+  namespace
+  {
+    Ptr<WaveNetDevice>
+    GetWaveDevice (Ptr<Node> node)
+    {
+      for (uint32_t i = 0; i < node->GetNDevices (); i++)
+        {
+          Ptr<WaveNetDevice> device = DynamicCast<WaveNetDevice> (node->GetDevice (i));
+          if (device)
+            {
+              return device;
+            }
+        }
+      NS_FATAL_ERROR ("There's no WaveNetDevice in pooled node " << node->GetId ());
+    }
+
+    Ptr<CustomApplication>
+    GetCustomApplication (Ptr<Node> node)
+    {
+      for (uint32_t i = 0; i < node->GetNApplications (); i++)
+        {
+          Ptr<CustomApplication> app = DynamicCast<CustomApplication> (node->GetApplication (i));
+          if (app)
+            {
+              return app;
+            }
+        }
+      NS_FATAL_ERROR ("There's no CustomApplication in pooled node " << node->GetId ());
+    }
+
+    /** \return the delay until a time of the trace, zero if it is already past */
+    Time
+    Until (double at)
+    {
+      Time delay = Seconds (at) - Simulator::Now ();
+      return delay.IsStrictlyPositive () ? delay : Seconds (0);
+    }
+  }
+
+  NodePool::NodePool (Ns2NodeUtility &trace, Time guard)
+    : m_slots (0),
+      m_next (0)
+  {
+    m_vehicle_index.resize (trace.GetNodeIdRange (), UINT32_MAX);
+    for (uint32_t id = 0; id < trace.GetNodeIdRange (); id++)
+      {
+        if (trace.HasNode (id))
+          {
+            Vehicle v;
+            v.id = id;
+            v.entry = trace.GetEntryTimeForNode (id);
+            v.exit = trace.GetExitTimeForNode (id);
+            v.slot = 0;
+            m_vehicles.push_back (v);
+          }
+      }
+    Plan (guard);
+  }
+
+  NodePool::NodePool (SumoFcdImporter &trace, Time guard)
+    : m_slots (0),
+      m_next (0)
+  {
+    m_vehicle_index.resize (trace.GetNodeIdRange (), UINT32_MAX);
+    for (uint32_t id = 0; id < trace.GetNodeIdRange (); id++)
+      {
+        Vehicle v;
+        v.id = id;
+        v.entry = trace.GetEntryTimeForNode (id);
+        v.exit = trace.GetExitTimeForNode (id);
+        v.slot = 0;
+        m_vehicles.push_back (v);
+      }
+    Plan (guard);
+  }
+
+  void
+  NodePool::Plan (Time guard)
+  {
+    std::stable_sort (m_vehicles.begin (), m_vehicles.end (),
+                      [] (const Vehicle &a, const Vehicle &b) { return a.entry < b.entry; });
+
+    // a vehicle is in the trace from its first to its last timestamp, both
+    // included, so a node is free for the next vehicle strictly after that
+    typedef std::pair<double, uint32_t> FreeSlot; // time the node is free from, slot
+    std::priority_queue<FreeSlot, std::vector<FreeSlot>, std::greater<FreeSlot> > freed;
+    double rest = guard.GetSeconds ();
+    for (uint32_t i = 0; i < m_vehicles.size (); i++)
+      {
+        Vehicle &v = m_vehicles[i];
+        if (!freed.empty () && freed.top ().first < v.entry)
+          {
+            v.slot = freed.top ().second;
+            freed.pop ();
+          }
+        else
+          {
+            v.slot = m_slots++;
+          }
+        freed.push (FreeSlot (v.exit + rest, v.slot));
+        m_vehicle_index[v.id] = i;
+      }
+    NS_LOG_INFO (m_vehicles.size () << " vehicles on " << m_slots << " nodes");
+  }
+
+  uint32_t
+  NodePool::GetNNodes ()
+  {
+    return m_slots;
+  }
+
+  uint32_t
+  NodePool::GetNVehicles ()
+  {
+    return m_vehicles.size ();
+  }
+
+  void
+  NodePool::Install (NodeContainer &nodes)
+  {
+    NS_ABORT_MSG_IF (nodes.GetN () != m_slots, "The pool needs " << m_slots << " nodes, not " << nodes.GetN ());
+    m_nodes = nodes;
+    // after the nodes are initialized, before any vehicle enters
+    for (uint32_t slot = 0; slot < m_slots; slot++)
+      {
+        Simulator::Schedule (Seconds (0), &NodePool::ParkSlot, this, slot);
+      }
+    if (!m_vehicles.empty ())
+      {
+        Simulator::Schedule (Until (m_vehicles[0].entry), &NodePool::Enter, this);
+      }
+  }
+
+  std::vector<Ptr<Node> >
+  NodePool::GetVehicleNodes ()
+  {
+    std::vector<Ptr<Node> > vehicles (m_vehicle_index.size ());
+    for (uint32_t id = 0; id < vehicles.size (); id++)
+      {
+        vehicles[id] = GetNodeOfVehicle (id);
+      }
+    return vehicles;
+  }
+
+  Ptr<Node>
+  NodePool::GetNodeOfVehicle (uint32_t vehicle)
+  {
+    if (vehicle >= m_vehicle_index.size () || m_vehicle_index[vehicle] == UINT32_MAX)
+      {
+        return 0;
+      }
+    NS_ABORT_MSG_IF (m_nodes.GetN () != m_slots, "NodePool::Install must come first");
+    return m_nodes.Get (m_vehicles[m_vehicle_index[vehicle]].slot);
+  }
+
+  void
+  NodePool::Enter ()
+  {
+    uint32_t index = m_next++;
+    const Vehicle &v = m_vehicles[index];
+    Ptr<Node> node = m_nodes.Get (v.slot);
+    NS_LOG_INFO (Simulator::Now ().GetSeconds () << " vehicle " << v.id << " enters on node " << node->GetId ());
+
+    Activate (node);
+
+    Simulator::Schedule (Until (v.exit), &NodePool::Exit, this, index);
+    if (m_next < m_vehicles.size ())
+      {
+        Simulator::Schedule (Until (m_vehicles[m_next].entry), &NodePool::Enter, this);
+      }
+  }
+
+  void
+  NodePool::Exit (uint32_t index)
+  {
+    const Vehicle &v = m_vehicles[index];
+    NS_LOG_INFO (Simulator::Now ().GetSeconds () << " vehicle " << v.id << " exits node " << m_nodes.Get (v.slot)->GetId ());
+    ParkSlot (v.slot);
+  }
+
+  void
+  NodePool::ParkSlot (uint32_t slot)
+  {
+    Park (m_nodes.Get (slot));
+  }
+
+  void
+  NodePool::Activate (Ptr<Node> node)
+  {
+    Ptr<WaveNetDevice> device = GetWaveDevice (node);
+    device->SetAddress (Mac48Address::Allocate ());
+    device->GetPhys ()[0]->ResumeFromOff ();
+    GetCustomApplication (node)->Resume ();
+  }
+
+  void
+  NodePool::Park (Ptr<Node> node)
+  {
+    GetCustomApplication (node)->Suspend ();
+    Ptr<WaveNetDevice> device = GetWaveDevice (node);
+    device->GetPhys ()[0]->SetOffMode ();
+    // frames the vehicle queued must not go out with the next one
+    std::map<uint32_t, Ptr<OcbWifiMac> > macs = device->GetMacs ();
+    for (std::map<uint32_t, Ptr<OcbWifiMac> >::iterator it = macs.begin (); it != macs.end (); ++it)
+      {
+        it->second->Reset ();
+      }
+  }
+}
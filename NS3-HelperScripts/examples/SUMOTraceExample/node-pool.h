@@ -0,0 +1,100 @@
+#ifndef SUMOTRACEEXAMPLE_NODE_POOL_H
+#define SUMOTRACEEXAMPLE_NODE_POOL_H
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns2-node-utility.h"
+#include "sumo-fcd-importer.h"
+#include <vector>
+
+namespace ns3
+{
+    /** \brief Runs the vehicles of an ns-2 trace on as many nodes as there are vehicles in the trace at once.
+     *
+     * A day of traffic can have 100 times more vehicles than are ever on the road together. Instead of
+     * one node with its WaveNetDevice per vehicle, every vehicle borrows a node of the pool when it enters
+     * the trace and gives it back when it exits, so nodes, devices and setup time follow the peak
+     * concurrency. The node of every vehicle is planned before the simulation from Ns2NodeUtility:
+     * vehicles in order of entry take the node freed the earliest, which needs exactly as many nodes as
+     * the peak (the interval partitioning greedy).
+     *
+     * The nodes must have a WaveNetDevice and a CustomApplication. Between two vehicles a node is parked:
+     * its application is suspended and its PHY is off, so it neither sends nor receives. On entry it gets
+     * a new MAC address, so that its neighbors see a new vehicle, empty MAC queues and a resumed
+     * application. Ns2StreamMobilityHelper places it where the vehicle is.
+     */
+    class NodePool
+    {
+        public:
+            /** \brief Plan the node of every vehicle of the trace
+             * \param trace entry and exit times of the vehicles
+             * \param guard time a node stays parked between two vehicles
+             */
+            NodePool (Ns2NodeUtility &trace, Time guard = Seconds (0));
+
+            /** \brief Plan the node of every vehicle of SUMO floating car data
+             * \param trace entry and exit times of the vehicles
+             * \param guard time a node stays parked between two vehicles
+             */
+            NodePool (SumoFcdImporter &trace, Time guard = Seconds (0));
+
+            /** \return the number of nodes the pool needs, the peak number of vehicles in the trace at once
+             */
+            uint32_t GetNNodes ();
+
+            /** \return the vehicles of the trace
+             */
+            uint32_t GetNVehicles ();
+
+            /** \brief Park every node, then lend it to its vehicles as they enter and exit
+             * \param nodes GetNNodes() nodes with a WaveNetDevice and a CustomApplication
+             */
+            void Install (NodeContainer &nodes);
+
+            /** \return the node of every vehicle, indexed by the vehicle id of the trace and null for ids
+             * not in the trace, for Ns2StreamMobilityHelper::Install
+             */
+            std::vector<Ptr<Node> > GetVehicleNodes ();
+
+            /** \return the node a vehicle is planned on, null if the vehicle is not in the trace
+             */
+            Ptr<Node> GetNodeOfVehicle (uint32_t vehicle);
+
+            /** \brief Take a parked node out for a new vehicle: new MAC address, PHY on, application resumed
+             */
+            static void Activate (Ptr<Node> node);
+
+            /** \brief Park a node: application suspended, PHY off, MAC queues flushed
+             */
+            static void Park (Ptr<Node> node);
+
+        private:
+            struct Vehicle
+            {
+                uint32_t id; /**< node id in the trace */
+                double entry;
+                double exit;
+                uint32_t slot; /**< index of its node in m_nodes */
+            };
+
+            /** \brief Give every vehicle the node freed the earliest, or a new one
+             */
+            void Plan (Time guard);
+            /** \brief Take the node of the next vehicle to enter, then schedule the entry after it
+             */
+            void Enter ();
+            /** \brief Give the node of a vehicle back
+             */
+            void Exit (uint32_t index);
+            /** \brief Park the node of a slot
+             */
+            void ParkSlot (uint32_t slot);
+
+            std::vector<Vehicle> m_vehicles; /**< in order of entry */
+            std::vector<uint32_t> m_vehicle_index; /**< by vehicle id, index in m_vehicles */
+            uint32_t m_slots; /**< nodes the plan needs */
+            NodeContainer m_nodes;
+            uint32_t m_next; /**< index in m_vehicles of the next vehicle to enter */
+    };
+}
+
+#endif
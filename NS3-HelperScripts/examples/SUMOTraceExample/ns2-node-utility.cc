@@ -1,68 +1,244 @@
 #include "ns2-node-utility.h"
+#include "ns3/abort.h"
 
-#include <regex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
 
 namespace ns3
 {
-  Ns2NodeUtility::Ns2NodeUtility (std::string name)
+  namespace
+  {
+    bool
+    Skip (const char *&p, const char *end, const char *literal)
+    {
+      size_t n = std::strlen (literal);
+      if (static_cast<size_t> (end - p) < n || std::memcmp (p, literal, n) != 0)
+        {
+          return false;
+        }
+      p += n;
+      return true;
+    }
+
+    void
+    SkipSpaces (const char *&p, const char *end)
+    {
+      while (p < end && (*p == ' ' || *p == '\t'))
+        {
+          ++p;
+        }
+    }
+
+    /** Parse an unsigned decimal number, with an optional fraction */
+    bool
+    ParseTime (const char *&p, const char *end, double &value)
+    {
+      const char *start = p;
+      double v = 0;
+      while (p < end && *p >= '0' && *p <= '9')
+        {
+          v = v * 10 + (*p++ - '0');
+        }
+      if (p < end && *p == '.')
+        {
+          double scale = 0.1;
+          for (++p; p < end && *p >= '0' && *p <= '9'; ++p, scale *= 0.1)
+            {
+              v += (*p - '0') * scale;
+            }
+        }
+      value = v;
+      return p != start;
+    }
+
+    bool
+    ParseId (const char *&p, const char *end, uint32_t &id)
+    {
+      const char *start = p;
+      uint32_t v = 0;
+      while (p < end && *p >= '0' && *p <= '9')
+        {
+          v = v * 10 + (*p++ - '0');
+        }
+      id = v;
+      return p != start;
+    }
+  }
+
+  Ns2NodeUtility::Ns2NodeUtility (std::string name, uint32_t threads)
+    : m_nodes (0)
   {
     m_file_name = name;
-    m_input_file.open(m_file_name);
 
-    std::string line;
+    int fd = open (m_file_name.c_str (), O_RDONLY);
+    NS_ABORT_MSG_IF (fd < 0, "Cannot open the ns-2 trace " << m_file_name);
+    struct stat st;
+    NS_ABORT_MSG_IF (fstat (fd, &st) != 0, "Cannot stat the ns-2 trace " << m_file_name);
+    size_t size = st.st_size;
+    const char *data = nullptr;
+    if (size > 0)
+      {
+        void *map = mmap (nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        NS_ABORT_MSG_IF (map == MAP_FAILED, "Cannot map the ns-2 trace " << m_file_name);
+        madvise (map, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *> (map);
+      }
+    close (fd);
 
-    std::vector <uint32_t> node_ids;
+    if (threads == 0)
+      {
+        threads = std::max (1u, std::thread::hardware_concurrency ());
+      }
+    // chunks of less than a megabyte are not worth a thread
+    threads = std::max<size_t> (1, std::min<size_t> (threads, size >> 20));
+
+    // cut the file at line starts, then merge the chunks in file order so that
+    // the entry time is the first event of a node and the exit time its last
+    std::vector<const char *> cuts (1, data);
+    for (uint32_t i = 1; i < threads; ++i)
+      {
+        const char *cut = std::max (cuts.back (), data + size * i / threads);
+        const char *newline = static_cast<const char *> (std::memchr (cut, '\n', data + size - cut));
+        cuts.push_back (newline ? newline + 1 : data + size);
+      }
+    cuts.push_back (data + size);
+
+    std::vector<NodeTimes> chunks (threads);
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < threads; ++i)
+      {
+        workers.push_back (std::thread (&Ns2NodeUtility::ParseChunk, cuts[i], cuts[i + 1], std::ref (chunks[i])));
+      }
+    ParseChunk (cuts[0], cuts[1], chunks[0]);
+    for (std::thread &worker : workers)
+      {
+        worker.join ();
+      }
+    if (data)
+      {
+        munmap (const_cast<char *> (data), size);
+      }
 
-    while (std::getline (m_input_file, line))
+    m_node_times = std::move (chunks[0]);
+    for (uint32_t c = 1; c < threads; ++c)
       {
-	std::smatch sm;
-	std::regex r("\\$ns_ at (\\d*.\\d) \"\\$node_\\((\\d*)\\)");
-	if (std::regex_search(line, sm, r))
-	  {
-	    //std::cout << "MATCH!" << std::endl;
-
-	    uint32_t id = std::stoi(sm[2]);
-	    double new_latest = std::stof(sm[1]);
-
-	    if ( std::find (node_ids.begin(), node_ids.end(), id) != node_ids.end())
-	      {
-		double entry_time = std::get<0> (m_node_times [id]);
-		m_node_times [id] = std::make_pair(entry_time, new_latest);
-	      }
-	    else
-	      {
-		m_node_times [id] = std::make_pair(new_latest, new_latest);
-	      }
-	    node_ids.push_back(id);
-	  }
-	else
-	  {
-	    //std::cout << "No Match!" << std::endl;
-	  }
+        NodeTimes &chunk = chunks[c];
+        if (chunk.entry.size () > m_node_times.entry.size ())
+          {
+            m_node_times.entry.resize (chunk.entry.size (), NAN);
+            m_node_times.exit.resize (chunk.entry.size (), NAN);
+          }
+        for (uint32_t id = 0; id < chunk.entry.size (); ++id)
+          {
+            if (std::isnan (chunk.entry[id]))
+              {
+                continue;
+              }
+            if (std::isnan (m_node_times.entry[id]))
+              {
+                m_node_times.entry[id] = chunk.entry[id];
+              }
+            m_node_times.exit[id] = chunk.exit[id];
+          }
+      }
+    for (double entry : m_node_times.entry)
+      {
+        m_nodes += !std::isnan (entry);
+      }
+  }
+
+  void
+  Ns2NodeUtility::ParseChunk (const char *begin, const char *end, NodeTimes &times)
+  {
+    // $ns_ at <time> "$node_(<id>) ...
+    const char *p = begin;
+    while (p < end)
+      {
+        const char *eol = static_cast<const char *> (std::memchr (p, '\n', end - p));
+        if (!eol)
+          {
+            eol = end;
+          }
+        double time;
+        uint32_t id;
+        SkipSpaces (p, eol);
+        if (Skip (p, eol, "$ns_"))
+          {
+            SkipSpaces (p, eol);
+            if (Skip (p, eol, "at") && (SkipSpaces (p, eol), ParseTime (p, eol, time)))
+              {
+                SkipSpaces (p, eol);
+                if (Skip (p, eol, "\"$node_(") && ParseId (p, eol, id) && Skip (p, eol, ")"))
+                  {
+                    if (id >= times.entry.size ())
+                      {
+                        times.entry.resize (id + 1, NAN);
+                        times.exit.resize (id + 1, NAN);
+                      }
+                    if (std::isnan (times.entry[id]))
+                      {
+                        times.entry[id] = time;
+                      }
+                    times.exit[id] = time;
+                  }
+              }
+          }
+        p = eol + 1;
       }
   }
+
   uint32_t
   Ns2NodeUtility::GetNNodes ()
   {
-    return m_node_times.size();
+    return m_nodes;
+  }
+  bool
+  Ns2NodeUtility::HasNode (uint32_t nodeId)
+  {
+    return nodeId < m_node_times.entry.size () && !std::isnan (m_node_times.entry[nodeId]);
+  }
+  uint32_t
+  Ns2NodeUtility::GetNodeIdRange ()
+  {
+    return m_node_times.entry.size ();
   }
   double
   Ns2NodeUtility::GetEntryTimeForNode (uint32_t nodeId)
   {
-    return std::get<0>(m_node_times [nodeId]);
+    if (nodeId >= m_node_times.entry.size () || std::isnan (m_node_times.entry[nodeId]))
+      {
+        return 0;
+      }
+    return m_node_times.entry[nodeId];
   }
   double
   Ns2NodeUtility::GetExitTimeForNode (uint32_t nodeId)
   {
-    return std::get<1>(m_node_times [nodeId]);
+    if (nodeId >= m_node_times.exit.size () || std::isnan (m_node_times.exit[nodeId]))
+      {
+        return 0;
+      }
+    return m_node_times.exit[nodeId];
   }
   double
   Ns2NodeUtility::GetSimulationTime()
   {
     double time = 0;
 
-    for (uint32_t i=0 ; i<m_node_times.size(); i++)
-      time = std::max ( time,  std::get<1>(m_node_times[i]) );
+    for (double exit : m_node_times.exit)
+      {
+        if (!std::isnan (exit))
+          {
+            time = std::max (time, exit);
+          }
+      }
 
     return time;
   }
@@ -71,10 +247,12 @@ namespace ns3
   void
   Ns2NodeUtility::PrintInformation()
   {
-    uint32_t s = m_node_times.size();
-    for (uint32_t i=0 ; i<s; i++)
+    for (uint32_t i=0 ; i<m_node_times.entry.size(); i++)
       {
-	std::cout << "Node " << i << " started " << std::get<0>(m_node_times[i]) << " and ended " << std::get<1>(m_node_times[i]) << std::endl;
+        if (!std::isnan (m_node_times.entry[i]))
+          {
+            std::cout << "Node " << i << " started " << m_node_times.entry[i] << " and ended " << m_node_times.exit[i] << std::endl;
+          }
       }
   }
 }
@@ -11,15 +11,19 @@
 #include <iostream>
 #include <sstream>
 #include <string>
-#include <fstream>
-#include <map>
+#include <vector>
 
 namespace ns3
 {
   class Ns2NodeUtility
   {
   public:
-    Ns2NodeUtility (std::string file_name);
+    /**
+     * Reads the trace in a single pass over the mapped file.
+     * \param file_name the ns-2 mobility trace
+     * \param threads number of chunks of the file parsed in parallel, 0 for one per core
+     */
+    Ns2NodeUtility (std::string file_name, uint32_t threads = 1);
     /** Prints information. For debugging
     */
     void PrintInformation ();
@@ -27,6 +31,15 @@ namespace ns3
      * \return the number of nodes in the ns-2 trace
      */
     uint32_t GetNNodes ();
+    /**
+     * \param nodeId of the node.
+     * \return whether the node appears in the ns-2 trace, ids may have gaps
+     */
+    bool HasNode (uint32_t nodeId);
+    /**
+     * \return one more than the largest node id in the ns-2 trace
+     */
+    uint32_t GetNodeIdRange ();
     /**
      * \param nodeId of the node.
      * \return the time the node has entered into the ns-2 simulation trace in double.
@@ -43,10 +56,19 @@ namespace ns3
     double GetSimulationTime ();
 
   private:
-    std::string m_file_name; /**< File name of the ns-2 mobility trace */
-    std::ifstream m_input_file; /**< input file stream object */
-    std::map <uint32_t, std::pair<double, double>> m_node_times; /**< a map to keep track of nodes entry & exit times. */
+    /** Entry and exit times of the nodes seen in one chunk of the trace, indexed by node id */
+    struct NodeTimes
+    {
+      std::vector<double> entry; /**< time of the first event of a node, NaN if it has none */
+      std::vector<double> exit; /**< time of the last event of a node */
+    };
 
+    /** Parse the lines in [begin, end), which must start at the beginning of a line */
+    static void ParseChunk (const char *begin, const char *end, NodeTimes &times);
+
+    std::string m_file_name; /**< File name of the ns-2 mobility trace */
+    NodeTimes m_node_times; /**< nodes entry & exit times, indexed by node id */
+    uint32_t m_nodes; /**< nodes that appear in the trace */
   };
 }
 
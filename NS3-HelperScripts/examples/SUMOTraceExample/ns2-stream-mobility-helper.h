@@ -0,0 +1,377 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef NS2_STREAM_MOBILITY_HELPER_H
+#define NS2_STREAM_MOBILITY_HELPER_H
+
+#include "ns3/abort.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/event-id.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/nstime.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+#include "ns3/vector.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief The cursor of an ns-2 trace that Ns2StreamMobilityHelper installed
+ *
+ * Every refill reads the trace up to the end of the next window and
+ * schedules its waypoints, then schedules the next refill at the end of
+ * the window. It keeps one waypoint per node and one line of the trace,
+ * so memory does not grow with the length of the trace, and the event
+ * queue holds the waypoints of one window and one stop per moving node.
+ * The movements are those of Ns2MobilityHelper: setdest moves the node in
+ * a straight line at the given speed and stops it on arrival, and a new
+ * setdest before arrival starts from where the node is by then.
+ *
+ * Several vehicles of the trace may drive one node in turn, as a pool of
+ * nodes recycled between vehicles does: the node is placed where a vehicle
+ * is on its first timed command, and the pending stop of the vehicle it
+ * had before is cancelled.
+ */
+class Ns2MobilityStream : public SimpleRefCount<Ns2MobilityStream>
+{
+public:
+  /**
+   * \param filename the ns-2 mobility trace
+   * \param window how far ahead the waypoints are scheduled
+   * \param vehicles the node $node_(i) drives at index i, null for none
+   */
+  Ns2MobilityStream (std::string filename, Time window, const std::vector<Ptr<Node> > &vehicles)
+    : m_filename (filename),
+      m_window (window.GetSeconds ()),
+      m_horizon (0),
+      m_pending (false),
+      m_commands (0)
+  {
+    NS_ABORT_MSG_IF (m_window <= 0, "Ns2MobilityStream needs a positive window");
+    m_file.open (filename);
+    NS_ABORT_MSG_IF (!m_file, "Cannot open the ns-2 trace " << filename);
+    m_nodes.resize (vehicles.size ());
+    m_owner.resize (NodeList::GetNNodes (), 0);
+    std::vector<uint32_t> drivers (NodeList::GetNNodes (), 0);
+    for (uint32_t i = 0; i < m_nodes.size (); ++i)
+      {
+        Ptr<Node> node = vehicles[i];
+        if (!node)
+          {
+            continue;
+          }
+        Ptr<MobilityModel> model = node->GetObject<MobilityModel> ();
+        if (!model)
+          {
+            model = CreateObject<ConstantVelocityMobilityModel> ();
+            node->AggregateObject (model);
+          }
+        m_nodes[i].model = DynamicCast<ConstantVelocityMobilityModel> (model);
+        NS_ABORT_MSG_IF (!m_nodes[i].model, "Node " << node->GetId () << " already has a mobility model that is not ConstantVelocity");
+        m_nodes[i].node = node->GetId ();
+        m_nodes[i].start = m_nodes[i].model->GetPosition ();
+        m_nodes[i].final = m_nodes[i].start;
+        m_nodes[i].travelStart = 0;
+        m_nodes[i].arrival = 0;
+        drivers[m_nodes[i].node]++;
+      }
+    // initial positions hold from the start wherever they are in the trace,
+    // one pass that keeps nothing but the positions; a node shared between
+    // vehicles takes the position of each when it enters
+    while (ReadCommand ())
+      {
+        if (!m_command.timed)
+          {
+            Waypoint &w = m_nodes[m_command.node];
+            w.start = w.final = WithCoordinate (w.final, m_command.coordinate, m_command.values[0]);
+            if (drivers[w.node] == 1)
+              {
+                w.model->SetPosition (w.final);
+              }
+          }
+      }
+    m_file.clear ();
+    m_file.seekg (0);
+  }
+
+  /// \brief Apply the commands of the trace up to the end of the next window
+  void Refill (void)
+  {
+    m_horizon = std::max (m_horizon, Simulator::Now ().GetSeconds ()) + m_window;
+    while (m_pending || ReadCommand ())
+      {
+        if (m_command.timed && m_command.at >= m_horizon)
+          {
+            m_pending = true;
+            Simulator::Schedule (Seconds (m_horizon) - Simulator::Now (), &Ns2MobilityStream::Refill, Ptr<Ns2MobilityStream> (this));
+            return;
+          }
+        m_pending = false;
+        Apply ();
+      }
+    m_file.close ();
+  }
+
+  /// \return the commands applied so far
+  uint64_t GetCommands (void) const
+  {
+    return m_commands;
+  }
+
+private:
+  struct Waypoint
+  {
+    Ptr<ConstantVelocityMobilityModel> model;
+    uint32_t node;     ///< id of the node the model is aggregated to
+    Vector start;      ///< position at travelStart
+    Vector speed;
+    Vector final;      ///< position on arrival
+    double travelStart;
+    double arrival;
+    EventId stop;
+  };
+
+  /// One line of the trace
+  struct Command
+  {
+    bool timed;        ///< $ns_ at <at> "..."
+    double at;
+    uint32_t node;
+    bool setdest;      ///< else set of coordinate
+    char coordinate;   ///< 'X', 'Y' or 'Z'
+    double values[3];  ///< x y speed of setdest, value of set
+  };
+
+  static bool Skip (const char *&p, const char *literal)
+  {
+    while (*p == ' ' || *p == '\t')
+      {
+        ++p;
+      }
+    size_t n = std::strlen (literal);
+    if (std::strncmp (p, literal, n) != 0)
+      {
+        return false;
+      }
+    p += n;
+    return true;
+  }
+
+  static bool Number (const char *&p, double &value)
+  {
+    char *end;
+    value = std::strtod (p, &end);
+    bool parsed = end != p;
+    p = end;
+    return parsed;
+  }
+
+  /// \return false at the end of the trace, else parse the next command into m_command
+  bool ReadCommand (void)
+  {
+    while (std::getline (m_file, m_line))
+      {
+        const char *p = m_line.c_str ();
+        Command &c = m_command;
+        c.timed = Skip (p, "$ns_");
+        if (c.timed && !(Skip (p, "at") && Number (p, c.at) && Skip (p, "\"")))
+          {
+            continue;
+          }
+        double id;
+        if (!Skip (p, "$node_(") || !Number (p, id) || !Skip (p, ")") || id < 0 || id >= m_nodes.size ()
+            || !m_nodes[uint32_t (id)].model)
+          {
+            continue;
+          }
+        c.node = id;
+        c.setdest = Skip (p, "setdest");
+        if (c.setdest)
+          {
+            if (c.timed && Number (p, c.values[0]) && Number (p, c.values[1]) && Number (p, c.values[2]))
+              {
+                return true;
+              }
+            continue;
+          }
+        if (Skip (p, "set"))
+          {
+            while (*p == ' ' || *p == '\t')
+              {
+                ++p;
+              }
+            c.coordinate = *p;
+            if ((c.coordinate == 'X' || c.coordinate == 'Y' || c.coordinate == 'Z')
+                && p[1] == '_' && (p += 2, Number (p, c.values[0])))
+              {
+                return true;
+              }
+          }
+      }
+    return false;
+  }
+
+  /// \return the position of a node at time at, from its last waypoint
+  static Vector PositionAt (const Waypoint &w, double at)
+  {
+    if (at >= w.arrival)
+      {
+        return w.final;
+      }
+    double t = std::max (0.0, at - w.travelStart);
+    return Vector (w.start.x + w.speed.x * t, w.start.y + w.speed.y * t, w.start.z + w.speed.z * t);
+  }
+
+  static Vector WithCoordinate (Vector v, char coordinate, double value)
+  {
+    (coordinate == 'X' ? v.x : coordinate == 'Y' ? v.y : v.z) = value;
+    return v;
+  }
+
+  static void Place (Ptr<ConstantVelocityMobilityModel> model, Vector position)
+  {
+    model->SetVelocity (Vector (0, 0, 0));
+    model->SetPosition (position);
+  }
+
+  /// \return the delay until at, zero if it is already past
+  static Time Until (double at)
+  {
+    Time delay = Seconds (at) - Simulator::Now ();
+    return delay.IsStrictlyPositive () ? delay : Seconds (0);
+  }
+
+  void Apply (void)
+  {
+    const Command &c = m_command;
+    Waypoint &w = m_nodes[c.node];
+    ++m_commands;
+    if (!c.timed)
+      {
+        // initial positions were applied by the constructor
+        return;
+      }
+    Vector from = PositionAt (w, c.at);
+    if (w.arrival > c.at)
+      {
+        w.stop.Cancel ();
+      }
+    uint32_t &owner = m_owner[w.node];
+    if (owner != c.node + 1)
+      {
+        // the vehicle enters its node, which may still be moving for another
+        if (owner)
+          {
+            m_nodes[owner - 1].stop.Cancel ();
+          }
+        owner = c.node + 1;
+        Simulator::Schedule (Until (c.at), &Ns2MobilityStream::Place, w.model, from);
+      }
+    w.start = from;
+    w.final = from;
+    w.speed = Vector (0, 0, 0);
+    w.travelStart = c.at;
+    w.arrival = c.at;
+    if (!c.setdest)
+      {
+        w.final = w.start = WithCoordinate (from, c.coordinate, c.values[0]);
+        w.stop = Simulator::Schedule (Until (c.at), &Ns2MobilityStream::Place, w.model, w.final);
+        return;
+      }
+    double speed = c.values[2];
+    double distance = std::sqrt ((c.values[0] - from.x) * (c.values[0] - from.x)
+                                 + (c.values[1] - from.y) * (c.values[1] - from.y));
+    if (speed <= 0 || distance == 0)
+      {
+        w.stop = Simulator::Schedule (Until (c.at), &ConstantVelocityMobilityModel::SetVelocity, w.model, Vector (0, 0, 0));
+        return;
+      }
+    double time = distance / speed;
+    w.speed = Vector ((c.values[0] - from.x) / time, (c.values[1] - from.y) / time, 0);
+    w.final = Vector (c.values[0], c.values[1], from.z);
+    w.arrival = c.at + time;
+    Simulator::Schedule (Until (c.at), &ConstantVelocityMobilityModel::SetVelocity, w.model, w.speed);
+    w.stop = Simulator::Schedule (Until (w.arrival), &Ns2MobilityStream::Place, w.model, w.final);
+  }
+
+  std::string m_filename;
+  std::ifstream m_file;
+  std::string m_line;            ///< the last line read, its capacity reused
+  double m_window;               ///< seconds scheduled ahead
+  double m_horizon;              ///< commands before this time are scheduled
+  bool m_pending;                ///< m_command is read but past the horizon
+  Command m_command;
+  std::vector<Waypoint> m_nodes; ///< by vehicle, the i of $node_(i)
+  std::vector<uint32_t> m_owner; ///< by node id, 1 + the vehicle that drove it last, 0 for none
+  uint64_t m_commands;
+};
+
+/**
+ * \brief Ns2MobilityHelper for traces of any length
+ *
+ * Ns2MobilityHelper reads the whole trace and schedules every waypoint
+ * before the simulation starts; this helper schedules the waypoints of the
+ * next window only, see Ns2MobilityStream. The trace must be sorted by
+ * time, as SUMO writes it: a command found after the end of its window is
+ * applied at once. Initial positions ($node_(i) set X_ ...) are read by a
+ * first pass over the trace, which keeps nothing else.
+ *
+ * Install (vehicles) lets nodes be shared: a pool that recycles a node
+ * between vehicles whose times in the trace do not overlap passes the
+ * node of every vehicle.
+ */
+class Ns2StreamMobilityHelper
+{
+public:
+  /**
+   * \param filename the ns-2 mobility trace
+   * \param window how far ahead the waypoints are scheduled
+   */
+  Ns2StreamMobilityHelper (std::string filename, Time window = Seconds (5))
+    : m_filename (filename),
+      m_window (window)
+  {
+  }
+
+  /**
+   * \brief Give every node of NodeList a ConstantVelocityMobilityModel
+   * driven by the trace, node i by $node_(i)
+   * \return the cursor of the trace, which the refill events keep alive
+   */
+  Ptr<Ns2MobilityStream> Install (void) const
+  {
+    std::vector<Ptr<Node> > vehicles;
+    for (uint32_t i = 0; i < NodeList::GetNNodes (); ++i)
+      {
+        vehicles.push_back (NodeList::GetNode (i));
+      }
+    return Install (vehicles);
+  }
+
+  /**
+   * \brief Drive the node at index i by $node_(i), the same node may drive
+   * several vehicles one after the other
+   * \param vehicles the node of every vehicle, null for none
+   * \return the cursor of the trace, which the refill events keep alive
+   */
+  Ptr<Ns2MobilityStream> Install (const std::vector<Ptr<Node> > &vehicles) const
+  {
+    Ptr<Ns2MobilityStream> stream = Create<Ns2MobilityStream> (m_filename, m_window, vehicles);
+    stream->Refill ();
+    return stream;
+  }
+
+private:
+  std::string m_filename;
+  Time m_window;
+};
+
+} // namespace ns3
+
+#endif /* NS2_STREAM_MOBILITY_HELPER_H */
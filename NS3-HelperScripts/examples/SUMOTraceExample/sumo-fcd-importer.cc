@@ -0,0 +1,532 @@
+#include "sumo-fcd-importer.h"
+#include "ns3/abort.h"
+#include "ns3/node-list.h"
+#include "ns3/waypoint-mobility-model.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace ns3
+{
+  namespace
+  {
+    bool
+    Skip (const char *&p, const char *end, const char *literal)
+    {
+      size_t n = std::strlen (literal);
+      if (static_cast<size_t> (end - p) < n || std::memcmp (p, literal, n) != 0)
+        {
+          return false;
+        }
+      p += n;
+      return true;
+    }
+
+    bool
+    IsSpace (char c)
+    {
+      return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    /** Parse a decimal number with an optional sign, fraction and exponent, as SUMO writes them */
+    bool
+    ParseDouble (const char *p, const char *end, double &value)
+    {
+      bool negative = p < end && *p == '-';
+      if (p < end && (*p == '-' || *p == '+'))
+        {
+          ++p;
+        }
+      const char *start = p;
+      double v = 0;
+      while (p < end && *p >= '0' && *p <= '9')
+        {
+          v = v * 10 + (*p++ - '0');
+        }
+      if (p < end && *p == '.')
+        {
+          double scale = 0.1;
+          for (++p; p < end && *p >= '0' && *p <= '9'; ++p, scale *= 0.1)
+            {
+              v += (*p - '0') * scale;
+            }
+        }
+      if (p == start)
+        {
+          return false;
+        }
+      if (p < end && (*p == 'e' || *p == 'E'))
+        {
+          ++p;
+          bool negativeExponent = p < end && *p == '-';
+          if (p < end && (*p == '-' || *p == '+'))
+            {
+              ++p;
+            }
+          int exponent = 0;
+          while (p < end && *p >= '0' && *p <= '9')
+            {
+              exponent = exponent * 10 + (*p++ - '0');
+            }
+          v *= std::pow (10.0, negativeExponent ? -exponent : exponent);
+        }
+      value = negative ? -v : v;
+      return true;
+    }
+
+    /**
+     * Read the next attribute of the tag at p, name="value" or name='value'.
+     * \return false at the end of the tag
+     */
+    bool
+    NextAttribute (const char *&p, const char *end, const char *&name, size_t &nameLength,
+                   const char *&value, size_t &valueLength)
+    {
+      while (p < end && IsSpace (*p))
+        {
+          ++p;
+        }
+      if (p >= end || *p == '>' || *p == '/' || *p == '?')
+        {
+          return false;
+        }
+      name = p;
+      while (p < end && *p != '=' && *p != '>' && !IsSpace (*p))
+        {
+          ++p;
+        }
+      nameLength = p - name;
+      while (p < end && IsSpace (*p))
+        {
+          ++p;
+        }
+      if (p >= end || *p != '=')
+        {
+          return false;
+        }
+      ++p;
+      while (p < end && IsSpace (*p))
+        {
+          ++p;
+        }
+      if (p >= end || (*p != '"' && *p != '\''))
+        {
+          return false;
+        }
+      char quote = *p++;
+      value = p;
+      const char *close = static_cast<const char *> (std::memchr (p, quote, end - p));
+      if (!close)
+        {
+          p = end;
+          return false;
+        }
+      valueLength = close - value;
+      p = close + 1;
+      return true;
+    }
+
+    bool
+    IsName (const char *name, size_t length, const char *literal)
+    {
+      return std::strlen (literal) == length && std::memcmp (name, literal, length) == 0;
+    }
+
+    /** \return the first <timestep at or after from, end if there is none */
+    const char *
+    FindTimestep (const char *from, const char *end)
+    {
+      const char *p = from;
+      while (p < end)
+        {
+          const char *lt = static_cast<const char *> (std::memchr (p, '<', end - p));
+          if (!lt)
+            {
+              return end;
+            }
+          p = lt + 1;
+          if (Skip (p, end, "timestep") && p < end && (IsSpace (*p) || *p == '>'))
+            {
+              return lt;
+            }
+        }
+      return end;
+    }
+  }
+
+  SumoFcdImporter::SumoFcdImporter (std::string name, uint32_t threads, double tolerance)
+    : m_file_name (name),
+      m_tolerance (tolerance),
+      m_samples (0)
+  {
+    int fd = open (m_file_name.c_str (), O_RDONLY);
+    NS_ABORT_MSG_IF (fd < 0, "Cannot open the FCD output " << m_file_name);
+    struct stat st;
+    NS_ABORT_MSG_IF (fstat (fd, &st) != 0, "Cannot stat the FCD output " << m_file_name);
+    size_t size = st.st_size;
+    const char *data = nullptr;
+    if (size > 0)
+      {
+        void *map = mmap (nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        NS_ABORT_MSG_IF (map == MAP_FAILED, "Cannot map the FCD output " << m_file_name);
+        madvise (map, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *> (map);
+      }
+    close (fd);
+
+    if (threads == 0)
+      {
+        threads = std::max (1u, std::thread::hardware_concurrency ());
+      }
+    // chunks of less than a megabyte are not worth a thread
+    uint32_t chunks = std::max<size_t> (1, std::min<size_t> (threads, size >> 20));
+
+    // cut the file at timesteps, so that every chunk knows the time of its samples
+    std::vector<const char *> cuts (1, data);
+    for (uint32_t i = 1; i < chunks; ++i)
+      {
+        cuts.push_back (FindTimestep (std::max (cuts.back (), data + size * i / chunks), data + size));
+      }
+    cuts.push_back (data + size);
+
+    std::vector<Chunk> parsed (chunks);
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < chunks; ++i)
+      {
+        workers.push_back (std::thread (&SumoFcdImporter::ParseChunk, cuts[i], cuts[i + 1], std::ref (parsed[i])));
+      }
+    ParseChunk (cuts[0], cuts[1], parsed[0]);
+    for (std::thread &worker : workers)
+      {
+        worker.join ();
+      }
+    workers.clear ();
+    if (data)
+      {
+        munmap (const_cast<char *> (data), size);
+      }
+
+    // merge in file order: vehicles are numbered as they first appear, and
+    // the samples of a vehicle stay in time order
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::vector<Sample> > samples;
+    for (Chunk &chunk : parsed)
+      {
+        for (uint32_t local = 0; local < chunk.names.size (); ++local)
+          {
+            std::unordered_map<std::string, uint32_t>::iterator it = ids.find (chunk.names[local]);
+            std::vector<Sample> &from = chunk.samples[local];
+            m_samples += from.size ();
+            if (it == ids.end ())
+              {
+                ids[chunk.names[local]] = m_names.size ();
+                m_names.push_back (chunk.names[local]);
+                samples.push_back (std::move (from));
+              }
+            else
+              {
+                std::vector<Sample> &to = samples[it->second];
+                to.insert (to.end (), from.begin (), from.end ());
+              }
+            std::vector<Sample> ().swap (from);
+          }
+        chunk = Chunk ();
+      }
+
+    // vehicles are independent, collapse them in parallel too
+    m_waypoints.resize (m_names.size ());
+    uint32_t vehicles = m_names.size ();
+    threads = std::max (1u, std::min (threads, vehicles));
+    for (uint32_t i = 1; i < threads; ++i)
+      {
+        workers.push_back (std::thread (&SumoFcdImporter::Collapse, this, std::ref (samples),
+                                        uint64_t (vehicles) * i / threads, uint64_t (vehicles) * (i + 1) / threads));
+      }
+    Collapse (samples, 0, vehicles / threads);
+    for (std::thread &worker : workers)
+      {
+        worker.join ();
+      }
+  }
+
+  void
+  SumoFcdImporter::ParseChunk (const char *begin, const char *end, Chunk &chunk)
+  {
+    const char *p = begin;
+    double time = 0;
+    std::string key;
+    while (p < end)
+      {
+        const char *lt = static_cast<const char *> (std::memchr (p, '<', end - p));
+        if (!lt)
+          {
+            break;
+          }
+        p = lt + 1;
+        const char *name, *value;
+        size_t nameLength, valueLength;
+        if (Skip (p, end, "!--"))
+          {
+            // comments may hold anything but -->
+            while (p < end && !Skip (p, end, "-->"))
+              {
+                ++p;
+              }
+            continue;
+          }
+        if (Skip (p, end, "timestep") && p < end && IsSpace (*p))
+          {
+            while (NextAttribute (p, end, name, nameLength, value, valueLength))
+              {
+                if (IsName (name, nameLength, "time"))
+                  {
+                    ParseDouble (value, value + valueLength, time);
+                  }
+              }
+          }
+        else if (Skip (p, end, "vehicle") && p < end && IsSpace (*p))
+          {
+            Sample sample = {time, NAN, NAN, 0};
+            const char *id = nullptr;
+            size_t idLength = 0;
+            while (NextAttribute (p, end, name, nameLength, value, valueLength))
+              {
+                if (nameLength != 1)
+                  {
+                    if (IsName (name, nameLength, "id"))
+                      {
+                        id = value;
+                        idLength = valueLength;
+                      }
+                    continue;
+                  }
+                switch (*name)
+                  {
+                  case 'x':
+                    ParseDouble (value, value + valueLength, sample.x);
+                    break;
+                  case 'y':
+                    ParseDouble (value, value + valueLength, sample.y);
+                    break;
+                  case 'z':
+                    ParseDouble (value, value + valueLength, sample.z);
+                    break;
+                  }
+              }
+            if (id && !std::isnan (sample.x) && !std::isnan (sample.y))
+              {
+                key.assign (id, idLength);
+                std::unordered_map<std::string, uint32_t>::iterator it = chunk.ids.find (key);
+                uint32_t local;
+                if (it == chunk.ids.end ())
+                  {
+                    local = chunk.names.size ();
+                    chunk.ids[key] = local;
+                    chunk.names.push_back (key);
+                    chunk.samples.push_back (std::vector<Sample> ());
+                  }
+                else
+                  {
+                    local = it->second;
+                  }
+                chunk.samples[local].push_back (sample);
+              }
+          }
+        const char *gt = static_cast<const char *> (std::memchr (p, '>', end - p));
+        p = gt ? gt + 1 : end;
+      }
+  }
+
+  void
+  SumoFcdImporter::Collapse (std::vector<std::vector<Sample> > &samples, uint32_t first, uint32_t last)
+  {
+    for (uint32_t v = first; v < last; ++v)
+      {
+        const std::vector<Sample> &s = samples[v];
+        std::vector<Waypoint> &waypoints = m_waypoints[v];
+        if (s.empty ())
+          {
+            continue;
+          }
+        // a segment runs from the last waypoint a at the velocity of its
+        // first step, for as long as that predicts the samples within half
+        // the tolerance; the sample before the first one it misses ends it.
+        // The chord to that end is off the prediction by at most half the
+        // tolerance as well, so it is within the tolerance of every sample
+        uint32_t a = 0;
+        double bound = m_tolerance * m_tolerance / 4;
+        double vx = 0, vy = 0, vz = 0;
+        waypoints.push_back (Waypoint (Seconds (s[0].time), Vector (s[0].x, s[0].y, s[0].z)));
+        for (uint32_t j = 1; j < s.size ();)
+          {
+            double dt = s[j].time - s[a].time;
+            if (j == a + 1 || dt <= 0)
+              {
+                if (dt <= 0)
+                  {
+                    // two samples at the same time, keep the later
+                    waypoints.back () = Waypoint (Seconds (s[j].time), Vector (s[j].x, s[j].y, s[j].z));
+                    a = j++;
+                    continue;
+                  }
+                vx = (s[j].x - s[a].x) / dt;
+                vy = (s[j].y - s[a].y) / dt;
+                vz = (s[j].z - s[a].z) / dt;
+                ++j;
+                continue;
+              }
+            double ex = s[a].x + vx * dt - s[j].x;
+            double ey = s[a].y + vy * dt - s[j].y;
+            double ez = s[a].z + vz * dt - s[j].z;
+            if (ex * ex + ey * ey + ez * ez <= bound)
+              {
+                ++j;
+                continue;
+              }
+            a = j - 1;
+            waypoints.push_back (Waypoint (Seconds (s[a].time), Vector (s[a].x, s[a].y, s[a].z)));
+          }
+        if (a != s.size () - 1)
+          {
+            const Sample &end = s.back ();
+            waypoints.push_back (Waypoint (Seconds (end.time), Vector (end.x, end.y, end.z)));
+          }
+        waypoints.shrink_to_fit ();
+        std::vector<Sample> ().swap (samples[v]);
+      }
+  }
+
+  uint32_t
+  SumoFcdImporter::GetNNodes ()
+  {
+    return m_names.size ();
+  }
+  bool
+  SumoFcdImporter::HasNode (uint32_t nodeId)
+  {
+    return nodeId < m_names.size ();
+  }
+  uint32_t
+  SumoFcdImporter::GetNodeIdRange ()
+  {
+    return m_names.size ();
+  }
+  std::string
+  SumoFcdImporter::GetVehicleName (uint32_t nodeId)
+  {
+    return nodeId < m_names.size () ? m_names[nodeId] : "";
+  }
+  double
+  SumoFcdImporter::GetEntryTimeForNode (uint32_t nodeId)
+  {
+    if (nodeId >= m_waypoints.size () || m_waypoints[nodeId].empty ())
+      {
+        return 0;
+      }
+    return m_waypoints[nodeId].front ().time.GetSeconds ();
+  }
+  double
+  SumoFcdImporter::GetExitTimeForNode (uint32_t nodeId)
+  {
+    if (nodeId >= m_waypoints.size () || m_waypoints[nodeId].empty ())
+      {
+        return 0;
+      }
+    return m_waypoints[nodeId].back ().time.GetSeconds ();
+  }
+  double
+  SumoFcdImporter::GetSimulationTime ()
+  {
+    double time = 0;
+    for (uint32_t i = 0; i < m_waypoints.size (); ++i)
+      {
+        time = std::max (time, GetExitTimeForNode (i));
+      }
+    return time;
+  }
+  uint64_t
+  SumoFcdImporter::GetNSamples ()
+  {
+    return m_samples;
+  }
+  uint64_t
+  SumoFcdImporter::GetNWaypoints ()
+  {
+    uint64_t waypoints = 0;
+    for (const std::vector<Waypoint> &vehicle : m_waypoints)
+      {
+        waypoints += vehicle.size ();
+      }
+    return waypoints;
+  }
+  const std::vector<Waypoint> &
+  SumoFcdImporter::GetWaypoints (uint32_t nodeId)
+  {
+    return m_waypoints.at (nodeId);
+  }
+
+  void
+  SumoFcdImporter::Install ()
+  {
+    std::vector<Ptr<Node> > vehicles;
+    for (uint32_t i = 0; i < std::min (NodeList::GetNNodes (), GetNNodes ()); ++i)
+      {
+        vehicles.push_back (NodeList::GetNode (i));
+      }
+    Install (vehicles);
+  }
+
+  void
+  SumoFcdImporter::Install (const std::vector<Ptr<Node> > &vehicles)
+  {
+    // the waypoints of a node must be added in time order, so its vehicles in order of entry
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < std::min<size_t> (vehicles.size (), m_waypoints.size ()); ++i)
+      {
+        if (vehicles[i] && !m_waypoints[i].empty ())
+          {
+            order.push_back (i);
+          }
+      }
+    std::stable_sort (order.begin (), order.end (), [this] (uint32_t a, uint32_t b) {
+      return m_waypoints[a].front ().time < m_waypoints[b].front ().time;
+    });
+    std::unordered_map<uint32_t, Waypoint> last; // by node id, the last waypoint added
+    for (uint32_t v : order)
+      {
+        Ptr<Node> node = vehicles[v];
+        const std::vector<Waypoint> &waypoints = m_waypoints[v];
+        Ptr<WaypointMobilityModel> model = node->GetObject<WaypointMobilityModel> ();
+        if (!model)
+          {
+            NS_ABORT_MSG_IF (node->GetObject<MobilityModel> (), "Node " << node->GetId () << " already has a mobility model that is not a WaypointMobilityModel");
+            model = CreateObject<WaypointMobilityModel> ();
+            node->AggregateObject (model);
+          }
+        std::unordered_map<uint32_t, Waypoint>::iterator previous = last.find (node->GetId ());
+        if (previous != last.end ())
+          {
+            // the node waits where its last vehicle left until one step before the entry, then
+            // jumps; waypoints need strictly increasing times
+            NS_ABORT_MSG_IF (previous->second.time >= waypoints.front ().time, "Vehicle " << m_names[v] << " enters node " << node->GetId () << " before the previous one exits");
+            Time wait = waypoints.front ().time - TimeStep (1);
+            if (wait > previous->second.time)
+              {
+                model->AddWaypoint (Waypoint (wait, previous->second.position));
+              }
+          }
+        for (const Waypoint &waypoint : waypoints)
+          {
+            model->AddWaypoint (waypoint);
+          }
+        last[node->GetId ()] = waypoints.back ();
+      }
+  }
+}
@@ -0,0 +1,124 @@
+#ifndef SUMOTRACEEXAMPLE_SUMO_FCD_IMPORTER_H_
+#define SUMOTRACEEXAMPLE_SUMO_FCD_IMPORTER_H_
+
+#include "ns3/node.h"
+#include "ns3/ptr.h"
+#include "ns3/waypoint.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+  /**
+   * Reads the floating car data of SUMO (sumo --fcd-output) straight into
+   * waypoints, without the conversion to an ns-2 trace.
+   *
+   *   <timestep time="0.00">
+   *     <vehicle id="veh0" x="994.90" y="50.96" angle="90.00" type="car" speed="0.00" .../>
+   *
+   * Vehicles are numbered in the order they first appear, like the $node_(i)
+   * of traceExporter, and a vehicle is in the trace from its first sample to
+   * its last. Samples that a constant velocity from the previous waypoint
+   * predicts within half the tolerance are dropped, so a vehicle cruising
+   * down a highway costs two waypoints rather than one per timestep. The
+   * segment that replaces them ends on a sample off that prediction by up
+   * to half the tolerance too, hence the half: it stays within the
+   * tolerance of every dropped sample.
+   */
+  class SumoFcdImporter
+  {
+  public:
+    /**
+     * Reads the file in chunks parsed in parallel, each cut at a timestep.
+     * \param file_name the FCD output of SUMO
+     * \param threads number of chunks of the file parsed in parallel, 0 for one per core
+     * \param tolerance in meters, how far a dropped sample may be from the segment that replaces it
+     */
+    SumoFcdImporter (std::string file_name, uint32_t threads = 1, double tolerance = 0.01);
+    /**
+     * \return the number of vehicles in the trace
+     */
+    uint32_t GetNNodes ();
+    /**
+     * \return whether a vehicle has this id; ids have no gaps
+     */
+    bool HasNode (uint32_t nodeId);
+    /**
+     * \return one more than the largest vehicle id
+     */
+    uint32_t GetNodeIdRange ();
+    /**
+     * \return the SUMO id of a vehicle
+     */
+    std::string GetVehicleName (uint32_t nodeId);
+    /**
+     * \return the time of the first sample of a vehicle
+     */
+    double GetEntryTimeForNode (uint32_t nodeId);
+    /**
+     * \return the time of the last sample of a vehicle
+     */
+    double GetExitTimeForNode (uint32_t nodeId);
+    /**
+     * \return the time of the last sample of the trace
+     */
+    double GetSimulationTime ();
+    /**
+     * \return the vehicle samples read from the file
+     */
+    uint64_t GetNSamples ();
+    /**
+     * \return the waypoints that are left of them
+     */
+    uint64_t GetNWaypoints ();
+    /**
+     * \return the waypoints of a vehicle, in time order
+     */
+    const std::vector<Waypoint> &GetWaypoints (uint32_t nodeId);
+
+    /**
+     * Give node i of NodeList a WaypointMobilityModel that drives it like vehicle i
+     */
+    void Install ();
+    /**
+     * Give every node a WaypointMobilityModel with the waypoints of its vehicles. A node may
+     * carry several vehicles whose times do not overlap, as NodePool plans them: between two
+     * vehicles it waits where the first left and jumps to the second when that enters.
+     * \param vehicles the node of every vehicle, null for none
+     */
+    void Install (const std::vector<Ptr<Node> > &vehicles);
+
+  private:
+    /** One <vehicle> element */
+    struct Sample
+    {
+      double time;
+      double x;
+      double y;
+      double z;
+    };
+
+    /** Vehicles in the order they first appear in one chunk, with their samples */
+    struct Chunk
+    {
+      std::unordered_map<std::string, uint32_t> ids; /**< SUMO id to index in names */
+      std::vector<std::string> names;
+      std::vector<std::vector<Sample> > samples;
+    };
+
+    /** Parse the timesteps in [begin, end), which must start at a timestep or at the start of the file */
+    static void ParseChunk (const char *begin, const char *end, Chunk &chunk);
+    /** Turn the samples of vehicles [first, last) into waypoints */
+    void Collapse (std::vector<std::vector<Sample> > &samples, uint32_t first, uint32_t last);
+
+    std::string m_file_name; /**< File name of the FCD output */
+    double m_tolerance; /**< meters */
+    std::vector<std::string> m_names; /**< SUMO id of every vehicle */
+    std::vector<std::vector<Waypoint> > m_waypoints; /**< by vehicle id */
+    uint64_t m_samples; /**< vehicle samples in the file */
+  };
+}
+
+#endif /* SUMOTRACEEXAMPLE_SUMO_FCD_IMPORTER_H_ */
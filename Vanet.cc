@@ -121,6 +121,9 @@
 #include "ns3/wave-helper.h"
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/netanim-module.h"
+#include "NS3-HelperScripts/examples/SUMOTraceExample/ns2-stream-mobility-helper.h"
+#include "steady-state-monitor.h"
+#include "simulator-cost.h"
 
 using namespace ns3;
 using namespace dsr;
@@ -924,6 +927,7 @@ WifiApp::Simulate (int argc, char **argv)
 
   SetDefaultAttributeValues ();
   ParseCommandLineArguments (argc, argv);
+  SimulatorCost::Enable ();
   ConfigureNodes ();
   ConfigureChannels ();
   ConfigureDevices ();
@@ -1211,6 +1215,7 @@ private:
   uint32_t m_80211mode; ///< 80211 mode
 
   std::string m_traceFile; ///< trace file 
+  double m_mobilityWindow; ///< seconds of trace waypoints scheduled ahead
   std::string m_logFile; ///< log file
   uint32_t m_mobility; ///< mobility
   uint32_t m_nNodes; ///< number of nodes
@@ -1255,6 +1260,8 @@ private:
   std::vector <double> m_txSafetyRanges; ///< list of ranges
   std::string m_exp; ///< exp
   Time m_cumulativeBsmCaptureStart; ///< capture start
+  double m_steadyStatePrecision; ///< relative CI half width to stop at, 0 = run to m_TotalSimTime
+  SteadyStateMonitor m_steadyState; ///< watches goodput and BSM PDR in CheckThroughput
 };
 
 VanetRoutingExperiment::VanetRoutingExperiment ()
@@ -1275,6 +1282,7 @@ VanetRoutingExperiment::VanetRoutingExperiment ()
     // 1=802.11p
     m_80211mode (1),
     m_traceFile (""),
+    m_mobilityWindow (5.0),
     m_logFile ("low99-ct-unterstrass-1day.filt.7.adj.log"),
     m_mobility (1),
     m_nNodes (156),
@@ -1310,7 +1318,8 @@ VanetRoutingExperiment::VanetRoutingExperiment ()
     m_txSafetyRange10 (500.0),
     m_txSafetyRanges (),
     m_exp (""),
-    m_cumulativeBsmCaptureStart (0)
+    m_cumulativeBsmCaptureStart (0),
+    m_steadyStatePrecision (0)
 {
   m_wifiPhyStats = CreateObject<WifiPhyStats> ();
   m_routingHelper = CreateObject<RoutingHelper> ();
@@ -1526,6 +1535,12 @@ static ns3::GlobalValue g_txMaxDelayMs ("VRCtxMaxDelayMs",
                                         ns3::DoubleValue (10),
                                         ns3::MakeDoubleChecker<double> ());
 
+/// Steady-state precision, 0 = run to the total time
+static ns3::GlobalValue g_steadyStatePrecision ("VRCsteadyStatePrecision",
+                                                "Steady-state precision, 0 = run to the total time",
+                                                ns3::DoubleValue (0),
+                                                ns3::MakeDoubleChecker<double> (0));
+
 /// CSV filename (for time series data)
 static ns3::GlobalValue g_CSVfileName ("VRCCSVfileName",
                                        "CSV filename (for time series data)",
@@ -1704,7 +1719,9 @@ VanetRoutingExperiment::ProcessOutputs ()
 
   double averageRoutingGoodputKbps = 0.0;
   uint32_t totalBytesTotal = m_routingHelper->GetRoutingStats ().GetCumulativeRxBytes ();
-  averageRoutingGoodputKbps = (((double) totalBytesTotal * 8.0) / m_TotalSimTime) / 1000.0;
+  // an early steady-state stop shortens the measured period
+  double simTime = m_steadyState.IsSteady () ? m_steadyState.GetStopTime ().GetSeconds () : m_TotalSimTime;
+  averageRoutingGoodputKbps = (((double) totalBytesTotal * 8.0) / simTime) / 1000.0;
 
   // calculate MAC/PHY overhead (mac-phy-oh)
   // total WAVE BSM bytes sent
@@ -1751,11 +1768,21 @@ VanetRoutingExperiment::Run ()
 {
   NS_LOG_INFO ("Run Simulation.");
 
+  if (m_steadyStatePrecision > 0)
+    {
+      m_steadyState.Configure (m_steadyStatePrecision);
+      m_steadyState.AddMetric ("goodput (Kbps)");
+      m_steadyState.AddMetric ("BSM PDR");
+    }
   CheckThroughput ();
 
   Simulator::Stop (Seconds (m_TotalSimTime));
   AnimationInterface anim("vanet.xml");
   Simulator::Run ();
+  if (m_steadyStatePrecision > 0)
+    {
+      m_steadyState.Report (std::cout);
+    }
   Simulator::Destroy ();
 }
 
@@ -1858,6 +1885,13 @@ VanetRoutingExperiment::CheckThroughput ()
 
   out.close ();
 
+  // the first call at t=0 has no interval behind it
+  if (m_steadyStatePrecision > 0 && Simulator::Now () > Seconds (0))
+    {
+      m_steadyState.Record (0, kbps);
+      m_steadyState.Record (1, wavePDR);
+    }
+
   m_routingHelper->GetRoutingStats ().SetRxBytes (0);
   m_routingHelper->GetRoutingStats ().SetRxPkts (0);
   m_waveBsmHelper.GetWaveBsmStats ()->SetRxPktCount (0);
@@ -1962,6 +1996,8 @@ VanetRoutingExperiment::SetConfigFromGlobals ()
   m_gpsAccuracyNs = doubleValue.Get ();
   GlobalValue::GetValueByName ("VRCtxMaxDelayMs", doubleValue);
   m_txMaxDelayMs = doubleValue.Get ();
+  GlobalValue::GetValueByName ("VRCsteadyStatePrecision", doubleValue);
+  m_steadyStatePrecision = doubleValue.Get ();
 
   GlobalValue::GetValueByName ("VRCCSVfileName", stringValue);
   m_CSVfileName = stringValue.Get ();
@@ -2023,6 +2059,7 @@ VanetRoutingExperiment::SetGlobalsFromConfig ()
   g_waveInterval.SetValue (DoubleValue (m_waveInterval));
   g_gpsAccuracyNs.SetValue (DoubleValue (m_gpsAccuracyNs));
   g_txMaxDelayMs.SetValue (DoubleValue (m_txMaxDelayMs));
+  g_steadyStatePrecision.SetValue (DoubleValue (m_steadyStatePrecision));
 
   g_CSVfileName.SetValue (StringValue (m_CSVfileName));
   g_CSVfileName2.SetValue (StringValue (m_CSVfileName2));
@@ -2065,6 +2102,7 @@ VanetRoutingExperiment::CommandSetup (int argc, char **argv)
   cmd.AddValue ("phyMode", "Wifi Phy mode", m_phyMode);
   cmd.AddValue ("80211Mode", "1=802.11p; 2=802.11b; 3=WAVE-PHY", m_80211mode);
   cmd.AddValue ("traceFile", "Ns2 movement trace file", m_traceFile);
+  cmd.AddValue ("mobilityWindow", "Seconds of trace waypoints scheduled ahead", m_mobilityWindow);
   cmd.AddValue ("logFile", "Log file", m_logFile);
   cmd.AddValue ("mobility", "1=trace;2=RWP", m_mobility);
   cmd.AddValue ("rate", "Rate", m_rate);
@@ -2097,6 +2135,7 @@ VanetRoutingExperiment::CommandSetup (int argc, char **argv)
   cmd.AddValue ("saveconfig", "Config-store filename to save", m_saveConfigFilename);
   cmd.AddValue ("exp", "Experiment", m_exp);
   cmd.AddValue ("BsmCaptureStart", "Start time to begin capturing pkts for cumulative Bsm", m_cumulativeBsmCaptureStart);
+  cmd.AddValue ("steadyState", "Stop once the goodput and BSM PDR CI half widths are within this fraction of their means, 0=run to totaltime", m_steadyStatePrecision);
   cmd.Parse (argc, argv);
 
   m_txSafetyRange1 = txDist1;
@@ -2168,9 +2207,9 @@ VanetRoutingExperiment::SetupAdhocMobilityNodes ()
 {
   if (m_mobility == 1)
     {
-      // Create Ns2MobilityHelper with the specified trace log file as parameter
-      Ns2MobilityHelper ns2 = Ns2MobilityHelper (m_traceFile);
-      ns2.Install (); // configure movements for each node, while reading trace file
+      // Stream the trace: only the waypoints of the next window are scheduled
+      Ns2StreamMobilityHelper ns2 = Ns2StreamMobilityHelper (m_traceFile, Seconds (m_mobilityWindow));
+      ns2.Install (); // configure movements for each node, reading the trace as the simulation goes
       // initially assume all nodes are not moving
       WaveBsmHelper::GetNodesMoving ().resize (m_nNodes, 0);
     }
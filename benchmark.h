@@ -0,0 +1,392 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "ns3/abort.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief One flat JSON object of benchmark results
+ *
+ * Fields keep the order they were first set in, so that the records of a
+ * run diff cleanly against those of another version.
+ */
+class BenchmarkRecord
+{
+public:
+  void SetString (std::string key, std::string value)
+  {
+    SetRaw (key, Quote (value));
+  }
+
+  void SetNumber (std::string key, double value)
+  {
+    if (!std::isfinite (value))
+      {
+        SetRaw (key, "null");
+        return;
+      }
+    std::ostringstream os;
+    os << std::setprecision (10) << value;
+    SetRaw (key, os.str ());
+  }
+
+  void SetInteger (std::string key, uint64_t value)
+  {
+    SetRaw (key, std::to_string (value));
+  }
+
+  bool Has (const std::string &key) const
+  {
+    for (const std::pair<std::string, std::string> &field : m_fields)
+      {
+        if (field.first == key)
+          {
+            return true;
+          }
+      }
+    return false;
+  }
+
+  /// \return the value of a numeric field, def when missing or not a number
+  double GetNumber (const std::string &key, double def = 0) const
+  {
+    for (const std::pair<std::string, std::string> &field : m_fields)
+      {
+        if (field.first == key)
+          {
+            char *end = nullptr;
+            double value = std::strtod (field.second.c_str (), &end);
+            return end != field.second.c_str () ? value : def;
+          }
+      }
+    return def;
+  }
+
+  /// \brief Set the fields of other, after the fields of this record
+  void Merge (const BenchmarkRecord &other)
+  {
+    for (const std::pair<std::string, std::string> &field : other.m_fields)
+      {
+        SetRaw (field.first, field.second);
+      }
+  }
+
+  std::string ToJson (void) const
+  {
+    std::string json = "{";
+    for (uint32_t i = 0; i < m_fields.size (); ++i)
+      {
+        json += (i ? ", " : "") + Quote (m_fields[i].first) + ": " + m_fields[i].second;
+      }
+    return json + "}";
+  }
+
+  /// \brief One "key\\tvalue" line per field, values in their JSON form
+  std::string Serialize (void) const
+  {
+    std::string data;
+    for (const std::pair<std::string, std::string> &field : m_fields)
+      {
+        data += field.first + "\t" + field.second + "\n";
+      }
+    return data;
+  }
+
+  static bool Deserialize (const std::string &data, BenchmarkRecord &record)
+  {
+    std::istringstream is (data);
+    std::string line;
+    while (std::getline (is, line))
+      {
+        size_t tab = line.find ('\t');
+        if (tab == std::string::npos)
+          {
+            return false;
+          }
+        record.SetRaw (line.substr (0, tab), line.substr (tab + 1));
+      }
+    return true;
+  }
+
+  /// \return the records of a file of Serialize blocks separated by empty lines
+  static std::vector<BenchmarkRecord> ReadBlocks (std::istream &is)
+  {
+    std::vector<BenchmarkRecord> records;
+    std::string line, block;
+    while (std::getline (is, line) || !block.empty ())
+      {
+        if (!line.empty ())
+          {
+            block += line + "\n";
+            line.clear ();
+            continue;
+          }
+        BenchmarkRecord record;
+        if (!block.empty () && Deserialize (block, record))
+          {
+            records.push_back (record);
+          }
+        block.clear ();
+      }
+    return records;
+  }
+
+private:
+  void SetRaw (const std::string &key, const std::string &value)
+  {
+    for (std::pair<std::string, std::string> &field : m_fields)
+      {
+        if (field.first == key)
+          {
+            field.second = value;
+            return;
+          }
+      }
+    m_fields.push_back (std::make_pair (key, value));
+  }
+
+  static std::string Quote (const std::string &s)
+  {
+    std::string quoted = "\"";
+    for (char c : s)
+      {
+        if (c == '"' || c == '\\')
+          {
+            quoted += '\\';
+            quoted += c;
+          }
+        else if (static_cast<unsigned char> (c) < 0x20)
+          {
+            char escape[8];
+            std::snprintf (escape, sizeof (escape), "\\u%04x", c);
+            quoted += escape;
+          }
+        else
+          {
+            quoted += c;
+          }
+      }
+    return quoted + "\"";
+  }
+
+  std::vector<std::pair<std::string, std::string> > m_fields;
+};
+
+/**
+ * \brief Run a benchmark job in a forked child
+ *
+ * ns-3 has a single simulator per process and the peak RSS of a process
+ * never goes down, so every job gets a fresh child. The child returns the
+ * record of the job over a pipe; the parent adds the peak RSS of the child
+ * as reported by wait4 (peakRssKb, which includes the pages shared with the
+ * parent at fork) or, if the child did not finish, an error field. Jobs run
+ * one at a time so that their wall times do not compete for cores.
+ */
+inline BenchmarkRecord
+RunIsolated (std::function<BenchmarkRecord (void)> job)
+{
+  int fds[2];
+  NS_ABORT_MSG_IF (pipe (fds) != 0, "pipe failed");
+  // buffered output would otherwise be written by the child as well
+  std::cout.flush ();
+  std::cerr.flush ();
+  fflush (nullptr);
+  pid_t pid = fork ();
+  NS_ABORT_MSG_IF (pid < 0, "fork failed");
+  if (pid == 0)
+    {
+      close (fds[0]);
+      std::string data = job ().Serialize ();
+      const char *p = data.data ();
+      size_t size = data.size ();
+      while (size > 0)
+        {
+          ssize_t n = write (fds[1], p, size);
+          if (n < 0 && errno == EINTR)
+            {
+              continue;
+            }
+          if (n <= 0)
+            {
+              _exit (1);
+            }
+          p += n;
+          size -= n;
+        }
+      close (fds[1]);
+      std::cout.flush ();
+      // skip the parent's static destructors and atexit handlers
+      _exit (0);
+    }
+  close (fds[1]);
+  std::string data;
+  char buffer[4096];
+  ssize_t n;
+  while ((n = read (fds[0], buffer, sizeof (buffer))) != 0)
+    {
+      if (n > 0)
+        {
+          data.append (buffer, n);
+        }
+      else if (errno != EINTR)
+        {
+          break;
+        }
+    }
+  close (fds[0]);
+  int status = 0;
+  struct rusage usage = {};
+  while (wait4 (pid, &status, 0, &usage) < 0 && errno == EINTR)
+    {
+    }
+
+  BenchmarkRecord record;
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0 || !BenchmarkRecord::Deserialize (data, record))
+    {
+      record.SetString ("error", WIFSIGNALED (status) ? "worker killed by signal " + std::to_string (WTERMSIG (status))
+                                                      : "worker failed");
+    }
+  record.SetInteger ("peakRssKb", usage.ru_maxrss);
+  return record;
+}
+
+/**
+ * \brief Run a scratch program and collect its SimulatorCost blocks
+ *
+ * scheduler, if not empty, is the TypeId of the scheduler the program runs
+ * under, for instance "ns3::HeapScheduler", passed in NS3_SCRATCH_SCHEDULER
+ * for SimulatorCost::Enable to install; stop, if positive, cuts every
+ * simulation of the program at that time. The record sums the blocks of
+ * all the simulations of the program and adds the wall time and peak RSS
+ * of the whole program.
+ */
+inline BenchmarkRecord
+RunProgram (const std::string &program, const std::vector<std::string> &args,
+            const std::string &scheduler, double stop, bool quiet,
+            std::vector<BenchmarkRecord> &blocks)
+{
+  char costPath[] = "/tmp/scratch-cost-XXXXXX";
+  int costFd = mkstemp (costPath);
+  NS_ABORT_MSG_IF (costFd < 0, "Cannot create a temporary file");
+  close (costFd);
+
+  std::cout.flush ();
+  std::cerr.flush ();
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+  pid_t pid = fork ();
+  NS_ABORT_MSG_IF (pid < 0, "fork failed");
+  if (pid == 0)
+    {
+      if (!scheduler.empty ())
+        {
+          setenv ("NS3_SCRATCH_SCHEDULER", scheduler.c_str (), 1);
+        }
+      setenv ("NS3_SCRATCH_COST", costPath, 1);
+      if (stop > 0)
+        {
+          setenv ("NS3_SCRATCH_COST_STOP", std::to_string (stop).c_str (), 1);
+        }
+      if (quiet)
+        {
+          int null = open ("/dev/null", O_WRONLY);
+          dup2 (null, STDOUT_FILENO);
+          close (null);
+        }
+      std::vector<char *> argv;
+      argv.push_back (const_cast<char *> (program.c_str ()));
+      for (const std::string &arg : args)
+        {
+          argv.push_back (const_cast<char *> (arg.c_str ()));
+        }
+      argv.push_back (nullptr);
+      execvp (program.c_str (), argv.data ());
+      std::cerr << "Cannot run " << program << std::endl;
+      _exit (127);
+    }
+  int status = 0;
+  struct rusage usage = {};
+  while (wait4 (pid, &status, 0, &usage) < 0 && errno == EINTR)
+    {
+    }
+  double wall = std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ();
+
+  std::ifstream is (costPath);
+  blocks = BenchmarkRecord::ReadBlocks (is);
+  unlink (costPath);
+
+  double events = 0, setup = 0, run = 0, simulated = 0;
+  // scratches that fork a child per simulation report its RSS in the blocks
+  double peakRss = usage.ru_maxrss;
+  uint32_t simulations = 0;
+  for (const BenchmarkRecord &block : blocks)
+    {
+      if (block.Has ("events"))
+        {
+          events += block.GetNumber ("events");
+          setup += block.GetNumber ("setupSeconds");
+          run += block.GetNumber ("runSeconds");
+          simulated += block.GetNumber ("simulatedSeconds");
+          peakRss = std::max (peakRss, block.GetNumber ("peakRssKb"));
+          ++simulations;
+        }
+    }
+
+  BenchmarkRecord record;
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    {
+      record.SetString ("error", "program failed");
+    }
+  else if (simulations == 0)
+    {
+      record.SetString ("error", "no SimulatorCost report, does the scratch call SimulatorCost::Enable?");
+    }
+  record.SetInteger ("simulations", simulations);
+  record.SetInteger ("events", events);
+  record.SetNumber ("setupSeconds", setup);
+  record.SetNumber ("runSeconds", run);
+  record.SetNumber ("eventsPerSecond", run > 0 ? events / run : 0);
+  record.SetNumber ("simulatedSeconds", simulated);
+  record.SetNumber ("wallSeconds", wall);
+  record.SetInteger ("peakRssKb", peakRss);
+  return record;
+}
+
+/// \brief Write {"meta": ..., "results": [...]}, one result per line
+inline void
+WriteBenchmarkJson (std::ostream &os, const BenchmarkRecord &meta,
+                    const std::vector<BenchmarkRecord> &results)
+{
+  os << "{\"meta\": " << meta.ToJson () << ",\n \"results\": [";
+  for (uint32_t i = 0; i < results.size (); ++i)
+    {
+      os << (i ? ",\n  " : "\n  ") << results[i].ToJson ();
+    }
+  os << "\n ]}" << std::endl;
+}
+
+} // namespace ns3
+
+#endif /* BENCHMARK_H */
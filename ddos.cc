@@ -30,28 +30,767 @@
 
 #include "ns3/node-container.h"
 
+#include "ns3/histogram.h"
+
+#include "ns3/traffic-control-module.h"
+
+#include "steady-state-monitor.h"
+
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
+#include <chrono>
+
+#include <fstream>
+
+#include <list>
+
+#include <map>
+
+#include <memory>
+
+#include <vector>
+
 
 #define UDP_SINK_PORT 9001
 #define MAX_BULK_BYTES 100000
-#define DDOS_RATE "20480kb/s"
+#define DDOS_RATE "20480kb/s"      // default per-bot rate, see --ddosRate
 #define MAX_SIMULATION_TIME 10.0
-#define NUMBER_OF_BOTS 10
+#define NUMBER_OF_BOTS 10         // default bot count, see --bots
+#define SERVICE_BIN_WIDTH 1.0    // seconds per goodput sample
+#define DELAY_HISTOGRAM_BIN 0.001 // seconds per delay/RTT histogram bin
+#define DISTRIBUTED_RANKS 4       // core, PP, WTF, TCS
+#define STEADY_STATE_INTERVAL 0.05 // seconds per steady-state observation
 
 NS_LOG_COMPONENT_DEFINE("DDoSAttack");
 using namespace ns3;
 
+// MPI rank of each node under the distributed simulator: 0 is the core (CT and
+// the server), 1 PP, 2 WTF and 3 TCS. Districts only meet on the point-to-point
+// CT mesh, whose 2 ms delay is the lookahead.
+static const uint32_t NODE_RANK[23] = {1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 2, 0, 0};
+static const uint32_t USER_RANK[12] = {1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3};
+// Bot k sits in the district BOT_RANK[k % NUMBER_OF_BOTS]: on PP_S1_R1, WTF_S2_HH2
+// or TCS_S2_PTM2, so any bot count keeps the 5:2:3 split of the original ten.
+static const uint32_t BOT_RANK[NUMBER_OF_BOTS] = {1, 1, 1, 1, 1, 2, 2, 3, 3, 3};
+
+/**
+ * Who generated a packet, so that the receivers can split legitimate
+ * traffic from attack traffic. See ServiceMetrics for how it is found.
+ */
+enum TrafficClass {
+    TRAFFIC_UNTAGGED = 0,
+    TRAFFIC_LEGIT,
+    TRAFFIC_ATTACK,
+    TRAFFIC_CLASSES
+};
+
+static const char *TRAFFIC_CLASS_NAMES[TRAFFIC_CLASSES] = {"untagged", "legit", "attack"};
+
+/**
+ * Packet tag holding the traffic class and the time the packet left the
+ * sending application. Only the echo client packets carry it, see
+ * ServiceMetrics.
+ */
+class DdosFlowTag : public Tag {
+public:
+    static TypeId GetTypeId(void);
+    virtual TypeId GetInstanceTypeId(void) const;
+    virtual uint32_t GetSerializedSize(void) const;
+    virtual void Serialize(TagBuffer i) const;
+    virtual void Deserialize(TagBuffer i);
+    virtual void Print(std::ostream &os) const;
+
+    DdosFlowTag();
+    DdosFlowTag(uint8_t trafficClass, Time sendTime);
+
+    uint8_t GetTrafficClass(void) const;
+    Time GetSendTime(void) const;
+
+private:
+    uint8_t m_trafficClass; //!< one of TrafficClass
+    Time m_sendTime;        //!< time the application sent the packet
+};
+
+NS_OBJECT_ENSURE_REGISTERED(DdosFlowTag);
+
+TypeId DdosFlowTag::GetTypeId(void) {
+    static TypeId tid = TypeId("ns3::DdosFlowTag")
+        .SetParent<Tag>()
+        .AddConstructor<DdosFlowTag>();
+    return tid;
+}
+
+TypeId DdosFlowTag::GetInstanceTypeId(void) const {
+    return DdosFlowTag::GetTypeId();
+}
+
+uint32_t DdosFlowTag::GetSerializedSize(void) const {
+    return sizeof(uint8_t) + sizeof(uint64_t);
+}
+
+void DdosFlowTag::Serialize(TagBuffer i) const {
+    i.WriteU8(m_trafficClass);
+    i.WriteU64(m_sendTime.GetTimeStep());
+}
+
+void DdosFlowTag::Deserialize(TagBuffer i) {
+    m_trafficClass = i.ReadU8();
+    m_sendTime = TimeStep(i.ReadU64());
+}
+
+void DdosFlowTag::Print(std::ostream &os) const {
+    os << "class=" << TRAFFIC_CLASS_NAMES[m_trafficClass] << " sent=" << m_sendTime;
+}
+
+DdosFlowTag::DdosFlowTag()
+    : m_trafficClass(TRAFFIC_UNTAGGED),
+      m_sendTime(Seconds(0)) {
+}
+
+DdosFlowTag::DdosFlowTag(uint8_t trafficClass, Time sendTime)
+    : m_trafficClass(trafficClass),
+      m_sendTime(sendTime) {
+}
+
+uint8_t DdosFlowTag::GetTrafficClass(void) const {
+    return m_trafficClass;
+}
+
+Time DdosFlowTag::GetSendTime(void) const {
+    return m_sendTime;
+}
+
+/**
+ * Service metrics for legitimate and attack traffic.
+ *
+ * OnOffApplication fires its "Tx" trace after the socket has sent a copy of
+ * the packet, so a tag added there never reaches the receiver. The traffic
+ * class of an OnOff packet is therefore told by its source address, each
+ * sender node registering its addresses with AddSender, and its send time
+ * comes from the SeqTsSizeHeader the OnOffs and the PacketSink are set up
+ * with. The UdpEchoClient fires "Tx" before sending, so its packets carry a
+ * DdosFlowTag instead. Receivers (PacketSink, UdpEchoServer) account goodput
+ * per SERVICE_BIN_WIDTH interval, one-way delay and packet counts per
+ * traffic class. The UdpEchoServer strips packet tags before echoing, so
+ * the echo client RTT is matched on the packet uid.
+ */
+class ServiceMetrics {
+public:
+    ServiceMetrics();
+
+    /**
+     * Count the packets sent by the OnOffApplications of a node, and file
+     * everything received from its addresses under trafficClass. The node
+     * is needed on every rank, its applications only on its own.
+     */
+    void AddSender(Ptr<Node> node, ApplicationContainer apps, TrafficClass trafficClass);
+    /** Measure RTT and loss of the echo exchange seen by UdpEchoClients. */
+    void AddEchoClient(ApplicationContainer apps);
+    /** Account traffic received by PacketSinks or UdpEchoServers. */
+    void AddReceiver(ApplicationContainer apps, std::string name);
+    /** Count the packets a queue disc drops, per traffic class. */
+    void AddQueueDisc(Ptr<QueueDisc> queueDisc);
+
+    /** Print per-class loss, delay and RTT histograms. */
+    void Report(std::ostream &os) const;
+    /** Write the per-interval goodput time series as CSV. */
+    void WriteTimeSeries(std::string fileName) const;
+
+    /** \return bytes of a traffic class received on all receivers */
+    uint64_t GetRxBytes(TrafficClass trafficClass) const;
+    /** \return bytes of a traffic class received on the receivers added as name */
+    uint64_t GetRxBytes(TrafficClass trafficClass, std::string name) const;
+    /** \return bytes of a traffic class sent by the instrumented applications */
+    uint64_t GetTxBytes(TrafficClass trafficClass) const;
+    /** \return legit bytes sent by the UdpEchoClients, part of GetTxBytes(TRAFFIC_LEGIT) */
+    uint64_t GetEchoTxBytes(void) const;
+
+private:
+    struct Receiver {
+        std::string name;
+        uint64_t rxPackets[TRAFFIC_CLASSES];
+        uint64_t rxBytes[TRAFFIC_CLASSES];
+        std::vector<uint64_t> binBytes[TRAFFIC_CLASSES];
+        Histogram delay[TRAFFIC_CLASSES];
+    };
+
+    static void SenderTx(ServiceMetrics *metrics, uint8_t trafficClass, Ptr<const Packet> packet);
+    static void EchoClientTx(ServiceMetrics *metrics, Ptr<const Packet> packet);
+    static void EchoClientRx(ServiceMetrics *metrics, Ptr<const Packet> packet);
+    static void SinkRx(ServiceMetrics *metrics, uint32_t receiver, Ptr<const Packet> packet, const Address &from,
+                       const Address &to, const SeqTsSizeHeader &header);
+    static void EchoServerRx(ServiceMetrics *metrics, uint32_t receiver, Ptr<const Packet> packet,
+                             const Address &from, const Address &to);
+    static void QueueDiscDrop(ServiceMetrics *metrics, Ptr<const QueueDiscItem> item);
+
+    /** \return the class of a packet from source, by its tag or else by the address */
+    uint8_t Classify(Ptr<const Packet> packet, Ipv4Address source) const;
+    /** Account size bytes from source, sent at sendTime if it is not negative. */
+    void Receive(uint32_t receiver, Ptr<const Packet> packet, uint32_t size, const Address &from, Time sendTime);
+    static void PrintHistogram(std::ostream &os, Histogram histogram);
+
+    uint64_t m_txPackets[TRAFFIC_CLASSES];
+    uint64_t m_txBytes[TRAFFIC_CLASSES];
+    uint64_t m_queueDiscDrops[TRAFFIC_CLASSES];
+    std::map<Ipv4Address, uint8_t> m_senderClass; //!< sender address -> traffic class
+    bool m_hasQueueDisc;
+    std::vector<Receiver> m_receivers;
+    std::map<uint64_t, Time> m_echoPending; //!< packet uid -> echo request send time
+    uint64_t m_echoSent;
+    uint64_t m_echoSentBytes;
+    uint64_t m_echoReceived;
+    Histogram m_rtt;
+};
+
+ServiceMetrics::ServiceMetrics()
+    : m_hasQueueDisc(false),
+      m_echoSent(0),
+      m_echoSentBytes(0),
+      m_echoReceived(0),
+      m_rtt(DELAY_HISTOGRAM_BIN) {
+    for (int c = 0; c < TRAFFIC_CLASSES; ++c) {
+        m_txPackets[c] = 0;
+        m_txBytes[c] = 0;
+        m_queueDiscDrops[c] = 0;
+    }
+}
+
+void ServiceMetrics::AddSender(Ptr<Node> node, ApplicationContainer apps, TrafficClass trafficClass) {
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    for (uint32_t i = 0; i < ipv4->GetNInterfaces(); ++i) {
+        for (uint32_t a = 0; a < ipv4->GetNAddresses(i); ++a) {
+            m_senderClass[ipv4->GetAddress(i, a).GetLocal()] = trafficClass;
+        }
+    }
+    for (ApplicationContainer::Iterator app = apps.Begin(); app != apps.End(); ++app) {
+        (*app)->TraceConnectWithoutContext("Tx", MakeBoundCallback(&ServiceMetrics::SenderTx, this, (uint8_t) trafficClass));
+    }
+}
+
+void ServiceMetrics::AddEchoClient(ApplicationContainer apps) {
+    for (ApplicationContainer::Iterator app = apps.Begin(); app != apps.End(); ++app) {
+        (*app)->TraceConnectWithoutContext("Tx", MakeBoundCallback(&ServiceMetrics::EchoClientTx, this));
+        (*app)->TraceConnectWithoutContext("Rx", MakeBoundCallback(&ServiceMetrics::EchoClientRx, this));
+    }
+}
+
+void ServiceMetrics::AddReceiver(ApplicationContainer apps, std::string name) {
+    for (ApplicationContainer::Iterator app = apps.Begin(); app != apps.End(); ++app) {
+        Receiver receiver;
+        receiver.name = name;
+        for (int c = 0; c < TRAFFIC_CLASSES; ++c) {
+            receiver.rxPackets[c] = 0;
+            receiver.rxBytes[c] = 0;
+            receiver.delay[c].SetDefaultBinWidth(DELAY_HISTOGRAM_BIN);
+        }
+        uint32_t index = m_receivers.size();
+        m_receivers.push_back(receiver);
+
+        if (DynamicCast<PacketSink>(*app)) {
+            (*app)->TraceConnectWithoutContext("RxWithSeqTsSize", MakeBoundCallback(&ServiceMetrics::SinkRx, this, index));
+        } else {
+            (*app)->TraceConnectWithoutContext("RxWithAddresses", MakeBoundCallback(&ServiceMetrics::EchoServerRx, this, index));
+        }
+    }
+}
+
+void ServiceMetrics::AddQueueDisc(Ptr<QueueDisc> queueDisc) {
+    m_hasQueueDisc = true;
+    queueDisc->TraceConnectWithoutContext("Drop", MakeBoundCallback(&ServiceMetrics::QueueDiscDrop, this));
+}
+
+void ServiceMetrics::SenderTx(ServiceMetrics *metrics, uint8_t trafficClass, Ptr<const Packet> packet) {
+    metrics->m_txPackets[trafficClass]++;
+    metrics->m_txBytes[trafficClass] += packet->GetSize();
+}
+
+void ServiceMetrics::EchoClientTx(ServiceMetrics *metrics, Ptr<const Packet> packet) {
+    // Fired before the send, so the tag is on the packet the server gets.
+    // Packet tags may be added to a const packet
+    packet->AddPacketTag(DdosFlowTag(TRAFFIC_LEGIT, Simulator::Now()));
+    SenderTx(metrics, TRAFFIC_LEGIT, packet);
+    metrics->m_echoPending[packet->GetUid()] = Simulator::Now();
+    metrics->m_echoSent++;
+    metrics->m_echoSentBytes += packet->GetSize();
+}
+
+void ServiceMetrics::EchoClientRx(ServiceMetrics *metrics, Ptr<const Packet> packet) {
+    std::map<uint64_t, Time>::iterator it = metrics->m_echoPending.find(packet->GetUid());
+    if (it == metrics->m_echoPending.end()) {
+        return;
+    }
+    metrics->m_rtt.AddValue((Simulator::Now() - it->second).GetSeconds());
+    metrics->m_echoPending.erase(it);
+    metrics->m_echoReceived++;
+}
+
+void ServiceMetrics::SinkRx(ServiceMetrics *metrics, uint32_t receiver, Ptr<const Packet> packet, const Address &from,
+                            const Address &to, const SeqTsSizeHeader &header) {
+    // packet is the payload after the header, header.GetSize() what the OnOff sent
+    metrics->Receive(receiver, packet, header.GetSize(), from, header.GetTs());
+}
+
+void ServiceMetrics::EchoServerRx(ServiceMetrics *metrics, uint32_t receiver, Ptr<const Packet> packet,
+                                  const Address &from, const Address &to) {
+    DdosFlowTag tag;
+    Time sendTime = packet->PeekPacketTag(tag) ? tag.GetSendTime() : Seconds(-1);
+    metrics->Receive(receiver, packet, packet->GetSize(), from, sendTime);
+}
+
+void ServiceMetrics::QueueDiscDrop(ServiceMetrics *metrics, Ptr<const QueueDiscItem> item) {
+    Ptr<const Ipv4QueueDiscItem> ipv4Item = DynamicCast<const Ipv4QueueDiscItem>(item);
+    Ipv4Address source = ipv4Item ? ipv4Item->GetHeader().GetSource() : Ipv4Address::GetAny();
+    metrics->m_queueDiscDrops[metrics->Classify(item->GetPacket(), source)]++;
+}
+
+uint8_t ServiceMetrics::Classify(Ptr<const Packet> packet, Ipv4Address source) const {
+    DdosFlowTag tag;
+    if (packet->PeekPacketTag(tag)) {
+        return tag.GetTrafficClass();
+    }
+    std::map<Ipv4Address, uint8_t>::const_iterator it = m_senderClass.find(source);
+    return it != m_senderClass.end() ? it->second : (uint8_t) TRAFFIC_UNTAGGED;
+}
+
+void ServiceMetrics::Receive(uint32_t index, Ptr<const Packet> packet, uint32_t size, const Address &from,
+                             Time sendTime) {
+    Receiver &receiver = m_receivers[index];
+    Ipv4Address source = InetSocketAddress::IsMatchingType(from) ? InetSocketAddress::ConvertFrom(from).GetIpv4()
+                                                                 : Ipv4Address::GetAny();
+    uint8_t c = Classify(packet, source);
+    if (!sendTime.IsNegative()) {
+        receiver.delay[c].AddValue((Simulator::Now() - sendTime).GetSeconds());
+    }
+
+    uint32_t bin = (uint32_t) (Simulator::Now().GetSeconds() / SERVICE_BIN_WIDTH);
+    if (receiver.binBytes[c].size() <= bin) {
+        receiver.binBytes[c].resize(bin + 1, 0);
+    }
+    receiver.binBytes[c][bin] += size;
+    receiver.rxBytes[c] += size;
+    receiver.rxPackets[c]++;
+}
+
+uint64_t ServiceMetrics::GetRxBytes(TrafficClass trafficClass) const {
+    uint64_t bytes = 0;
+    for (std::vector<Receiver>::const_iterator it = m_receivers.begin(); it != m_receivers.end(); ++it) {
+        bytes += it->rxBytes[trafficClass];
+    }
+    return bytes;
+}
+
+uint64_t ServiceMetrics::GetRxBytes(TrafficClass trafficClass, std::string name) const {
+    uint64_t bytes = 0;
+    for (std::vector<Receiver>::const_iterator it = m_receivers.begin(); it != m_receivers.end(); ++it) {
+        if (it->name == name) {
+            bytes += it->rxBytes[trafficClass];
+        }
+    }
+    return bytes;
+}
+
+uint64_t ServiceMetrics::GetTxBytes(TrafficClass trafficClass) const {
+    return m_txBytes[trafficClass];
+}
+
+uint64_t ServiceMetrics::GetEchoTxBytes(void) const {
+    return m_echoSentBytes;
+}
+
+void ServiceMetrics::PrintHistogram(std::ostream &os, Histogram histogram) {
+    // Histogram's bin accessors are non-const, hence the copy
+    for (uint32_t b = 0; b < histogram.GetNBins(); ++b) {
+        if (histogram.GetBinCount(b) == 0) {
+            continue;
+        }
+        os << "      [" << histogram.GetBinStart(b) * 1000 << ", " << histogram.GetBinEnd(b) * 1000
+           << ") ms: " << histogram.GetBinCount(b) << std::endl;
+    }
+}
+
+void ServiceMetrics::Report(std::ostream &os) const {
+    os << "Service metrics" << std::endl;
+    for (int c = TRAFFIC_LEGIT; c < TRAFFIC_CLASSES; ++c) {
+        uint64_t received = 0;
+        for (std::vector<Receiver>::const_iterator it = m_receivers.begin(); it != m_receivers.end(); ++it) {
+            received += it->rxPackets[c];
+        }
+        double loss = m_txPackets[c] > 0 ? 1.0 - (double) received / m_txPackets[c] : 0.0;
+        os << "  " << TRAFFIC_CLASS_NAMES[c] << ": sent " << m_txPackets[c] << " received " << received
+           << " loss " << loss * 100 << "%";
+        if (m_hasQueueDisc) {
+            os << " (" << m_queueDiscDrops[c] << " dropped by mitigation)";
+        }
+        os << std::endl;
+    }
+
+    for (std::vector<Receiver>::const_iterator it = m_receivers.begin(); it != m_receivers.end(); ++it) {
+        for (int c = 0; c < TRAFFIC_CLASSES; ++c) {
+            if (it->rxPackets[c] == 0) {
+                continue;
+            }
+            os << "  " << it->name << " " << TRAFFIC_CLASS_NAMES[c] << ": " << it->rxPackets[c] << " packets, "
+               << it->rxBytes[c] << " bytes" << std::endl;
+            if (c != TRAFFIC_UNTAGGED) {
+                os << "    one-way delay:" << std::endl;
+                PrintHistogram(os, it->delay[c]);
+            }
+        }
+    }
+
+    double echoLoss = m_echoSent > 0 ? 1.0 - (double) m_echoReceived / m_echoSent : 0.0;
+    os << "  echo: sent " << m_echoSent << " answered " << m_echoReceived
+       << " loss " << echoLoss * 100 << "%" << std::endl;
+    os << "    RTT:" << std::endl;
+    PrintHistogram(os, m_rtt);
+}
+
+void ServiceMetrics::WriteTimeSeries(std::string fileName) const {
+    std::ofstream out(fileName.c_str());
+    out << "time,receiver,class,goodputMbps" << std::endl;
+    for (std::vector<Receiver>::const_iterator it = m_receivers.begin(); it != m_receivers.end(); ++it) {
+        for (int c = 0; c < TRAFFIC_CLASSES; ++c) {
+            for (uint32_t bin = 0; bin < it->binBytes[c].size(); ++bin) {
+                out << bin * SERVICE_BIN_WIDTH << "," << it->name << "," << TRAFFIC_CLASS_NAMES[c] << ","
+                    << it->binBytes[c][bin] * 8.0 / SERVICE_BIN_WIDTH / 1e6 << std::endl;
+            }
+        }
+    }
+}
+
+/**
+ * Feed the legit and attack goodput of the last interval to the steady-state
+ * monitor, in Mbps. Sampling ends with the traffic so an unsettled run still
+ * runs out of events.
+ */
+static void SampleSteadyState(SteadyStateMonitor *monitor, const ServiceMetrics *metrics) {
+    monitor->RecordCumulative(0, metrics->GetRxBytes(TRAFFIC_LEGIT) * 8 / STEADY_STATE_INTERVAL / 1e6);
+    monitor->RecordCumulative(1, metrics->GetRxBytes(TRAFFIC_ATTACK) * 8 / STEADY_STATE_INTERVAL / 1e6);
+    if (Simulator::Now() + Seconds(STEADY_STATE_INTERVAL) <= Seconds(MAX_SIMULATION_TIME)) {
+        Simulator::Schedule(Seconds(STEADY_STATE_INTERVAL), &SampleSteadyState, monitor, metrics);
+    }
+}
+
+/**
+ * Mitigation stage for the CT router.
+ *
+ * Packets are hashed on their IPv4 source address into a fixed number of
+ * buckets, which bounds the per-flow state no matter how many sources
+ * there are. Each bucket has a token bucket rate limiter (SourceRate, 0
+ * disables it) and, with FairQueue set, its own queue served by deficit
+ * round robin. Otherwise all accepted packets share one FIFO. When the
+ * queue disc is over MaxSize the head of the longest bucket is dropped.
+ * The wall-clock time spent in enqueue and dequeue is accumulated so the
+ * mitigation quality can be weighed against the per-packet router cost.
+ */
+class MitigationQueueDisc : public QueueDisc {
+public:
+    static TypeId GetTypeId(void);
+
+    MitigationQueueDisc();
+    virtual ~MitigationQueueDisc();
+
+    // Reasons for dropping packets
+    static constexpr const char *RATE_LIMIT_DROP = "Source over rate limit";
+    static constexpr const char *OVERLIMIT_DROP = "Overlimit drop";
+
+    /** \return packets seen by DoEnqueue */
+    uint64_t GetProcessedPackets(void) const;
+    /** \return mean enqueue plus dequeue processing time per packet, in nanoseconds */
+    double GetCostPerPacket(void) const;
+
+private:
+    virtual bool DoEnqueue(Ptr<QueueDiscItem> item);
+    virtual Ptr<QueueDiscItem> DoDequeue(void);
+    virtual bool CheckConfig(void);
+    virtual void InitializeParams(void);
+
+    /** \return the bucket of the item's IPv4 source address */
+    uint32_t Classify(Ptr<const QueueDiscItem> item) const;
+    /** Refill the bucket's tokens and take size bytes if available. */
+    bool Conform(uint32_t bucket, uint32_t size);
+    /** Drop the head packet of the longest internal queue. */
+    void DropFromLongestQueue(void);
+
+    uint32_t m_buckets;      //!< number of source hash buckets
+    DataRate m_sourceRate;   //!< token rate per bucket
+    uint32_t m_burst;        //!< token bucket depth in bytes
+    bool m_fairQueue;        //!< serve the buckets with DRR
+    uint32_t m_quantum;      //!< DRR quantum in bytes
+    uint32_t m_perturbation; //!< hash perturbation
+
+    std::vector<double> m_tokens;
+    std::vector<Time> m_lastRefill;
+    std::vector<int32_t> m_deficit;
+    std::vector<bool> m_active;
+    std::list<uint32_t> m_activeBuckets; //!< DRR round robin list
+
+    uint64_t m_processed;
+    uint64_t m_costNs;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(MitigationQueueDisc);
+
+TypeId MitigationQueueDisc::GetTypeId(void) {
+    static TypeId tid = TypeId("ns3::MitigationQueueDisc")
+        .SetParent<QueueDisc>()
+        .AddConstructor<MitigationQueueDisc>()
+        .AddAttribute("MaxSize", "The maximum number of packets accepted by this queue disc",
+                      QueueSizeValue(QueueSize("1000p")),
+                      MakeQueueSizeAccessor(&QueueDisc::SetMaxSize, &QueueDisc::GetMaxSize),
+                      MakeQueueSizeChecker())
+        .AddAttribute("Buckets", "Number of source hash buckets",
+                      UintegerValue(64),
+                      MakeUintegerAccessor(&MitigationQueueDisc::m_buckets),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("SourceRate", "Token bucket rate of each source bucket, 0 disables rate limiting",
+                      DataRateValue(DataRate(0)),
+                      MakeDataRateAccessor(&MitigationQueueDisc::m_sourceRate),
+                      MakeDataRateChecker())
+        .AddAttribute("Burst", "Token bucket depth in bytes",
+                      UintegerValue(16 * 1024),
+                      MakeUintegerAccessor(&MitigationQueueDisc::m_burst),
+                      MakeUintegerChecker<uint32_t>())
+        .AddAttribute("FairQueue", "Serve the source buckets with deficit round robin",
+                      BooleanValue(false),
+                      MakeBooleanAccessor(&MitigationQueueDisc::m_fairQueue),
+                      MakeBooleanChecker())
+        .AddAttribute("Quantum", "DRR quantum in bytes",
+                      UintegerValue(1514),
+                      MakeUintegerAccessor(&MitigationQueueDisc::m_quantum),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("Perturbation", "Perturbation of the source hash",
+                      UintegerValue(0),
+                      MakeUintegerAccessor(&MitigationQueueDisc::m_perturbation),
+                      MakeUintegerChecker<uint32_t>());
+    return tid;
+}
+
+MitigationQueueDisc::MitigationQueueDisc()
+    : QueueDisc(QueueDiscSizePolicy::MULTIPLE_QUEUES, QueueSizeUnit::PACKETS),
+      m_processed(0),
+      m_costNs(0) {
+    NS_LOG_FUNCTION(this);
+}
+
+MitigationQueueDisc::~MitigationQueueDisc() {
+    NS_LOG_FUNCTION(this);
+}
+
+uint64_t MitigationQueueDisc::GetProcessedPackets(void) const {
+    return m_processed;
+}
+
+double MitigationQueueDisc::GetCostPerPacket(void) const {
+    return m_processed > 0 ? (double) m_costNs / m_processed : 0.0;
+}
+
+uint32_t MitigationQueueDisc::Classify(Ptr<const QueueDiscItem> item) const {
+    Ptr<const Ipv4QueueDiscItem> ipv4Item = DynamicCast<const Ipv4QueueDiscItem>(item);
+    if (!ipv4Item) {
+        return 0;
+    }
+    // Knuth multiplicative hash of the source address
+    uint32_t h = (ipv4Item->GetHeader().GetSource().Get() ^ m_perturbation) * 2654435761u;
+    return (h >> 16) % m_buckets;
+}
+
+bool MitigationQueueDisc::Conform(uint32_t bucket, uint32_t size) {
+    Time now = Simulator::Now();
+    double refill = m_sourceRate.GetBitRate() / 8.0 * (now - m_lastRefill[bucket]).GetSeconds();
+    m_tokens[bucket] = std::min<double>(m_burst, m_tokens[bucket] + refill);
+    m_lastRefill[bucket] = now;
+    if (m_tokens[bucket] < size) {
+        return false;
+    }
+    m_tokens[bucket] -= size;
+    return true;
+}
+
+void MitigationQueueDisc::DropFromLongestQueue(void) {
+    uint32_t longest = 0;
+    uint32_t maxPackets = 0;
+    for (uint32_t i = 0; i < GetNInternalQueues(); ++i) {
+        uint32_t packets = GetInternalQueue(i)->GetNPackets();
+        if (packets > maxPackets) {
+            maxPackets = packets;
+            longest = i;
+        }
+    }
+    Ptr<QueueDiscItem> item = GetInternalQueue(longest)->Dequeue();
+    DropAfterDequeue(item, OVERLIMIT_DROP);
+}
+
+bool MitigationQueueDisc::DoEnqueue(Ptr<QueueDiscItem> item) {
+    NS_LOG_FUNCTION(this << item);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    uint32_t bucket = Classify(item);
+    bool accepted = false;
+    if (m_sourceRate.GetBitRate() > 0 && !Conform(bucket, item->GetSize())) {
+        DropBeforeEnqueue(item, RATE_LIMIT_DROP);
+    } else {
+        uint32_t queue = m_fairQueue ? bucket : 0;
+        // A full internal queue drops the item itself
+        accepted = GetInternalQueue(queue)->Enqueue(item);
+        if (accepted && m_fairQueue && !m_active[bucket]) {
+            m_active[bucket] = true;
+            m_deficit[bucket] = m_quantum;
+            m_activeBuckets.push_back(bucket);
+        }
+        if (accepted && GetCurrentSize() > GetMaxSize()) {
+            DropFromLongestQueue();
+        }
+    }
+
+    m_processed++;
+    m_costNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return accepted;
+}
+
+Ptr<QueueDiscItem> MitigationQueueDisc::DoDequeue(void) {
+    NS_LOG_FUNCTION(this);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    Ptr<QueueDiscItem> item;
+    if (!m_fairQueue) {
+        item = GetInternalQueue(0)->Dequeue();
+    } else {
+        while (!m_activeBuckets.empty()) {
+            uint32_t bucket = m_activeBuckets.front();
+            Ptr<InternalQueue> queue = GetInternalQueue(bucket);
+            Ptr<const QueueDiscItem> head = queue->Peek();
+            if (!head) {
+                // Emptied by an overlimit drop
+                m_activeBuckets.pop_front();
+                m_active[bucket] = false;
+                continue;
+            }
+            if (m_deficit[bucket] < (int32_t) head->GetSize()) {
+                m_deficit[bucket] += m_quantum;
+                m_activeBuckets.pop_front();
+                m_activeBuckets.push_back(bucket);
+                continue;
+            }
+            item = queue->Dequeue();
+            m_deficit[bucket] -= item->GetSize();
+            if (queue->IsEmpty()) {
+                m_activeBuckets.pop_front();
+                m_active[bucket] = false;
+            }
+            break;
+        }
+    }
+
+    m_costNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return item;
+}
+
+bool MitigationQueueDisc::CheckConfig(void) {
+    NS_LOG_FUNCTION(this);
+    if (GetNQueueDiscClasses() > 0) {
+        NS_LOG_ERROR("MitigationQueueDisc cannot have classes");
+        return false;
+    }
+    if (GetNPacketFilters() > 0) {
+        NS_LOG_ERROR("MitigationQueueDisc hashes packets itself and cannot have packet filters");
+        return false;
+    }
+    if (GetNInternalQueues() == 0) {
+        uint32_t queues = m_fairQueue ? m_buckets : 1;
+        for (uint32_t i = 0; i < queues; ++i) {
+            AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem> >("MaxSize", QueueSizeValue(GetMaxSize())));
+        }
+    }
+    if (GetNInternalQueues() != (m_fairQueue ? m_buckets : 1)) {
+        NS_LOG_ERROR("MitigationQueueDisc needs one internal queue per bucket with FairQueue, one otherwise");
+        return false;
+    }
+    return true;
+}
+
+void MitigationQueueDisc::InitializeParams(void) {
+    NS_LOG_FUNCTION(this);
+    m_tokens.assign(m_buckets, m_burst);
+    m_lastRefill.assign(m_buckets, Seconds(0));
+    m_deficit.assign(m_buckets, 0);
+    m_active.assign(m_buckets, false);
+}
+
 int main(int argc, char * argv[]) {
+    std::string serviceCsv = "ddos-service.csv";
+    std::string target = "user";
+    std::string mitigation = "none";
+    std::string sourceRate = "6Mbps";
+    bool distributed = false;
+    uint32_t numberOfBots = NUMBER_OF_BOTS;
+    std::string ddosRate = DDOS_RATE;
+    bool netanim = true;
+    double steadyState = 0;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("bots", "Number of attacking bots", numberOfBots);
+    cmd.AddValue("ddosRate", "Sending rate of each bot", ddosRate);
+    cmd.AddValue("netanim", "Write the NetAnim trace", netanim);
+    cmd.AddValue("steadyState", "Stop once the goodput CI half width is within this fraction of the mean (0 runs to the end)", steadyState);
+    cmd.AddValue("serviceCsv", "File for the per-interval goodput of legitimate and attack traffic", serviceCsv);
+    cmd.AddValue("target", "Victim of the attack and the legitimate sender: user (User 3) or server", target);
+    cmd.AddValue("mitigation", "Queue disc at CT towards the server: none, tbf, drr or tbf-drr", mitigation);
+    cmd.AddValue("sourceRate", "Per-source token bucket rate of the tbf mitigations", sourceRate);
+    cmd.AddValue("distributed", "Run on the distributed simulator with one MPI rank per district plus the core", distributed);
+    cmd.Parse(argc, argv);
+
+    uint32_t systemId = 0;
+    if (distributed) {
+#ifdef NS3_MPI
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable(&argc, &argv);
+        systemId = MpiInterface::GetSystemId();
+        if (MpiInterface::GetSize() != DISTRIBUTED_RANKS) {
+            NS_FATAL_ERROR("The distributed DDoS topology needs " << DISTRIBUTED_RANKS << " MPI ranks");
+        }
+#else
+        NS_FATAL_ERROR("Distributed runs need ns-3 configured with --enable-mpi");
+#endif
+    }
+    // Applications only run on the rank that owns their node
+    auto isLocal = [systemId](Ptr<Node> node) { return node->GetSystemId() == systemId; };
+    std::string rankSuffix = distributed ? "-rank" + std::to_string(systemId) : "";
+
+    if (target != "user" && target != "server") {
+        NS_FATAL_ERROR("Unknown target " << target);
+    }
+    if (mitigation != "none" && mitigation != "tbf" && mitigation != "drr" && mitigation != "tbf-drr") {
+        NS_FATAL_ERROR("Unknown mitigation " << mitigation);
+    }
+    if (numberOfBots == 0) {
+        NS_FATAL_ERROR("At least one bot is needed");
+    }
+    // Every rank would watch only its own receivers and stop on its own
+    if (steadyState > 0 && distributed) {
+        NS_FATAL_ERROR("Steady-state stopping is not supported on the distributed simulator");
+    }
+
     // Create nodes for all entities
+    // created one at a time so that each gets the system id of its district
     NodeContainer nodes;
-    nodes.Create(23); // 31 nodes in total, including users and bots
+    for (uint32_t i = 0; i < 23; ++i) { // 31 nodes in total, including users and bots
+        nodes.Create(1, distributed ? NODE_RANK[i] : 0);
+    }
 
     // Additional user nodes in residential and commercial areas
     NodeContainer users;
-    users.Create(12);
+    for (uint32_t i = 0; i < 12; ++i) {
+        users.Create(1, distributed ? USER_RANK[i] : 0);
+    }
 
     // Create nodes for bots
     NodeContainer botNodes;
-    botNodes.Create(NUMBER_OF_BOTS);
+    for (uint32_t i = 0; i < numberOfBots; ++i) {
+        botNodes.Create(1, distributed ? BOT_RANK[i % NUMBER_OF_BOTS] : 0);
+    }
 
     // PP
     CsmaHelper csmaPP;
@@ -72,18 +811,18 @@ int main(int argc, char * argv[]) {
     NodeContainer containerPPSub2 = NodeContainer(nodes.Get(2), nodes.Get(5), nodes.Get(6));
     NetDeviceContainer devicesPPSub2 = csmaPPSub2.Install(containerPPSub2);
 
-    // Include 5 bots
+    // Include half of the bots
     CsmaHelper csmaPPSub1R1;
     csmaPPSub1R1.SetChannelAttribute("DataRate", StringValue("100Mbps"));
     csmaPPSub1R1.SetChannelAttribute("Delay", StringValue("2ms"));
 NodeContainer containerPPSub1R1;
 containerPPSub1R1.Add(nodes.Get(3));
 containerPPSub1R1.Add(users.Get(0));
-containerPPSub1R1.Add(botNodes.Get(0));
-containerPPSub1R1.Add(botNodes.Get(1));
-containerPPSub1R1.Add(botNodes.Get(2));
-containerPPSub1R1.Add(botNodes.Get(3));
-containerPPSub1R1.Add(botNodes.Get(4));
+for (uint32_t k = 0; k < numberOfBots; ++k) {
+    if (BOT_RANK[k % NUMBER_OF_BOTS] == 1) {
+        containerPPSub1R1.Add(botNodes.Get(k));
+    }
+}
     NetDeviceContainer devicesPPSub1R1 = csmaPPSub1R1.Install(containerPPSub1R1);
 
     CsmaHelper csmaPPSub1C1;
@@ -135,11 +874,16 @@ containerPPSub1R1.Add(botNodes.Get(4));
     NodeContainer containerWTFSub1H1 = NodeContainer(nodes.Get(9), users.Get(5));
     NetDeviceContainer devicesWTFSub1H1 = csmaWTFSub1H1.Install(containerWTFSub1H1);
 
-    // Include 2 bots
+    // Include a fifth of the bots
     CsmaHelper csmaWTFSub2HH2;
     csmaWTFSub2HH2.SetChannelAttribute("DataRate", StringValue("100Mbps"));
     csmaWTFSub2HH2.SetChannelAttribute("Delay", StringValue("2ms"));
-    NodeContainer containerWTFSub2HH2 = NodeContainer(nodes.Get(11), users.Get(6), botNodes.Get(5), botNodes.Get(6));
+    NodeContainer containerWTFSub2HH2 = NodeContainer(nodes.Get(11), users.Get(6));
+    for (uint32_t k = 0; k < numberOfBots; ++k) {
+        if (BOT_RANK[k % NUMBER_OF_BOTS] == 2) {
+            containerWTFSub2HH2.Add(botNodes.Get(k));
+        }
+    }
     NetDeviceContainer devicesWTFSub2HH2 = csmaWTFSub2HH2.Install(containerWTFSub2HH2);
 
     CsmaHelper csmaWTFSub2H2;
@@ -185,11 +929,16 @@ containerPPSub1R1.Add(botNodes.Get(4));
     NodeContainer containerTCSSub2V2 = NodeContainer(nodes.Get(16), users.Get(10));
     NetDeviceContainer devicesTCSSub2V2 = csmaTCSSub2V2.Install(containerTCSSub2V2);
 
-    // Include last 3 bots
+    // Include the remaining bots
     CsmaHelper csmaTCSSub2PTM2;
     csmaTCSSub2PTM2.SetChannelAttribute("DataRate", StringValue("100Mbps"));
     csmaTCSSub2PTM2.SetChannelAttribute("Delay", StringValue("2ms"));
-    NodeContainer containerTCSSub2PTM2 = NodeContainer(nodes.Get(17), users.Get(11), botNodes.Get(7), botNodes.Get(8), botNodes.Get(9));
+    NodeContainer containerTCSSub2PTM2 = NodeContainer(nodes.Get(17), users.Get(11));
+    for (uint32_t k = 0; k < numberOfBots; ++k) {
+        if (BOT_RANK[k % NUMBER_OF_BOTS] == 3) {
+            containerTCSSub2PTM2.Add(botNodes.Get(k));
+        }
+    }
     NetDeviceContainer devicesTCSSub2PTM2 = csmaTCSSub2PTM2.Install(containerTCSSub2PTM2);
 
     // CT
@@ -232,6 +981,18 @@ containerPPSub1R1.Add(botNodes.Get(4));
     stack.Install(botNodes);
     stack.Install(nodes);
 
+    // Mitigation stage on CT (node 21) towards the server. Installed before the
+    // addresses are assigned, otherwise the default queue disc is installed
+    QueueDiscContainer mitigationQueueDiscs;
+    if (mitigation != "none") {
+        bool rateLimit = mitigation == "tbf" || mitigation == "tbf-drr";
+        TrafficControlHelper tch;
+        tch.SetRootQueueDisc("ns3::MitigationQueueDisc",
+                             "SourceRate", DataRateValue(DataRate(rateLimit ? sourceRate : "0bps")),
+                             "FairQueue", BooleanValue(mitigation != "tbf"));
+        mitigationQueueDiscs = tch.Install(devicesServer.Get(0));
+    }
+
     // Assign IP addresses to the PP nodes
     Ipv4AddressHelper addressPP, addressPPSub1, addressPPSub2, addressPPSub1R1, addressPPSub1C1, addressPPSub2R2, addressPPSub2C2, addressPPSub1R1C1;
     addressPP.SetBase("10.1.1.0", "255.255.255.0");
@@ -305,6 +1066,14 @@ containerPPSub1R1.Add(botNodes.Get(4));
     Ipv4InterfaceContainer interfacesCT = addressCT.Assign(devicesServer.Get(0)); // node 21
     Ipv4InterfaceContainer interfacesServer = addressServer.Assign(devicesServer.Get(1)); // node 22
 
+    // Assign IP addresses to the CT mesh, one subnet per link, so the districts can reach each other
+    Ipv4AddressHelper addressMesh;
+    addressMesh.SetBase("10.4.2.0", "255.255.255.0");
+    for (uint32_t i = 0; i < devicesMesh.GetN(); i += 2) {
+        addressMesh.Assign(NetDeviceContainer(devicesMesh.Get(i), devicesMesh.Get(i + 1)));
+        addressMesh.NewNetwork();
+    }
+
     // Add constant mobility to all the nodes
     MobilityHelper mobility;
     mobility.SetPositionAllocator("ns3::GridPositionAllocator",
@@ -322,108 +1091,203 @@ containerPPSub1R1.Add(botNodes.Get(4));
     // Create the server and client applications
     UdpEchoServerHelper echoServer(9);
 
-    ApplicationContainer serverApps = echoServer.Install(nodes.Get(4));
+    ApplicationContainer serverApps;
+    if (isLocal(nodes.Get(4))) {
+        serverApps = echoServer.Install(nodes.Get(4));
+    }
     serverApps.Start(Seconds(1.0));
     serverApps.Stop(Seconds(10.0));
 
-    UdpEchoClientHelper echoClient(interfacesPP.GetAddress(0), 9);
+    UdpEchoClientHelper echoClient(interfacesPPSub1.GetAddress(2), 9); // node 4 runs the echo server
     echoClient.SetAttribute("MaxPackets", UintegerValue(100));
     echoClient.SetAttribute("Interval", TimeValue(Seconds(1.0)));
     echoClient.SetAttribute("PacketSize", UintegerValue(1024));
 
-    ApplicationContainer clientApps = echoClient.Install(users.Get(5));
+    ApplicationContainer clientApps;
+    if (isLocal(users.Get(5))) {
+        clientApps = echoClient.Install(users.Get(5));
+    }
     clientApps.Start(Seconds(2.0));
     clientApps.Stop(Seconds(10.0));
 
     // region Bot
+    // The attacked address: User 3, or the server behind CT
+    Ipv4Address victimAddress = interfacesPPSub2C2.GetAddress(1);
+    Ptr<Node> victimNode = users.Get(3);
+    if (target == "server") {
+        victimAddress = interfacesServer.GetAddress(0);
+        victimNode = nodes.Get(22);
+    }
+
     // Generate Traffic of DDoS Attacks
-    OnOffHelper onoff("ns3::UdpSocketFactory", Address(InetSocketAddress(interfacesPPSub2C2.GetAddress(1), UDP_SINK_PORT)));
-    onoff.SetConstantRate(DataRate(DDOS_RATE));
+    OnOffHelper onoff("ns3::UdpSocketFactory", Address(InetSocketAddress(victimAddress, UDP_SINK_PORT)));
+    onoff.SetConstantRate(DataRate(ddosRate));
     onoff.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=30]"));
     onoff.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-    ApplicationContainer onOffApp[NUMBER_OF_BOTS];
+    // the send time for the one-way delay at the sink, see ServiceMetrics
+    onoff.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(true));
+    std::vector<ApplicationContainer> onOffApp(numberOfBots);
 
     //Install application in all bots
-    for (int k = 0; k < NUMBER_OF_BOTS; ++k) {
-        onOffApp[k] = onoff.Install(botNodes.Get(k));
+    for (uint32_t k = 0; k < numberOfBots; ++k) {
+        if (isLocal(botNodes.Get(k))) {
+            onOffApp[k] = onoff.Install(botNodes.Get(k));
+        }
         onOffApp[k].Start(Seconds(2.0));
         onOffApp[k].Stop(Seconds(MAX_SIMULATION_TIME));
     }
 
-    // Receiver Application (UDP Packet Sink)
-    PacketSinkHelper packetSinkHelper("ns3::UdpSocketFactory", InetSocketAddress(interfacesPPSub2C2.GetAddress(1), UDP_SINK_PORT));
-    ApplicationContainer packetSinkApp = packetSinkHelper.Install(nodes.Get(1));
+    // Receiver Application (UDP Packet Sink), on the node that owns the attacked address
+    PacketSinkHelper packetSinkHelper("ns3::UdpSocketFactory", InetSocketAddress(victimAddress, UDP_SINK_PORT));
+    packetSinkHelper.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(true));
+    ApplicationContainer packetSinkApp;
+    if (isLocal(victimNode)) {
+        packetSinkApp = packetSinkHelper.Install(victimNode);
+    }
     packetSinkApp.Start(Seconds(1.0));
     packetSinkApp.Stop(Seconds(MAX_SIMULATION_TIME));
 
     // Sender Application (Packets generated by this application are throttled)
-    OnOffHelper onoffHelper("ns3::UdpSocketFactory", InetSocketAddress(interfacesPPSub2C2.GetAddress(1), UDP_SINK_PORT));
+    OnOffHelper onoffHelper("ns3::UdpSocketFactory", InetSocketAddress(victimAddress, UDP_SINK_PORT));
     onoffHelper.SetAttribute("DataRate", DataRateValue(DataRate("5Mbps"))); // Set the desired data rate for the sender
     onoffHelper.SetAttribute("PacketSize", UintegerValue(1024)); // Set the packet size for the sender
-    ApplicationContainer senderApp = onoffHelper.Install(nodes.Get(0));
+    onoffHelper.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(true));
+    ApplicationContainer senderApp;
+    if (isLocal(nodes.Get(0))) {
+        senderApp = onoffHelper.Install(nodes.Get(0));
+    }
     senderApp.Start(Seconds(2.0));
-    senderApp.Stop(Seconds(MAX_SIMULATION_TIME - 10));
+    senderApp.Stop(Seconds(MAX_SIMULATION_TIME));
     // endregion
 
+    // Tell legitimate from attack traffic and measure it at the receivers
+    ServiceMetrics serviceMetrics;
+    serviceMetrics.AddEchoClient(clientApps);
+    serviceMetrics.AddSender(nodes.Get(0), senderApp, TRAFFIC_LEGIT);
+    for (uint32_t k = 0; k < numberOfBots; ++k) {
+        serviceMetrics.AddSender(botNodes.Get(k), onOffApp[k], TRAFFIC_ATTACK);
+    }
+    serviceMetrics.AddReceiver(packetSinkApp, "sink");
+    serviceMetrics.AddReceiver(serverApps, "echo-server");
+    if (mitigationQueueDiscs.GetN() > 0 && isLocal(nodes.Get(21))) {
+        serviceMetrics.AddQueueDisc(mitigationQueueDiscs.Get(0));
+    }
+
+    // Stop early once the goodput at the receivers has settled
+    SteadyStateMonitor steadyStateMonitor;
+    if (steadyState > 0) {
+        steadyStateMonitor.Configure(steadyState);
+        steadyStateMonitor.AddMetric("legit goodput (Mbps)");
+        steadyStateMonitor.AddMetric("attack goodput (Mbps)");
+        Simulator::Schedule(Seconds(STEADY_STATE_INTERVAL), &SampleSteadyState, &steadyStateMonitor, &serviceMetrics);
+    }
+
     // Populate the routing tables
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 
     // Enable PCAP Tracing
-    csmaPPSub2R2.EnablePcap("ddos", devicesPPSub2R2.Get(0), true);
-
-    // Animation Interface
-    AnimationInterface anim("ddos.xml");
-
-    // Label the main nodes
-    anim.UpdateNodeDescription(nodes.Get(0), "PP");
-    anim.UpdateNodeDescription(nodes.Get(1), "PP_S1");
-    anim.UpdateNodeDescription(nodes.Get(2), "PP_S2");
-    anim.UpdateNodeDescription(nodes.Get(3), "PP_S1_R1");
-    anim.UpdateNodeDescription(nodes.Get(4), "PP_S1_C1");
-    anim.UpdateNodeDescription(nodes.Get(5), "PP_S2_R2");
-    anim.UpdateNodeDescription(nodes.Get(6), "PP_S2_C2");
-    anim.UpdateNodeDescription(nodes.Get(20), "WTF");
-    anim.UpdateNodeDescription(nodes.Get(7), "WTF_S1");
-    anim.UpdateNodeDescription(nodes.Get(10), "WTF_S2");
-    anim.UpdateNodeDescription(nodes.Get(8), "WTF_S1_HH1");
-    anim.UpdateNodeDescription(nodes.Get(9), "WTF_S1_H1");
-    anim.UpdateNodeDescription(nodes.Get(11), "WTF_S2_HH2");
-    anim.UpdateNodeDescription(nodes.Get(12), "WTF_S2_H2");
-    anim.UpdateNodeDescription(nodes.Get(13), "TCS");
-    anim.UpdateNodeDescription(nodes.Get(15), "TCS_S1");
-    anim.UpdateNodeDescription(nodes.Get(14), "TCS_S2");
-    anim.UpdateNodeDescription(nodes.Get(18), "TCS_S1_V1");
-    anim.UpdateNodeDescription(nodes.Get(19), "TCS_S1_PTM1");
-    anim.UpdateNodeDescription(nodes.Get(16), "TCS_S2_V2");
-    anim.UpdateNodeDescription(nodes.Get(17), "TCS_S2_PTM2");
-    anim.UpdateNodeDescription(nodes.Get(21), "CT");
-    anim.UpdateNodeDescription(nodes.Get(22), "Server");
-    for (int i = 0; i < 23; i++) {
-        anim.UpdateNodeColor(nodes.Get(i), 0, 0, 255);
-    }
-
-    // Label the user nodes
-    for (int i = 0; i < 12; i++) {
-        std::ostringstream oss;
-        oss << "User " << i;
-        anim.UpdateNodeDescription(users.Get(i), oss.str());
-        anim.UpdateNodeColor(users.Get(i), 0, 255, 0);
-    }
-
-    // Label the attacker nodes
-    for (int i = 0; i < 10; i++) {
-        std::ostringstream oss;
-        oss << "Bot " << i;
-        anim.UpdateNodeDescription(botNodes.Get(i), oss.str());
-        anim.UpdateNodeColor(botNodes.Get(i), 255, 0, 0);
-    }
-
-    // Change the size of the nodes
-    for (int i = 0; i < 45; i++) {
-        anim.UpdateNodeSize(i, 10, 10);
+    if (isLocal(nodes.Get(5))) {
+        csmaPPSub2R2.EnablePcap("ddos", devicesPPSub2R2.Get(0), true);
     }
 
+    // Animation Interface, one file per rank when distributed. Off for the
+    // probe runs of ddos_saturation_search.py, where the trace dominates the run time
+    std::unique_ptr<AnimationInterface> anim;
+    if (netanim) {
+        anim.reset(new AnimationInterface("ddos" + rankSuffix + ".xml"));
+
+        // Label the main nodes
+        anim->UpdateNodeDescription(nodes.Get(0), "PP");
+        anim->UpdateNodeDescription(nodes.Get(1), "PP_S1");
+        anim->UpdateNodeDescription(nodes.Get(2), "PP_S2");
+        anim->UpdateNodeDescription(nodes.Get(3), "PP_S1_R1");
+        anim->UpdateNodeDescription(nodes.Get(4), "PP_S1_C1");
+        anim->UpdateNodeDescription(nodes.Get(5), "PP_S2_R2");
+        anim->UpdateNodeDescription(nodes.Get(6), "PP_S2_C2");
+        anim->UpdateNodeDescription(nodes.Get(20), "WTF");
+        anim->UpdateNodeDescription(nodes.Get(7), "WTF_S1");
+        anim->UpdateNodeDescription(nodes.Get(10), "WTF_S2");
+        anim->UpdateNodeDescription(nodes.Get(8), "WTF_S1_HH1");
+        anim->UpdateNodeDescription(nodes.Get(9), "WTF_S1_H1");
+        anim->UpdateNodeDescription(nodes.Get(11), "WTF_S2_HH2");
+        anim->UpdateNodeDescription(nodes.Get(12), "WTF_S2_H2");
+        anim->UpdateNodeDescription(nodes.Get(13), "TCS");
+        anim->UpdateNodeDescription(nodes.Get(15), "TCS_S1");
+        anim->UpdateNodeDescription(nodes.Get(14), "TCS_S2");
+        anim->UpdateNodeDescription(nodes.Get(18), "TCS_S1_V1");
+        anim->UpdateNodeDescription(nodes.Get(19), "TCS_S1_PTM1");
+        anim->UpdateNodeDescription(nodes.Get(16), "TCS_S2_V2");
+        anim->UpdateNodeDescription(nodes.Get(17), "TCS_S2_PTM2");
+        anim->UpdateNodeDescription(nodes.Get(21), "CT");
+        anim->UpdateNodeDescription(nodes.Get(22), "Server");
+        for (int i = 0; i < 23; i++) {
+            anim->UpdateNodeColor(nodes.Get(i), 0, 0, 255);
+        }
+
+        // Label the user nodes
+        for (int i = 0; i < 12; i++) {
+            std::ostringstream oss;
+            oss << "User " << i;
+            anim->UpdateNodeDescription(users.Get(i), oss.str());
+            anim->UpdateNodeColor(users.Get(i), 0, 255, 0);
+        }
+
+        // Label the attacker nodes
+        for (uint32_t i = 0; i < botNodes.GetN(); i++) {
+            std::ostringstream oss;
+            oss << "Bot " << i;
+            anim->UpdateNodeDescription(botNodes.Get(i), oss.str());
+            anim->UpdateNodeColor(botNodes.Get(i), 255, 0, 0);
+        }
+
+        // Change the size of the nodes
+        for (uint32_t i = 0; i < NodeList::GetNNodes(); i++) {
+            anim->UpdateNodeSize(i, 10, 10);
+        }
+    }
+
+    std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
     Simulator::Run();
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    std::cout << "Simulation wall time" << rankSuffix << ": " << wallTime << " s" << std::endl;
+
+    // Each rank only sees the packets sent and received by its own nodes
+    serviceMetrics.Report(std::cout);
+    serviceMetrics.WriteTimeSeries(distributed ? serviceCsv + rankSuffix : serviceCsv);
+
+    double endTime = MAX_SIMULATION_TIME;
+    if (steadyState > 0) {
+        steadyStateMonitor.Report(std::cout);
+        if (steadyStateMonitor.IsSteady()) {
+            endTime = steadyStateMonitor.GetStopTime().GetSeconds();
+        }
+    }
+
+    // Goodput of the legit OnOff at the attacked sink, the echo exchange left
+    // out. Sender and sink must be on one rank for the ratio to mean anything.
+    std::cout << "Mitigation " << mitigation << " (target " << target << ")" << std::endl;
+    if (isLocal(nodes.Get(0)) && isLocal(victimNode)) {
+        double legitSent = serviceMetrics.GetTxBytes(TRAFFIC_LEGIT) - serviceMetrics.GetEchoTxBytes();
+        double legitReceived = serviceMetrics.GetRxBytes(TRAFFIC_LEGIT, "sink");
+        std::cout << "  legit goodput " << legitReceived * 8 / (endTime - 2.0) / 1e6 << " Mbps, "
+                  << (legitSent > 0 ? legitReceived / legitSent * 100 : 0) << "% of the legit bytes sent"
+                  << std::endl;
+    } else if (isLocal(victimNode)) {
+        std::cout << "  legit goodput not measured, the legit sender runs on another rank" << std::endl;
+    }
+    if (mitigationQueueDiscs.GetN() > 0 && isLocal(nodes.Get(21))) {
+        Ptr<MitigationQueueDisc> qd = DynamicCast<MitigationQueueDisc>(mitigationQueueDiscs.Get(0));
+        std::cout << "  " << qd->GetProcessedPackets() << " packets, " << qd->GetCostPerPacket()
+                  << " ns per packet" << std::endl;
+        std::cout << qd->GetStats() << std::endl;
+    }
+
     Simulator::Destroy();
+    anim.reset();
+#ifdef NS3_MPI
+    if (distributed) {
+        MpiInterface::Disable();
+    }
+#endif
     return 0;
 }
\ No newline at end of file
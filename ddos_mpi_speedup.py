@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+## @package ddos_mpi_speedup
+# Speedup of the distributed DDoS scenario over the sequential one.
+#
+# Runs scratch/ddos on the default (sequential) simulator and under MPI with
+# one rank per district plus the core (--distributed=1, 4 ranks on this
+# machine), and compares the wall time of Simulator::Run reported by the
+# program as well as the wall time of the whole process.
+#
+# ns-3 has to be configured with --enable-mpi. Run it from the ns-3 root
+# directory:
+#    ./scratch/ddos_mpi_speedup.py --runs=3 --args="--target=server --mitigation=drr"
+
+import argparse
+import re
+import subprocess
+import sys
+import time
+
+RANKS = 4
+WALL_TIME = re.compile(r"Simulation wall time(?:-rank\d+)?: ([0-9.eE+-]+) s")
+
+
+def run (command):
+    """Run one simulation, return (Simulator::Run wall time, process wall time)"""
+    start = time.time ()
+    proc = subprocess.run (command, shell=True, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                           universal_newlines=True)
+    elapsed = time.time () - start
+    if proc.returncode != 0:
+        sys.stdout.write (proc.stdout)
+        sys.exit ("Command failed: " + command)
+    # every rank reports its own Run time, the slowest one is the simulation time
+    times = [float (t) for t in WALL_TIME.findall (proc.stdout)]
+    if not times:
+        sys.exit ("No wall time in the output of: " + command)
+    return max (times), elapsed
+
+
+def main ():
+    parser = argparse.ArgumentParser (description="Speedup of the distributed DDoS scenario over the sequential one")
+    parser.add_argument ("--program", default="scratch/ddos")
+    parser.add_argument ("--args", default="", help="arguments passed to the program in both modes")
+    parser.add_argument ("--runs", type=int, default=3, help="repetitions of each mode, the best is kept")
+    parser.add_argument ("--mpiexec", default="mpiexec -np %d" % RANKS)
+    options = parser.parse_args ()
+
+    # build once so that the build is not timed
+    subprocess.check_call ("./ns3 build", shell=True)
+
+    sequential = './ns3 run --no-build "%s %s"' % (options.program, options.args)
+    distributed = './ns3 run --no-build %s --command-template="%s %%s --distributed=1 %s"' % (
+        options.program, options.mpiexec, options.args)
+
+    results = {}
+    for name, command in (("sequential", sequential), ("distributed", distributed)):
+        samples = [run (command) for _ in range (options.runs)]
+        results[name] = (min (s[0] for s in samples), min (s[1] for s in samples))
+        print ("%-12s run %8.3f s   process %8.3f s" % (name, results[name][0], results[name][1]))
+
+    print ("speedup      run %8.2fx  process %8.2fx" % (
+        results["sequential"][0] / results["distributed"][0],
+        results["sequential"][1] / results["distributed"][1]))
+
+
+if __name__ == "__main__":
+    main ()
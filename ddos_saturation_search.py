@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+## @package ddos_saturation_search
+# Saturation point of the DDoS scenario.
+#
+# Searches the attack intensity, either the number of bots (--dimension=bots)
+# or the per-bot rate in kb/s (--dimension=rate), at which the legitimate
+# OnOff of scratch/ddos gets below --threshold percent of its bytes to the sink.
+# The goodput is taken to fall monotonically with the intensity, so instead of
+# sweeping a grid the interval [lo, hi] is cut into --workers + 1 parts every
+# round and the probes at the cut points run in parallel, one process each.
+# The interval shrinks by that factor per round until it is narrower than the
+# tolerance: 100 bots with 3 workers need 4 rounds, 12 runs.
+#
+# lo is assumed to keep the service up and hi to take it down; no run is spent
+# checking that, a bracket touching either end means the range was too small.
+#
+# Run it from the ns-3 root directory:
+#    ./scratch/ddos_saturation_search.py --dimension=bots --lo=1 --hi=100 --fixed=20480
+#    ./scratch/ddos_saturation_search.py --dimension=rate --lo=256 --hi=40960 --fixed=10 --args="--mitigation=drr"
+
+import argparse
+import concurrent.futures
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+GOODPUT = re.compile(r"legit goodput ([0-9.eE+-]+) Mbps, ([0-9.eE+-]+)% of the legit bytes sent")
+# per-class line of the service metrics, zero sent means nothing was counted as legit
+LEGIT_SENT = re.compile(r"^  legit: sent ([0-9]+) received", re.MULTILINE)
+
+
+def probe (options, value):
+    """Run the scenario at one intensity, return (legit goodput in Mbps, percent delivered)"""
+    bots, rate = (value, options.fixed) if options.dimension == "bots" else (options.fixed, value)
+    # each probe gets its own directory for the pcap and CSV files
+    cwd = tempfile.mkdtemp (prefix="ddos-probe-")
+    command = './ns3 run --no-build --cwd=%s "%s --bots=%d --ddosRate=%dkb/s --netanim=0 %s"' % (
+        cwd, options.program, bots, rate, options.args)
+    try:
+        proc = subprocess.run (command, shell=True, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                               universal_newlines=True)
+    finally:
+        shutil.rmtree (cwd, ignore_errors=True)
+    if proc.returncode != 0:
+        sys.stdout.write (proc.stdout)
+        sys.exit ("Command failed: " + command)
+    # without this a run whose legit traffic goes uncounted reads as a service
+    # that is down, and the search quietly ends at --lo
+    sent = LEGIT_SENT.search (proc.stdout)
+    if not sent or int (sent.group (1)) == 0:
+        sys.exit ("No legit packets counted in the output of: " + command)
+    match = GOODPUT.search (proc.stdout)
+    if not match:
+        sys.exit ("No legit goodput in the output of: " + command)
+    return float (match.group (1)), float (match.group (2))
+
+
+def cut_points (lo, hi, parts):
+    """Distinct integer points strictly inside (lo, hi) splitting it into about parts pieces"""
+    points = sorted (set (lo + (hi - lo) * i // parts for i in range (1, parts)))
+    return [p for p in points if lo < p < hi]
+
+
+def main ():
+    parser = argparse.ArgumentParser (description="Saturation point of the DDoS scenario")
+    parser.add_argument ("--program", default="scratch/ddos")
+    parser.add_argument ("--args", default="", help="further arguments passed to every run")
+    parser.add_argument ("--dimension", choices=("bots", "rate"), default="bots",
+                         help="intensity that is searched, the other one is --fixed")
+    parser.add_argument ("--fixed", type=int, default=20480,
+                         help="per-bot rate in kb/s when searching bots, bot count when searching rate")
+    parser.add_argument ("--lo", type=int, default=1, help="intensity at which the service is still up")
+    parser.add_argument ("--hi", type=int, default=100, help="intensity at which the service is down")
+    parser.add_argument ("--threshold", type=float, default=50.0,
+                         help="percent of the legit bytes that must arrive for the service to be up")
+    parser.add_argument ("--tolerance", type=int, default=None,
+                         help="width of the final bracket, 1 bot or 256 kb/s by default")
+    parser.add_argument ("--workers", type=int, default=min (4, os.cpu_count () or 1))
+    options = parser.parse_args ()
+    if options.tolerance is None:
+        options.tolerance = 1 if options.dimension == "bots" else 256
+    if options.lo >= options.hi:
+        sys.exit ("--lo must be below --hi")
+
+    subprocess.check_call ("./ns3 build", shell=True)
+
+    lo, hi = options.lo, options.hi
+    runs = 0
+    with concurrent.futures.ThreadPoolExecutor (max_workers=options.workers) as pool:
+        while hi - lo > options.tolerance:
+            points = cut_points (lo, hi, options.workers + 1)
+            if not points:
+                break
+            results = list (pool.map (lambda p: probe (options, p), points))
+            runs += len (points)
+            for point, (goodput, delivered) in zip (points, results):
+                print ("%s %8d   legit goodput %8.3f Mbps  %6.2f%%" % (
+                    options.dimension, point, goodput, delivered))
+            # the bracket moves to the first cut point where the service is down
+            for point, (goodput, delivered) in zip (points, results):
+                if delivered < options.threshold:
+                    hi = point
+                    break
+                lo = point
+
+    unit = "bots" if options.dimension == "bots" else "kb/s per bot"
+    print ("saturation between %d and %d %s (%d runs)" % (lo, hi, unit, runs))
+    if lo == options.lo or hi == options.hi:
+        print ("the bracket touches the searched range, widen --lo/--hi to confirm it")
+
+
+if __name__ == "__main__":
+    main ()
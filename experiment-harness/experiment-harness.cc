@@ -0,0 +1,213 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+
+#include "experiment-harness.h"
+
+#include "simulator-cost.h"
+#include "telemetry.h"
+
+#include "ns3/log.h"
+#include "ns3/mobility-model.h"
+#include "ns3/netanim-module.h"
+#include "ns3/packet.h"
+#include "ns3/packet-socket-helper.h"
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ExperimentHarness");
+
+ExperimentHarness::ExperimentHarness (std::string name, const TopologyPolicy &topology,
+                                      const TrafficPolicy &traffic,
+                                      const MobilityPolicy &mobility)
+  : m_name (name),
+    m_topology (topology),
+    m_traffic (traffic),
+    m_mobility (mobility),
+    m_start (Seconds (0.5)),
+    m_stop (Seconds (210.0)),
+    m_end (0),
+    m_events (0),
+    m_wallTime (0)
+{
+  m_meter.Configure (Seconds (1.0), 1);
+}
+
+void
+ExperimentHarness::SetReceivers (const std::vector<uint32_t> &receivers)
+{
+  m_receivers = receivers;
+}
+
+void
+ExperimentHarness::SetMeter (Time interval, uint32_t window, Time start, Time stop)
+{
+  m_meter.Configure (interval, window);
+  m_start = start;
+  m_stop = stop;
+}
+
+void
+ExperimentHarness::SetAnimation (std::string prefix)
+{
+  m_animation = prefix;
+}
+
+void
+ExperimentHarness::SetStopTime (Time end)
+{
+  m_end = end;
+}
+
+void
+ExperimentHarness::ReceivePacket (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  Address sourceAddress;
+  while ((packet = socket->RecvFrom (sourceAddress)))
+    {
+      m_meter.Receive (socket->GetNode (), sourceAddress, packet->GetSize ());
+
+      // The position is only looked up for the sampled packets
+      if (TELEMETRY_SAMPLE ("ExperimentHarness", 100))
+        {
+          Ptr<Node> node = socket->GetNode ();
+          Vector position = node->GetObject<MobilityModel> ()->GetPosition ();
+          TELEMETRY_EMIT ("ExperimentHarness", "Node " << node->GetId () << " received "
+                          << packet->GetSize () << " bytes from " << sourceAddress << " at "
+                          << position);
+        }
+    }
+}
+
+Ptr<Socket>
+ExperimentHarness::SetupPacketReceive (Ptr<Node> node)
+{
+  TypeId tid = TypeId::LookupByName ("ns3::PacketSocketFactory");
+  Ptr<Socket> sink = Socket::CreateSocket (node, tid);
+  if (sink->Bind () != 0)
+    {
+      NS_LOG_ERROR ("Failed to bind the socket of node " << node->GetId ());
+      return sink;
+    }
+  sink->SetRecvCallback (MakeCallback (&ExperimentHarness::ReceivePacket, this));
+  m_meter.AddReceiver (node);
+  return sink;
+}
+
+ParallelExperiments::Curves
+ExperimentHarness::Run (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
+                        const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel)
+{
+  SimulatorCost::Enable ();
+
+  NodeContainer c;
+  c.Create (m_topology.GetN ());
+
+  PacketSocketHelper packetSocket;
+  packetSocket.Install (c);
+
+  YansWifiPhyHelper phy = wifiPhy;
+  phy.SetChannel (wifiChannel.Create ());
+
+  WifiMacHelper mac = wifiMac;
+  NetDeviceContainer devices = wifi.Install (phy, mac, c);
+
+  m_topology.Install (c);
+  m_traffic.Install (c, devices);
+
+  std::vector<uint32_t> receivers = m_receivers;
+  if (receivers.empty ())
+    {
+      for (uint32_t i = 0; i < c.GetN (); ++i)
+        {
+          receivers.push_back (i);
+        }
+    }
+  for (uint32_t receiver : receivers)
+    {
+      NS_ABORT_MSG_IF (receiver >= c.GetN (), "Receiver " << receiver << " of " << c.GetN () << " nodes");
+      SetupPacketReceive (c.Get (receiver));
+    }
+
+  // Sample every receiver at its own position, before the nodes move on
+  m_meter.SetAbscissa ([] (Ptr<Node> node) {
+    return node->GetObject<MobilityModel> ()->GetPosition ().x;
+  });
+  m_meter.Start (m_start, m_stop);
+  // after the meter, so that a sample and a move due at the same time keep
+  // that order. A walker stops being sampled at its last x, the samples due
+  // later up to m_stop would all repeat it.
+  m_mobility.Install (c, [this] (Ptr<Node> node) { m_meter.Stop (node); });
+
+  std::unique_ptr<AnimationInterface> anim;
+  if (!m_animation.empty ())
+    {
+      anim.reset (new AnimationInterface (m_animation + "-" + m_name + ".xml"));
+      for (uint32_t i = 0; i < c.GetN (); ++i)
+        {
+          anim->UpdateNodeSize (c.Get (i)->GetId (), 0.5, 0.5);
+        }
+    }
+
+  if (!m_end.IsZero ())
+    {
+      // one step later, so that a sample due at m_end is still taken
+      Simulator::Stop (m_end + TimeStep (1));
+    }
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  m_wallTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ();
+  m_events = Simulator::GetEventCount ();
+  Simulator::Destroy ();
+
+  std::ostringstream flows;
+  m_meter.Report (flows);
+  NS_LOG_INFO ("Bytes received per flow:\n" << flows.str ());
+  return m_meter.GetCurves ();
+}
+
+uint64_t
+ExperimentHarness::GetBytes (void) const
+{
+  uint64_t bytes = 0;
+  for (uint32_t i = 0; i < m_meter.GetNReceivers (); ++i)
+    {
+      bytes += m_meter.GetBytes (i);
+    }
+  return bytes;
+}
+
+uint64_t
+ExperimentHarness::GetEventCount (void) const
+{
+  return m_events;
+}
+
+double
+ExperimentHarness::GetWallTime (void) const
+{
+  return m_wallTime;
+}
+
+ParallelExperiments::CurvesJob
+ExperimentHarness::MakeJob (const TopologyPolicy &topology, const TrafficPolicy &traffic,
+                            const MobilityPolicy &mobility,
+                            const std::vector<uint32_t> &receivers, uint32_t window,
+                            std::string animation, const WifiHelper &wifi,
+                            const YansWifiPhyHelper &wifiPhy, const WifiMacHelper &wifiMac,
+                            const YansWifiChannelHelper &wifiChannel)
+{
+  return [=] (std::string name) {
+    ExperimentHarness harness (name, topology, traffic, mobility);
+    harness.SetReceivers (receivers);
+    harness.SetMeter (Seconds (1.0), window, Seconds (0.5), Seconds (210.0));
+    harness.SetAnimation (animation);
+    return harness.Run (wifi, wifiPhy, wifiMac, wifiChannel);
+  };
+}
+
+} // namespace ns3
@@ -0,0 +1,100 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef EXPERIMENT_HARNESS_H
+#define EXPERIMENT_HARNESS_H
+
+#include "mobility-policy.h"
+#include "topology-policy.h"
+#include "traffic-policy.h"
+
+#include "parallel-experiments.h"
+#include "throughput-meter.h"
+
+#include "ns3/socket.h"
+#include "ns3/wifi-helper.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/yans-wifi-helper.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief The Experiment of the wifi scratches, built from policies
+ *
+ * One run creates the nodes of the topology, installs a packet socket and
+ * the wifi devices on all of them, starts the traffic and the mobility, and
+ * meters what the receivers get with a ThroughputMeter sampled at the x of
+ * each receiver. A harness runs once: ns-3 has a single simulator per
+ * process, which ParallelExperiments works around by forking, and MakeJob
+ * wraps a harness into one of its jobs.
+ */
+class ExperimentHarness
+{
+public:
+  ExperimentHarness (std::string name, const TopologyPolicy &topology,
+                     const TrafficPolicy &traffic, const MobilityPolicy &mobility);
+
+  /// \brief Meter these nodes, every node when never called
+  void SetReceivers (const std::vector<uint32_t> &receivers);
+  /**
+   * \param interval time between two samples
+   * \param window number of intervals a sample averages over
+   * \param start the first sample is taken an interval after start
+   * \param stop no sample is taken after stop
+   */
+  void SetMeter (Time interval, uint32_t window, Time start, Time stop);
+  /// \brief Write a NetAnim trace to prefix-name.xml, none when prefix is empty
+  void SetAnimation (std::string prefix);
+  /**
+   * \brief Stop the simulation at end, right after a sample due then
+   *
+   * By default the simulation runs until the traffic stops.
+   */
+  void SetStopTime (Time end);
+
+  /// \return one curve per receiver, as sent back by ParallelExperiments
+  ParallelExperiments::Curves Run (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
+                                   const WifiMacHelper &wifiMac,
+                                   const YansWifiChannelHelper &wifiChannel);
+
+  /// \return the bytes the metered nodes received during the last Run
+  uint64_t GetBytes (void) const;
+  /// \return the events the simulator executed during the last Run
+  uint64_t GetEventCount (void) const;
+  /// \return the wall-clock seconds Simulator::Run took during the last Run
+  double GetWallTime (void) const;
+
+  /**
+   * Wrap a harness and one WifiHelper configuration into a job for
+   * ParallelExperiments. Everything is copied, so the caller can reconfigure
+   * the helpers for the next job; the job name names the harness.
+   */
+  static ParallelExperiments::CurvesJob
+  MakeJob (const TopologyPolicy &topology, const TrafficPolicy &traffic,
+           const MobilityPolicy &mobility, const std::vector<uint32_t> &receivers,
+           uint32_t window, std::string animation, const WifiHelper &wifi,
+           const YansWifiPhyHelper &wifiPhy, const WifiMacHelper &wifiMac,
+           const YansWifiChannelHelper &wifiChannel);
+
+private:
+  void ReceivePacket (Ptr<Socket> socket);
+  Ptr<Socket> SetupPacketReceive (Ptr<Node> node);
+
+  std::string m_name;
+  TopologyPolicy m_topology;
+  TrafficPolicy m_traffic;
+  MobilityPolicy m_mobility;
+  std::vector<uint32_t> m_receivers;
+  Time m_start;
+  Time m_stop;
+  std::string m_animation;
+  Time m_end; ///< zero to run until the traffic stops
+  ThroughputMeter m_meter;
+  uint64_t m_events;
+  double m_wallTime;
+};
+
+} // namespace ns3
+
+#endif /* EXPERIMENT_HARNESS_H */
@@ -0,0 +1,87 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+
+#include "mobility-policy.h"
+
+#include "ns3/abort.h"
+#include "ns3/mobility-model.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+MobilityPolicy
+MobilityPolicy::Static (void)
+{
+  return MobilityPolicy ();
+}
+
+MobilityPolicy
+MobilityPolicy::Walk (const std::vector<uint32_t> &walkers, double step, double limit)
+{
+  MobilityPolicy mobility;
+  mobility.m_walk = true;
+  mobility.m_walkers = walkers;
+  mobility.m_step = step;
+  mobility.m_limit = limit;
+  return mobility;
+}
+
+MobilityPolicy::MobilityPolicy ()
+  : m_walk (false),
+    m_step (1.0),
+    m_limit (210.0),
+    m_start (Seconds (0.5)),
+    m_interval (Seconds (1.0))
+{
+}
+
+MobilityPolicy &
+MobilityPolicy::SetTimes (Time start, Time interval)
+{
+  m_start = start;
+  m_interval = interval;
+  return *this;
+}
+
+void
+MobilityPolicy::Install (NodeContainer nodes, Finished finished) const
+{
+  if (!m_walk)
+    {
+      return;
+    }
+  std::vector<uint32_t> walkers = m_walkers;
+  if (walkers.empty ())
+    {
+      for (uint32_t i = 0; i < nodes.GetN (); ++i)
+        {
+          walkers.push_back (i);
+        }
+    }
+  for (uint32_t walker : walkers)
+    {
+      NS_ABORT_MSG_IF (walker >= nodes.GetN (), "Walker " << walker << " of " << nodes.GetN () << " nodes");
+      Simulator::Schedule (m_start, &MobilityPolicy::Advance, nodes.Get (walker), m_step, m_limit,
+                           m_interval, finished);
+    }
+}
+
+void
+MobilityPolicy::Advance (Ptr<Node> node, double step, double limit, Time interval,
+                         Finished finished)
+{
+  Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+  Vector pos = mobility->GetPosition ();
+  pos.x += step;
+  if (pos.x >= limit)
+    {
+      if (finished)
+        {
+          finished (node);
+        }
+      return;
+    }
+  mobility->SetPosition (pos);
+  Simulator::Schedule (interval, &MobilityPolicy::Advance, node, step, limit, interval, finished);
+}
+
+} // namespace ns3
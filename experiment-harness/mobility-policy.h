@@ -0,0 +1,55 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef MOBILITY_POLICY_H
+#define MOBILITY_POLICY_H
+
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+
+#include <functional>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief How the nodes of an experiment move once placed
+ *
+ * A walk moves its nodes step metres along x every interval from start,
+ * the way the Experiment scratches sweep the distance between nodes; a
+ * node stops once its next step would reach the limit.
+ */
+class MobilityPolicy
+{
+public:
+  /// called with a walking node once it has made its last step
+  typedef std::function<void (Ptr<Node>)> Finished;
+
+  /// \brief Nodes stay where the topology put them
+  static MobilityPolicy Static (void);
+  /// \brief The given nodes walk along x, every node when walkers is empty
+  static MobilityPolicy Walk (const std::vector<uint32_t> &walkers, double step, double limit);
+
+  MobilityPolicy ();
+
+  MobilityPolicy &SetTimes (Time start, Time interval);
+
+  /**
+   * \brief Schedule the moves of the walking nodes
+   * \param finished called at the time a walker would have made its next step
+   */
+  void Install (NodeContainer nodes, Finished finished = Finished ()) const;
+
+private:
+  static void Advance (Ptr<Node> node, double step, double limit, Time interval,
+                       Finished finished);
+
+  bool m_walk;
+  std::vector<uint32_t> m_walkers;
+  double m_step;
+  double m_limit;
+  Time m_start;
+  Time m_interval;
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_POLICY_H */
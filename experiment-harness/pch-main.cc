@@ -0,0 +1,9 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+
+// Owner of the precompiled ns-3 module headers the scratches reuse, see
+// NS3_SCRATCH_PCH in the scratch CMakeLists
+int
+main (void)
+{
+  return 0;
+}
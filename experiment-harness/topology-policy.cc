@@ -0,0 +1,71 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+
+#include "topology-policy.h"
+
+#include "ns3/abort.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/position-allocator.h"
+
+namespace ns3 {
+
+TopologyPolicy
+TopologyPolicy::Line (uint32_t n, double spacing)
+{
+  TopologyPolicy topology;
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      topology.m_positions.push_back (Vector (i * spacing, 0.0, 0.0));
+    }
+  return topology;
+}
+
+TopologyPolicy
+TopologyPolicy::Grid (uint32_t n, uint32_t width, double dx, double dy)
+{
+  NS_ABORT_MSG_IF (width == 0, "A grid needs at least one node per row");
+  TopologyPolicy topology;
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      topology.m_positions.push_back (Vector ((i % width) * dx, (i / width) * dy, 0.0));
+    }
+  return topology;
+}
+
+TopologyPolicy
+TopologyPolicy::List (const std::vector<Vector> &positions)
+{
+  TopologyPolicy topology;
+  topology.m_positions = positions;
+  return topology;
+}
+
+uint32_t
+TopologyPolicy::GetN (void) const
+{
+  return m_positions.size ();
+}
+
+const std::vector<Vector> &
+TopologyPolicy::GetPositions (void) const
+{
+  return m_positions;
+}
+
+void
+TopologyPolicy::Install (NodeContainer nodes) const
+{
+  NS_ABORT_MSG_IF (nodes.GetN () != m_positions.size (),
+                   "The topology has " << m_positions.size () << " positions for "
+                                       << nodes.GetN () << " nodes");
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  for (const Vector &position : m_positions)
+    {
+      positionAlloc->Add (position);
+    }
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+}
+
+} // namespace ns3
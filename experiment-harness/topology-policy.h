@@ -0,0 +1,41 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef TOPOLOGY_POLICY_H
+#define TOPOLOGY_POLICY_H
+
+#include "ns3/node-container.h"
+#include "ns3/vector.h"
+
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Where the nodes of an experiment start
+ *
+ * The policy only knows the initial positions; the number of nodes an
+ * experiment creates is the number of positions. Every node gets a
+ * ConstantPositionMobilityModel, which a MobilityPolicy then moves.
+ */
+class TopologyPolicy
+{
+public:
+  /// \brief n nodes on the x axis, spacing metres apart
+  static TopologyPolicy Line (uint32_t n, double spacing);
+  /// \brief n nodes filling rows of width nodes, dx and dy metres apart
+  static TopologyPolicy Grid (uint32_t n, uint32_t width, double dx, double dy);
+  /// \brief One node per position
+  static TopologyPolicy List (const std::vector<Vector> &positions);
+
+  uint32_t GetN (void) const;
+  const std::vector<Vector> &GetPositions (void) const;
+
+  /// \brief Give every node of nodes its position
+  void Install (NodeContainer nodes) const;
+
+private:
+  std::vector<Vector> m_positions;
+};
+
+} // namespace ns3
+
+#endif /* TOPOLOGY_POLICY_H */
@@ -0,0 +1,145 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+
+#include "traffic-policy.h"
+
+#include "saturation-source.h"
+
+#include "ns3/abort.h"
+#include "ns3/application-container.h"
+#include "ns3/on-off-helper.h"
+#include "ns3/packet-socket-address.h"
+#include "ns3/uinteger.h"
+
+namespace ns3 {
+
+TrafficPolicy
+TrafficPolicy::Pair (uint32_t from, uint32_t to)
+{
+  TrafficPolicy traffic;
+  traffic.AddFlow (from, to);
+  return traffic;
+}
+
+TrafficPolicy
+TrafficPolicy::FullMesh (void)
+{
+  TrafficPolicy traffic;
+  traffic.m_pattern = FULL_MESH;
+  return traffic;
+}
+
+TrafficPolicy
+TrafficPolicy::Forward (void)
+{
+  TrafficPolicy traffic;
+  traffic.m_pattern = FORWARD;
+  return traffic;
+}
+
+TrafficPolicy::TrafficPolicy ()
+  : m_pattern (FLOWS),
+    m_packetSize (2000),
+    m_rate (0),
+    m_protocol (4),
+    m_start (Seconds (0.5)),
+    m_stop (Seconds (250.0))
+{
+}
+
+TrafficPolicy &
+TrafficPolicy::AddFlow (uint32_t from, uint32_t to)
+{
+  NS_ABORT_MSG_IF (from == to, "Node " << from << " cannot send to itself");
+  m_flows.push_back (std::make_pair (from, to));
+  return *this;
+}
+
+TrafficPolicy &
+TrafficPolicy::SetPacketSize (uint32_t packetSize)
+{
+  m_packetSize = packetSize;
+  return *this;
+}
+
+TrafficPolicy &
+TrafficPolicy::SetRate (DataRate rate)
+{
+  m_rate = rate;
+  return *this;
+}
+
+TrafficPolicy &
+TrafficPolicy::SetProtocol (uint16_t protocol)
+{
+  m_protocol = protocol;
+  return *this;
+}
+
+TrafficPolicy &
+TrafficPolicy::SetTimes (Time start, Time stop)
+{
+  m_start = start;
+  m_stop = stop;
+  return *this;
+}
+
+std::vector<std::pair<uint32_t, uint32_t> >
+TrafficPolicy::GetFlows (uint32_t n) const
+{
+  std::vector<std::pair<uint32_t, uint32_t> > flows;
+  for (uint32_t i = 0; m_pattern != FLOWS && i < n; ++i)
+    {
+      for (uint32_t j = m_pattern == FORWARD ? i + 1 : 0; j < n; ++j)
+        {
+          if (i != j)
+            {
+              flows.push_back (std::make_pair (i, j));
+            }
+        }
+    }
+  flows.insert (flows.end (), m_flows.begin (), m_flows.end ());
+  for (const std::pair<uint32_t, uint32_t> &flow : flows)
+    {
+      NS_ABORT_MSG_IF (flow.first >= n || flow.second >= n,
+                       "Flow " << flow.first << " -> " << flow.second << " between " << n << " nodes");
+    }
+  return flows;
+}
+
+void
+TrafficPolicy::Install (NodeContainer nodes, NetDeviceContainer devices) const
+{
+  std::vector<std::pair<uint32_t, uint32_t> > flows = GetFlows (nodes.GetN ());
+  // one saturation source per sending node, created on its first flow
+  std::vector<Ptr<SaturationSource> > sources (nodes.GetN ());
+  for (const std::pair<uint32_t, uint32_t> &flow : flows)
+    {
+      PacketSocketAddress socket;
+      socket.SetSingleDevice (devices.Get (flow.first)->GetIfIndex ());
+      socket.SetPhysicalAddress (devices.Get (flow.second)->GetAddress ());
+      socket.SetProtocol (m_protocol);
+
+      if (m_rate.GetBitRate () > 0)
+        {
+          OnOffHelper onoff ("ns3::PacketSocketFactory", Address (socket));
+          onoff.SetConstantRate (m_rate);
+          onoff.SetAttribute ("PacketSize", UintegerValue (m_packetSize));
+          ApplicationContainer apps = onoff.Install (nodes.Get (flow.first));
+          apps.Start (m_start);
+          apps.Stop (m_stop);
+          continue;
+        }
+      Ptr<SaturationSource> &source = sources[flow.first];
+      if (!source)
+        {
+          source = CreateObject<SaturationSource> ();
+          source->SetAttribute ("PacketSize", UintegerValue (m_packetSize));
+          nodes.Get (flow.first)->AddApplication (source);
+          source->SetStartTime (m_start);
+          source->SetStopTime (m_stop);
+        }
+      source->AddDestination (socket);
+    }
+}
+
+} // namespace ns3
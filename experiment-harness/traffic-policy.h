@@ -0,0 +1,68 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef TRAFFIC_POLICY_H
+#define TRAFFIC_POLICY_H
+
+#include "ns3/data-rate.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Who sends to whom in an experiment, and how fast
+ *
+ * Flows are packet socket flows between wifi devices, given by node index.
+ * At the default rate of zero every sending node gets one SaturationSource
+ * serving all its destinations in turn; a non-zero rate gives every flow its
+ * own OnOffApplication sending at that constant rate.
+ */
+class TrafficPolicy
+{
+public:
+  /// \brief A single flow
+  static TrafficPolicy Pair (uint32_t from, uint32_t to);
+  /// \brief Every node sends to every other node
+  static TrafficPolicy FullMesh (void);
+  /// \brief Every node sends to every node of a higher index
+  static TrafficPolicy Forward (void);
+
+  TrafficPolicy ();
+
+  /// \brief Add a flow to the pattern
+  TrafficPolicy &AddFlow (uint32_t from, uint32_t to);
+  TrafficPolicy &SetPacketSize (uint32_t packetSize);
+  /// \param rate the rate of every flow, zero to saturate the MAC queues
+  TrafficPolicy &SetRate (DataRate rate);
+  TrafficPolicy &SetProtocol (uint16_t protocol);
+  TrafficPolicy &SetTimes (Time start, Time stop);
+
+  /// \return the (from, to) flows for n nodes
+  std::vector<std::pair<uint32_t, uint32_t> > GetFlows (uint32_t n) const;
+
+  /// \brief Install the sending applications, devices.Get (i) being the device of nodes.Get (i)
+  void Install (NodeContainer nodes, NetDeviceContainer devices) const;
+
+private:
+  enum Pattern
+  {
+    FLOWS,
+    FULL_MESH,
+    FORWARD
+  };
+
+  Pattern m_pattern;
+  std::vector<std::pair<uint32_t, uint32_t> > m_flows; ///< added to the pattern
+  uint32_t m_packetSize;
+  DataRate m_rate;
+  uint16_t m_protocol;
+  Time m_start;
+  Time m_stop;
+};
+
+} // namespace ns3
+
+#endif /* TRAFFIC_POLICY_H */
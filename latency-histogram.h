@@ -0,0 +1,170 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include "ns3/nstime.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Log-linear histogram of delays, within 1/16 of the true value
+ *
+ * Delays are counted in nanoseconds: below 16 ns one bucket per
+ * nanosecond, then 16 buckets per power of two, up to about 18 minutes.
+ * Adding a delay is a count-leading-zeros, a shift and two increments;
+ * nothing is allocated.
+ */
+class LatencyHistogram
+{
+public:
+  static constexpr uint32_t SUB_BITS = 4;
+  static constexpr uint32_t SUB = 1 << SUB_BITS;
+  /// powers of two above the first SUB nanoseconds, 2^40 ns is about 18 minutes
+  static constexpr uint32_t OCTAVES = 40 - SUB_BITS;
+  static constexpr uint32_t BUCKETS = (OCTAVES + 1) * SUB;
+
+  LatencyHistogram ()
+    : m_count (0),
+      m_sum (0)
+  {
+    m_buckets.fill (0);
+  }
+
+  void Add (Time delay)
+  {
+    int64_t ns = delay.GetNanoSeconds ();
+    uint64_t value = ns > 0 ? ns : 0;
+    m_buckets[Bucket (value)]++;
+    m_count++;
+    m_sum += value;
+  }
+
+  void Merge (const LatencyHistogram &other)
+  {
+    for (uint32_t b = 0; b < BUCKETS; ++b)
+      {
+        m_buckets[b] += other.m_buckets[b];
+      }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+  }
+
+  uint64_t GetCount (void) const
+  {
+    return m_count;
+  }
+
+  /// \return the exact mean delay, zero when empty
+  Time GetMean (void) const
+  {
+    return NanoSeconds (m_count ? m_sum / m_count : 0);
+  }
+
+  /// \return the delay below which a fraction q of the delays are, zero when empty
+  Time GetQuantile (double q) const
+  {
+    if (m_count == 0)
+      {
+        return NanoSeconds (0);
+      }
+    uint64_t rank = q * (m_count - 1);
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < BUCKETS; ++b)
+      {
+        seen += m_buckets[b];
+        if (seen > rank)
+          {
+            return NanoSeconds (Middle (b));
+          }
+      }
+    return NanoSeconds (Middle (BUCKETS - 1));
+  }
+
+private:
+  static uint32_t Bucket (uint64_t ns)
+  {
+    if (ns < SUB)
+      {
+        return ns;
+      }
+    uint32_t msb = 63 - __builtin_clzll (ns);
+    uint32_t shift = msb - SUB_BITS;
+    if (shift >= OCTAVES)
+      {
+        return BUCKETS - 1;
+      }
+    return (shift + 1) * SUB + ((ns >> shift) & (SUB - 1));
+  }
+
+  /// \return the middle of the nanoseconds of a bucket
+  static uint64_t Middle (uint32_t bucket)
+  {
+    if (bucket < SUB)
+      {
+        return bucket;
+      }
+    uint32_t shift = bucket / SUB - 1;
+    uint64_t low = (uint64_t (SUB) | (bucket % SUB)) << shift;
+    return low + ((uint64_t (1) << shift) >> 1);
+  }
+
+  std::array<uint64_t, BUCKETS> m_buckets;
+  uint64_t m_count;
+  uint64_t m_sum; ///< nanoseconds
+};
+
+/**
+ * \brief One LatencyHistogram per receiving node, merged at the end
+ *
+ * A node only writes its own histogram, so recording shares nothing
+ * between nodes (and would need no lock if they ran on different
+ * threads). Histograms are created on the first delay of their node.
+ */
+class NodeLatency
+{
+public:
+  void Add (uint32_t node, Time delay)
+  {
+    if (node >= m_nodes.size ())
+      {
+        m_nodes.resize (node + 1);
+      }
+    if (!m_nodes[node])
+      {
+        m_nodes[node].reset (new LatencyHistogram);
+      }
+    m_nodes[node]->Add (delay);
+  }
+
+  /// \return the histogram of a node, nullptr if it received nothing
+  const LatencyHistogram *Get (uint32_t node) const
+  {
+    return node < m_nodes.size () ? m_nodes[node].get () : nullptr;
+  }
+
+  /// \return the histogram of every delay of every node
+  LatencyHistogram Merge (void) const
+  {
+    LatencyHistogram all;
+    for (const std::unique_ptr<LatencyHistogram> &node : m_nodes)
+      {
+        if (node)
+          {
+            all.Merge (*node);
+          }
+      }
+    return all;
+  }
+
+private:
+  std::vector<std::unique_ptr<LatencyHistogram> > m_nodes;
+};
+
+} // namespace ns3
+
+#endif /* LATENCY_HISTOGRAM_H */
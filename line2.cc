@@ -1,178 +1,58 @@
 #include "ns3/gnuplot.h"
 #include "ns3/command-line.h"
-#include "ns3/config.h"
-#include "ns3/uinteger.h"
 #include "ns3/string.h"
 #include "ns3/log.h"
 #include "ns3/yans-wifi-helper.h"
-#include "ns3/mobility-helper.h"
-#include "ns3/ipv4-address-helper.h"
-#include "ns3/on-off-helper.h"
-#include "ns3/yans-wifi-channel.h"
-#include "ns3/mobility-model.h"
-#include "ns3/packet-socket-helper.h"
-#include "ns3/packet-socket-address.h"
-#include "ns3/netanim-module.h"
+#include "experiment-harness.h"
+#include "table-error-rate-model.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("Wifi-Adhoc");
 
-class Experiment
+/**
+ * Node 0 sends to node 4 at 60 Mb/s while all five nodes walk along x, and
+ * node 1 is metered.
+ */
+static ParallelExperiments::CurvesJob
+MakeJob (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
+         const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel,
+         uint32_t window)
 {
-public:
- Experiment ();
- Experiment (std::string name);
- Gnuplot2dDataset Run (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
-                      const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel);
-
-private:
- void ReceivePacket (Ptr<Socket> socket);
- void SetPosition (Ptr<Node> node, Vector position);
- Vector GetPosition (Ptr<Node> node);
- void AdvancePosition (Ptr<Node> node);
- Ptr<Socket> SetupPacketReceive (Ptr<Node> node);
-
- uint32_t m_bytesTotal;
- Gnuplot2dDataset m_output;
-};
-
-Experiment::Experiment ()
-{
-}
-
-Experiment::Experiment (std::string name)
- : m_output (name)
-{
- m_output.SetStyle (Gnuplot2dDataset::LINES);
-}
-
-void Experiment::SetPosition (Ptr<Node> node, Vector position)
-{
- Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
- mobility->SetPosition (position);
-}
-
-Vector Experiment::GetPosition (Ptr<Node> node)
-{
- Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
- return mobility->GetPosition ();
-}
-
-void Experiment::AdvancePosition (Ptr<Node> node)
-{
- Vector pos = GetPosition (node);
- double mbs = ((m_bytesTotal * 8.0) / 1000000); // Throughput calculation
- std::cout << "Throughput: " << mbs << "mbs" << std::endl;
- m_bytesTotal = 0; // Reset for next interval
- m_output.Add (pos.x, mbs);
- pos.x += 1.0; // Increase this value to make the node move faster
- if (pos.x >= 210.0)
-   {
-     return;
-   }
- SetPosition (node, pos);
- Simulator::Schedule (Seconds (1.0), &Experiment::AdvancePosition, this, node);
- std::cout << "Node Position: " << pos.x << ", " << pos.y << ", " << pos.z << std::endl;
-
-}
-
-void Experiment::ReceivePacket (Ptr<Socket> socket)
-{
- Ptr<Packet> packet;
- while ((packet = socket->Recv ()))
-   {
-     m_bytesTotal += packet->GetSize ();
-     std::cout << "Received packet of size: " << packet->GetSize() << std::endl;
-   }
-}
-
-Ptr<Socket> Experiment::SetupPacketReceive (Ptr<Node> node)
-{
- TypeId tid = TypeId::LookupByName ("ns3::PacketSocketFactory");
- Ptr<Socket> sink = Socket::CreateSocket (node, tid);
- sink->Bind ();
- sink->SetRecvCallback (MakeCallback (&Experiment::ReceivePacket, this));
- return sink;
-}
-
-Gnuplot2dDataset Experiment::Run (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
-                               const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel)
-{
- m_bytesTotal = 0;
-
- NodeContainer c;
- c.Create (5); // Create 5 nodes instead of 2
-
- PacketSocketHelper packetSocket;
- packetSocket.Install (c);
-
- YansWifiPhyHelper phy = wifiPhy;
- phy.SetChannel (wifiChannel.Create ());
-
- WifiMacHelper mac = wifiMac;
- NetDeviceContainer devices = wifi.Install (phy, mac, c);
-
- MobilityHelper mobility;
- Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
- positionAlloc->Add (Vector (0.0, 0.0, 0.0));
- positionAlloc->Add (Vector (1.0, 0.0, 0.0));
- positionAlloc->Add (Vector (2.0, 0.0, 0.0));
- positionAlloc->Add (Vector (0.0, 1.0, 0.0));
- positionAlloc->Add (Vector (1.0, 1.0, 0.0));
- mobility.SetPositionAllocator (positionAlloc);
- mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
- mobility.Install (c);
-
- PacketSocketAddress socket;
- socket.SetSingleDevice (devices.Get (0)->GetIfIndex ());
- socket.SetPhysicalAddress (devices.Get (4)->GetAddress ());
- socket.SetProtocol (4);
-
- OnOffHelper onoff ("ns3::PacketSocketFactory", Address (socket));
- onoff.SetConstantRate (DataRate (60000000));
- onoff.SetAttribute ("PacketSize", UintegerValue (2000));
-
- ApplicationContainer apps = onoff.Install (c.Get (0));
- std::cout << "Sent packets" << std::endl;
-
- apps.Start (Seconds (0.5));
- apps.Stop (Seconds (250.0));
-
- // Schedule position advancement for all nodes except the first one
- for (uint32_t i = 0; i < c.GetN ();++i){
-  Simulator::Schedule (Seconds (0.5), &Experiment::AdvancePosition, this, c.Get (i));
-}
-
-Ptr<Socket> recvSink = SetupPacketReceive (c.Get (1));
-
-AnimationInterface anim("line2.xml");
-for (uint32_t i = 0; i < c.GetN (); ++i) {
- anim.UpdateNodeSize (c.Get (i)->GetId(), 0.5, 0.5);
-}
-
-Simulator::Run ();
-Simulator::Destroy ();
-
-return m_output;
+ std::vector<Vector> positions = {Vector (0.0, 0.0, 0.0), Vector (1.0, 0.0, 0.0),
+                                  Vector (2.0, 0.0, 0.0), Vector (0.0, 1.0, 0.0),
+                                  Vector (1.0, 1.0, 0.0)};
+ TrafficPolicy traffic = TrafficPolicy::Pair (0, 4);
+ traffic.SetRate (DataRate (60000000));
+ return ExperimentHarness::MakeJob (TopologyPolicy::List (positions), traffic,
+                                    MobilityPolicy::Walk ({}, 1.0, 210.0), {1}, window,
+                                    "line2", wifi, wifiPhy, wifiMac, wifiChannel);
 }
 
 int main (int argc, char *argv[])
 {
 CommandLine cmd (__FILE__);
+uint32_t jobs = 0;
+uint32_t window = 1;
+bool tableErrors = false;
+cmd.AddValue ("jobs", "Experiments run in parallel, 0 for one per core", jobs);
+cmd.AddValue ("tableErrors", "Look chunk success rates up in precomputed SNR tables", tableErrors);
+cmd.AddValue ("window", "Seconds each throughput sample averages over", window);
 cmd.Parse (argc, argv);
 
 Gnuplot gnuplot = Gnuplot ("reference-rates.png");
 
-Experiment experiment;
 WifiHelper wifi;
 wifi.SetStandard (WIFI_STANDARD_80211a);
 WifiMacHelper wifiMac;
 YansWifiPhyHelper wifiPhy;
+if (tableErrors) {
+ wifiPhy.SetErrorRateModel ("ns3::TableErrorRateModel");
+}
 YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
-Gnuplot2dDataset dataset;
 
 wifiMac.SetType ("ns3::AdhocWifiMac");
+ParallelExperiments experiments (jobs);
 
 for (uint32_t i = 0; i < 5; ++i) {
  std::string dataMode;
@@ -184,13 +64,12 @@ for (uint32_t i = 0; i < 5; ++i) {
    case 4: dataMode = "OfdmRate18Mbps"; break;
  }
  std::string rateName = "Rate" + std::to_string(i);
- experiment = Experiment (rateName);
  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                            "DataMode", StringValue (dataMode));
- dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
- gnuplot.AddDataset (dataset);
+ experiments.AddCurves (rateName, MakeJob (wifi, wifiPhy, wifiMac, wifiChannel, window));
 }
 
+experiments.Run (gnuplot);
 gnuplot.GenerateOutput (std::cout);
 
 gnuplot = Gnuplot ("rate-control.png");
@@ -205,12 +84,11 @@ for (uint32_t i = 0; i < 5; ++i) {
    case 4: rateControl = "ns3::RraaWifiManager"; break;
  }
  std::string rateControlName = "RateControl" + std::to_string(i);
- experiment = Experiment (rateControlName);
  wifi.SetRemoteStationManager (rateControl);
- dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
- gnuplot.AddDataset (dataset);
+ experiments.AddCurves (rateControlName, MakeJob (wifi, wifiPhy, wifiMac, wifiChannel, window));
 }
 
+experiments.Run (gnuplot);
 gnuplot.GenerateOutput (std::cout);
 
 return 0;
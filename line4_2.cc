@@ -1,19 +1,11 @@
 #include "ns3/gnuplot.h"
-#include "ns3/gnuplot-helper.h"
 #include "ns3/command-line.h"
-#include "ns3/config.h"
-#include "ns3/uinteger.h"
 #include "ns3/string.h"
 #include "ns3/log.h"
 #include "ns3/yans-wifi-helper.h"
-#include "ns3/mobility-helper.h"
-#include "ns3/ipv4-address-helper.h"
-#include "ns3/on-off-helper.h"
-#include "ns3/yans-wifi-channel.h"
-#include "ns3/mobility-model.h"
-#include "ns3/packet-socket-helper.h"
-#include "ns3/packet-socket-address.h"
-#include "ns3/netanim-module.h"
+#include "experiment-harness.h"
+#include "table-error-rate-model.h"
+#include "telemetry.h"
 
 #include <fstream>
 #include <iostream>
@@ -22,213 +14,33 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("Wifi-Adhoc");
 
-class Experiment
+/**
+ * Write the curves of one job as a gnuplot dataset file
+ */
+static void SaveDatasetToFile(const std::string &name, const ParallelExperiments::Curves &curves,
+                              const std::string &filename)
 {
-public:
-    Experiment();
-    Experiment(std::string name);
-    Gnuplot2dDataset Run(const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
-                          const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel);
-    void SaveDatasetToFile(const std::string &filename);
-
-private:
-    void ReceivePacket(Ptr<Socket> socket);
-    void SetPosition(Ptr<Node> node, Vector position);
-    Vector GetPosition(Ptr<Node> node);
-    void AdvancePosition(Ptr<Node> node);
-    Ptr<Socket> SetupPacketReceive(Ptr<Node> node);
-
-    uint32_t m_bytesTotal;
-    Gnuplot2dDataset m_output;
-};
-
-Experiment::Experiment() {}
-
-Experiment::Experiment(std::string name)
-    : m_output(name)
-{
-    m_output.SetStyle(Gnuplot2dDataset::LINES);
-}
-
-void Experiment::SetPosition(Ptr<Node> node, Vector position)
-{
-    Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
-    mobility->SetPosition(position);
-}
-
-Vector Experiment::GetPosition(Ptr<Node> node)
-{
-    Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
-    return mobility->GetPosition();
-}
-
-void Experiment::AdvancePosition(Ptr<Node> node)
-{
-    Vector pos = GetPosition(node);
-    Vector posBefore = GetPosition(node);
-    double mbs = ((m_bytesTotal * 8.0) / 1000000); // Throughput calculation
-
-    NS_LOG_INFO("Throughput: " << mbs << " Mbps");
-    NS_LOG_INFO("Total bytes received: " << m_bytesTotal);
-    m_bytesTotal = 0; // Reset for the next interval
-    m_output.Add(pos.x, mbs);
-    pos.x += 1.0; // Increase this value to make the node move faster
+    std::string fullPath = "/ns-allinone-3.36.1/ns-3.36.1/scratch/" + filename;
+    std::ofstream outFile(fullPath.c_str());
 
-    if (pos.x >= 210.0)
+    if (!outFile.is_open())
     {
+        NS_LOG_ERROR("Failed to open file for writing: " << filename);
         return;
     }
 
-    SetPosition(node, pos);
-    Vector posAfter = GetPosition(node);
-    NS_LOG_INFO("Node Position before updating: " << posBefore.x << ", " << posBefore.y << ", " << posBefore.z);
-    NS_LOG_INFO("Node Position after updating: " << posAfter.x << ", " << posAfter.y << ", " << posAfter.z);
-
-    Simulator::Schedule(Seconds(1.0), &Experiment::AdvancePosition, this, node);
-}
-
-void Experiment::ReceivePacket(Ptr<Socket> socket)
-{
-    Ptr<Packet> packet;
-    while ((packet = socket->Recv()))
-    {
-        m_bytesTotal += packet->GetSize();
-        NS_LOG_INFO("Received packet of size: " << packet->GetSize());
-        NS_LOG_INFO("Total bytes received: " << m_bytesTotal);
-
-        // Add more information about the source and destination addresses if needed
-        Address sourceAddress;
-        socket->GetPeerName(sourceAddress);
-        NS_LOG_INFO("Source Address: " << sourceAddress);
-
-        Address destinationAddress;
-        socket->GetSockName(destinationAddress);
-        NS_LOG_INFO("Destination Address: " << destinationAddress);
-
-        // Print node position for debugging
-        Vector nodePosition = GetPosition(socket->GetNode());
-        NS_LOG_INFO("Node Position after updating: " << nodePosition.x << ", " << nodePosition.y << ", " << nodePosition.z);
-
-        // Print throughput calculation for debugging
-        double mbs = ((m_bytesTotal * 8.0) / 1000000);
-        NS_LOG_INFO("Throughput: " << mbs << " Mbps");
-    }
-}
-
-Ptr<Socket> Experiment::SetupPacketReceive(Ptr<Node> node)
-{
-    TypeId tid = TypeId::LookupByName("ns3::PacketSocketFactory");
-    Ptr<Socket> sink = Socket::CreateSocket(node, tid);
-    if (!sink)
-    {
-        NS_LOG_ERROR("Failed to create socket");
-        return sink;
-    }
-
-    if (sink->Bind() != 0)
-    {
-        NS_LOG_ERROR("Failed to bind socket");
-        return sink;
-    }
-
-    sink->SetRecvCallback(MakeCallback(&Experiment::ReceivePacket, this));
-
-    // Add debug output just before returning the socket
-    NS_LOG_INFO("Socket setup successful");
-
-    return sink;
-}
-
-Gnuplot2dDataset Experiment::Run(const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
-                                 const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel)
-{
-    m_bytesTotal = 0;
-
-    NodeContainer c;
-    c.Create(5);
-
-    PacketSocketHelper packetSocket;
-    packetSocket.Install(c);
-
-    YansWifiPhyHelper phy = wifiPhy;
-    phy.SetChannel(wifiChannel.Create());
-
-    WifiMacHelper mac = wifiMac;
-    NetDeviceContainer devices = wifi.Install(phy, mac, c);
-
-    MobilityHelper mobility;
-    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator>();
-    positionAlloc->Add(Vector(0.0, 0.0, 0.0));
-    positionAlloc->Add(Vector(1.0, 0.0, 0.0));
-    positionAlloc->Add(Vector(2.0, 0.0, 0.0));
-    positionAlloc->Add(Vector(0.0, 1.0, 0.0));
-    positionAlloc->Add(Vector(1.0, 1.0, 0.0));
-    mobility.SetPositionAllocator(positionAlloc);
-    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-    mobility.Install(c);
-
-    // Set up communication between all nodes
-    for (uint32_t i = 0; i < c.GetN(); ++i)
+    Gnuplot plot;
+    for (const std::pair<std::string, ParallelExperiments::Points> &curve : curves)
     {
-        for (uint32_t j = 0; j < c.GetN(); ++j)
+        Gnuplot2dDataset dataset(name + curve.first);
+        dataset.SetStyle(Gnuplot2dDataset::LINES);
+        for (const std::pair<double, double> &point : curve.second)
         {
-            if (i != j)
-            {
-                PacketSocketAddress socket;
-                socket.SetSingleDevice(devices.Get(i)->GetIfIndex());
-                socket.SetPhysicalAddress(devices.Get(j)->GetAddress());
-                socket.SetProtocol(4);
-
-                OnOffHelper onoff("ns3::PacketSocketFactory", Address(socket));
-                onoff.SetConstantRate(DataRate(60000000));
-                onoff.SetAttribute("PacketSize", UintegerValue(2000));
-
-                ApplicationContainer apps = onoff.Install(c.Get(i));
-                apps.Start(Seconds(0.5));
-                apps.Stop(Seconds(250.0));
-            }
+            dataset.Add(point.first, point.second);
         }
+        plot.AddDataset(dataset);
     }
 
-    // Schedule position advancement for all nodes
-    for (uint32_t i = 0; i < c.GetN(); ++i)
-    {
-        Simulator::Schedule(Seconds(0.5), &Experiment::AdvancePosition, this, c.Get(i));
-    }
-
-    // Set up packet reception for all nodes
-    for (uint32_t i = 0; i < c.GetN(); ++i)
-    {
-        Ptr<Socket> recvSink = SetupPacketReceive(c.Get(i));
-    }
-
-    AnimationInterface anim("line4.xml");
-
-    for (uint32_t i = 0; i < c.GetN(); ++i)
-    {
-        anim.UpdateNodeSize(c.Get(i)->GetId(), 0.5, 0.5);
-    }
-
-    Simulator::Run();
-    Simulator::Destroy();
-
-    return m_output;
-}
-
-void Experiment::SaveDatasetToFile(const std::string &filename)
-{    
-    std::string fullPath = "/ns-allinone-3.36.1/ns-3.36.1/scratch/" + filename;
-    std::ofstream outFile(fullPath.c_str());
-    
-    if (!outFile.is_open())
-    {
-        NS_LOG_ERROR("Failed to open file for writing: " << filename);
-        return;
-    }
-
-    Gnuplot plot;
-    plot.AddDataset(m_output);
-    
     plot.GenerateOutput(outFile);
 
     outFile.close();
@@ -236,25 +48,62 @@ void Experiment::SaveDatasetToFile(const std::string &filename)
     NS_LOG_INFO("Dataset saved to file: " << filename);
 }
 
+/**
+ * Every node saturates its queue towards every other node while all five
+ * walk along x, and every node is metered. The curves of the job are also
+ * saved to fileName.
+ */
+static ParallelExperiments::CurvesJob
+MakeJob(const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
+        const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel,
+        uint32_t window, std::string fileName)
+{
+    std::vector<Vector> positions = {Vector(0.0, 0.0, 0.0), Vector(1.0, 0.0, 0.0),
+                                     Vector(2.0, 0.0, 0.0), Vector(0.0, 1.0, 0.0),
+                                     Vector(1.0, 1.0, 0.0)};
+    ParallelExperiments::CurvesJob job =
+        ExperimentHarness::MakeJob(TopologyPolicy::List(positions), TrafficPolicy::FullMesh(),
+                                   MobilityPolicy::Walk({}, 1.0, 210.0), {}, window,
+                                   "line4", wifi, wifiPhy, wifiMac, wifiChannel);
+    return [job, fileName](std::string name) {
+        ParallelExperiments::Curves curves = job(name);
+        SaveDatasetToFile(name, curves, fileName);
+        return curves;
+    };
+}
+
 int main(int argc, char *argv[])
 {
     CommandLine cmd(__FILE__);
+    uint32_t jobs = 0;
+    uint32_t window = 1;
+    bool tableErrors = false;
+    cmd.AddValue("jobs", "Experiments run in parallel, 0 for one per core", jobs);
+    cmd.AddValue("tableErrors", "Look chunk success rates up in precomputed SNR tables", tableErrors);
+    cmd.AddValue("window", "Seconds each throughput sample averages over", window);
+    uint32_t telemetryBudget = 0;
+    cmd.AddValue("telemetryBudget", "Telemetry lines per simulated second, 0 for no limit", telemetryBudget);
     cmd.Parse(argc, argv);
+    Telemetry::SetBudget("ExperimentHarness", telemetryBudget);
 
     // Enable NS-3 logging
     LogComponentEnable("Wifi-Adhoc", LOG_LEVEL_INFO);
+    LogComponentEnable("ExperimentHarness", LOG_LEVEL_INFO);
 
     Gnuplot gnuplot = Gnuplot("reference-rates.png");
 
-    Experiment experiment;
     WifiHelper wifi;
     wifi.SetStandard(WIFI_STANDARD_80211a);
     WifiMacHelper wifiMac;
     YansWifiPhyHelper wifiPhy;
+    if (tableErrors)
+    {
+        wifiPhy.SetErrorRateModel("ns3::TableErrorRateModel");
+    }
     YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default();
-    Gnuplot2dDataset dataset;
 
     wifiMac.SetType("ns3::AdhocWifiMac");
+    ParallelExperiments experiments(jobs);
 
     for (uint32_t i = 0; i < 5; ++i)
     {
@@ -278,16 +127,13 @@ int main(int argc, char *argv[])
             break;
         }
         std::string rateName = "Rate" + std::to_string(i);
-        experiment = Experiment(rateName);
         wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
                                      "DataMode", StringValue(dataMode));
-        dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-        gnuplot.AddDataset(dataset);
-
         std::string filename = "dataset_" + std::to_string(i) + ".dat";
-        experiment.SaveDatasetToFile(filename);
+        experiments.AddCurves(rateName, MakeJob(wifi, wifiPhy, wifiMac, wifiChannel, window, filename));
     }
 
+    experiments.Run(gnuplot);
     gnuplot.GenerateOutput(std::cout);
 
     gnuplot = Gnuplot("rate-control.png");
@@ -314,15 +160,12 @@ int main(int argc, char *argv[])
             break;
         }
         std::string rateControlName = "RateControl" + std::to_string(i);
-        experiment = Experiment(rateControlName);
         wifi.SetRemoteStationManager(rateControl);
-        dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-        gnuplot.AddDataset(dataset);
-
         std::string filename = "dataset_rate_control_" + std::to_string(i) + ".dat";
-        experiment.SaveDatasetToFile(filename);
+        experiments.AddCurves(rateControlName, MakeJob(wifi, wifiPhy, wifiMac, wifiChannel, window, filename));
     }
 
+    experiments.Run(gnuplot);
     gnuplot.GenerateOutput(std::cout);
 
     return 0;
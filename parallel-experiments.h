@@ -0,0 +1,296 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef PARALLEL_EXPERIMENTS_H
+#define PARALLEL_EXPERIMENTS_H
+
+#include "ns3/abort.h"
+#include "ns3/gnuplot.h"
+#include "ns3/log.h"
+
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Runs independent Experiment jobs in forked worker processes
+ *
+ * ns-3 has a single simulator per process, so the jobs of a sweep (one
+ * WifiHelper configuration each) cannot share a process. Each job is run in
+ * a child forked from the parent before any simulation started; the child
+ * sends back the (x, y) points of its curve over a pipe and exits. The
+ * parent keeps at most \c workers children alive and adds one dataset per
+ * name to the Gnuplot in the order the names were first added, so the
+ * output is the same as a serial run. Jobs added under the same name are
+ * concatenated into one dataset, which lets a curve be split into
+ * independent points. A job added with AddCurves may return several curves,
+ * each titled by the job name followed by its own suffix. With one worker
+ * the jobs run in the parent.
+ */
+class ParallelExperiments
+{
+public:
+  /// (x, y) points of one curve
+  typedef std::vector<std::pair<double, double> > Points;
+  /// suffixed curves of one job
+  typedef std::vector<std::pair<std::string, Points> > Curves;
+  /// runs one experiment, the argument is the name given to Add
+  typedef std::function<Points (std::string)> Job;
+  /// runs one experiment producing several curves
+  typedef std::function<Curves (std::string)> CurvesJob;
+
+  /**
+   * \param workers number of jobs run at the same time, 0 for one per core
+   */
+  ParallelExperiments (uint32_t workers = 0)
+    : m_workers (workers)
+  {
+    if (m_workers == 0)
+      {
+        long cores = sysconf (_SC_NPROCESSORS_ONLN);
+        m_workers = cores > 0 ? cores : 1;
+      }
+  }
+
+  /// \brief Queue a job whose points go to the dataset titled name
+  void Add (std::string name, Job job)
+  {
+    AddCurves (name, [job] (std::string title) {
+      return Curves (1, std::make_pair (std::string (), job (title)));
+    });
+  }
+
+  /// \brief Queue a job whose curves go to the datasets titled name followed by their suffix
+  void AddCurves (std::string name, CurvesJob job)
+  {
+    m_names.push_back (name);
+    m_jobs.push_back (job);
+  }
+
+  /// \brief Run the queued jobs, add their datasets to gnuplot and clear the queue
+  void Run (Gnuplot &gnuplot)
+  {
+    std::vector<Curves> results (m_jobs.size ());
+    if (m_workers == 1)
+      {
+        for (uint32_t i = 0; i < m_jobs.size (); ++i)
+          {
+            results[i] = m_jobs[i] (m_names[i]);
+          }
+      }
+    else
+      {
+        RunForked (results);
+      }
+    std::vector<Gnuplot2dDataset> datasets;
+    std::map<std::string, uint32_t> index;
+    for (uint32_t i = 0; i < m_jobs.size (); ++i)
+      {
+        for (const std::pair<std::string, Points> &curve : results[i])
+          {
+            std::string title = m_names[i] + curve.first;
+            if (index.find (title) == index.end ())
+              {
+                index[title] = datasets.size ();
+                datasets.push_back (Gnuplot2dDataset (title));
+                datasets.back ().SetStyle (Gnuplot2dDataset::LINES);
+              }
+            Gnuplot2dDataset &dataset = datasets[index[title]];
+            for (const std::pair<double, double> &point : curve.second)
+              {
+                dataset.Add (point.first, point.second);
+              }
+          }
+      }
+    for (const Gnuplot2dDataset &dataset : datasets)
+      {
+        gnuplot.AddDataset (dataset);
+      }
+    m_names.clear ();
+    m_jobs.clear ();
+  }
+
+private:
+  /// a running child
+  struct Worker
+  {
+    pid_t pid;
+    int fd;
+    uint32_t job;
+    std::string data; ///< bytes received so far
+  };
+
+  void RunForked (std::vector<Curves> &results)
+  {
+    std::vector<Worker> running;
+    uint32_t next = 0;
+    while (next < m_jobs.size () || !running.empty ())
+      {
+        while (next < m_jobs.size () && running.size () < m_workers)
+          {
+            running.push_back (Spawn (next++));
+          }
+        std::vector<struct pollfd> fds (running.size ());
+        for (uint32_t i = 0; i < running.size (); ++i)
+          {
+            fds[i].fd = running[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+          }
+        if (poll (fds.data (), fds.size (), -1) < 0)
+          {
+            NS_ABORT_MSG_IF (errno != EINTR, "poll failed");
+            continue;
+          }
+        for (uint32_t i = running.size (); i-- > 0; )
+          {
+            if (fds[i].revents == 0)
+              {
+                continue;
+              }
+            char buffer[65536];
+            ssize_t n = read (running[i].fd, buffer, sizeof (buffer));
+            if (n > 0)
+              {
+                running[i].data.append (buffer, n);
+                continue;
+              }
+            if (n < 0 && errno == EINTR)
+              {
+                continue;
+              }
+            Finish (running[i], results);
+            running.erase (running.begin () + i);
+          }
+      }
+  }
+
+  Worker Spawn (uint32_t job)
+  {
+    int fds[2];
+    NS_ABORT_MSG_IF (pipe (fds) != 0, "pipe failed");
+    // buffered output would otherwise be written by the child as well
+    std::cout.flush ();
+    std::cerr.flush ();
+    fflush (nullptr);
+    pid_t pid = fork ();
+    NS_ABORT_MSG_IF (pid < 0, "fork failed");
+    if (pid == 0)
+      {
+        close (fds[0]);
+        std::string data = Serialize (m_jobs[job] (m_names[job]));
+        bool ok = WriteAll (fds[1], data.data (), data.size ());
+        close (fds[1]);
+        std::cout.flush ();
+        // skip the parent's static destructors and atexit handlers
+        _exit (ok ? 0 : 1);
+      }
+    close (fds[1]);
+    Worker worker;
+    worker.pid = pid;
+    worker.fd = fds[0];
+    worker.job = job;
+    return worker;
+  }
+
+  void Finish (Worker &worker, std::vector<Curves> &results)
+  {
+    close (worker.fd);
+    int status = 0;
+    while (waitpid (worker.pid, &status, 0) < 0 && errno == EINTR)
+      {
+      }
+    NS_ABORT_MSG_IF (!WIFEXITED (status) || WEXITSTATUS (status) != 0,
+                     "Experiment " << m_names[worker.job] << " failed in its worker");
+    NS_ABORT_MSG_IF (!Deserialize (worker.data, results[worker.job]),
+                     "Experiment " << m_names[worker.job] << " sent a truncated result");
+  }
+
+  /// curves as (suffix size, suffix, point count, raw points) records
+  static std::string Serialize (const Curves &curves)
+  {
+    std::string data;
+    for (const std::pair<std::string, Points> &curve : curves)
+      {
+        uint64_t size = curve.first.size ();
+        uint64_t count = curve.second.size ();
+        data.append (reinterpret_cast<const char *> (&size), sizeof (size));
+        data.append (curve.first);
+        data.append (reinterpret_cast<const char *> (&count), sizeof (count));
+        data.append (reinterpret_cast<const char *> (curve.second.data ()), count * sizeof (curve.second[0]));
+      }
+    return data;
+  }
+
+  static bool Deserialize (const std::string &data, Curves &curves)
+  {
+    size_t offset = 0;
+    while (offset < data.size ())
+      {
+        uint64_t size, count;
+        if (data.size () - offset < sizeof (size))
+          {
+            return false;
+          }
+        std::copy (data.begin () + offset, data.begin () + offset + sizeof (size), reinterpret_cast<char *> (&size));
+        offset += sizeof (size);
+        if (data.size () - offset < size + sizeof (count))
+          {
+            return false;
+          }
+        std::string suffix = data.substr (offset, size);
+        offset += size;
+        std::copy (data.begin () + offset, data.begin () + offset + sizeof (count), reinterpret_cast<char *> (&count));
+        offset += sizeof (count);
+        if ((data.size () - offset) / sizeof (std::pair<double, double>) < count)
+          {
+            return false;
+          }
+        Points points (count);
+        size_t bytes = count * sizeof (std::pair<double, double>);
+        std::copy (data.begin () + offset, data.begin () + offset + bytes, reinterpret_cast<char *> (points.data ()));
+        offset += bytes;
+        curves.push_back (std::make_pair (suffix, points));
+      }
+    return true;
+  }
+
+  static bool WriteAll (int fd, const void *data, size_t size)
+  {
+    const char *p = static_cast<const char *> (data);
+    while (size > 0)
+      {
+        ssize_t n = write (fd, p, size);
+        if (n < 0 && errno == EINTR)
+          {
+            continue;
+          }
+        if (n <= 0)
+          {
+            return false;
+          }
+        p += n;
+        size -= n;
+      }
+    return true;
+  }
+
+  uint32_t m_workers;
+  std::vector<std::string> m_names;
+  std::vector<CurvesJob> m_jobs;
+};
+
+} // namespace ns3
+
+#endif /* PARALLEL_EXPERIMENTS_H */
@@ -0,0 +1,197 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef PROBE_SCHEDULER_H
+#define PROBE_SCHEDULER_H
+
+#include "benchmark.h"
+
+#include "ns3/object-factory.h"
+#include "ns3/scheduler.h"
+#include "ns3/string.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief A scheduler that records the shape of the event queue
+ *
+ * Every operation is forwarded to the scheduler named by the Scheduler
+ * attribute; on the way the probe builds a log2 histogram of the queue
+ * size seen by each insert and the mean and spread of how far ahead of
+ * the current time events are inserted. When the simulator is destroyed
+ * the figures are appended, as a BenchmarkRecord block, to the file named
+ * by the NS3_SCRATCH_COST environment variable, where scheduler-bench
+ * reads them back to pick a scheduler with Recommend.
+ *
+ * Select it with --SchedulerType=ns3::ProbeScheduler on the command line
+ * of a scratch, or with NS3_SCRATCH_SCHEDULER=ns3::ProbeScheduler in one that
+ * calls SimulatorCost::Enable. NS_GLOBAL_VALUE cannot name it: libcore
+ * reads that before the scratch registers this TypeId.
+ */
+class ProbeScheduler : public Scheduler
+{
+public:
+  /// size buckets: bucket b counts inserts into a queue of [2^b - 1, 2^(b+1) - 1) events
+  static constexpr uint32_t BUCKETS = 32;
+
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ProbeScheduler")
+      .SetParent<Scheduler> ()
+      .AddConstructor<ProbeScheduler> ()
+      .AddAttribute ("Scheduler",
+                     "The scheduler the events are forwarded to",
+                     StringValue ("ns3::MapScheduler"),
+                     MakeStringAccessor (&ProbeScheduler::m_schedulerType),
+                     MakeStringChecker ())
+    ;
+    return tid;
+  }
+
+  ProbeScheduler ()
+    : m_size (0),
+      m_now (0),
+      m_inserts (0),
+      m_cancels (0),
+      m_delaySum (0),
+      m_delaySquares (0)
+  {
+    std::fill (m_histogram, m_histogram + BUCKETS, 0);
+  }
+
+  ~ProbeScheduler () override
+  {
+    const char *path = std::getenv ("NS3_SCRATCH_COST");
+    if (path && m_inserts > 0)
+      {
+        std::ofstream os (path, std::ios::app);
+        os << GetRecord ().Serialize () << std::endl;
+      }
+  }
+
+  void Insert (const Event &ev) override
+  {
+    uint32_t bucket = 0;
+    while (bucket + 1 < BUCKETS && (uint64_t (2) << bucket) - 1 <= m_size)
+      {
+        ++bucket;
+      }
+    ++m_histogram[bucket];
+    ++m_inserts;
+    ++m_size;
+    double delay = ev.key.m_ts - m_now;
+    m_delaySum += delay;
+    m_delaySquares += delay * delay;
+    m_scheduler->Insert (ev);
+  }
+
+  bool IsEmpty (void) const override
+  {
+    return m_scheduler->IsEmpty ();
+  }
+
+  Event PeekNext (void) const override
+  {
+    return m_scheduler->PeekNext ();
+  }
+
+  Event RemoveNext (void) override
+  {
+    Event ev = m_scheduler->RemoveNext ();
+    --m_size;
+    m_now = ev.key.m_ts;
+    return ev;
+  }
+
+  void Remove (const Event &ev) override
+  {
+    --m_size;
+    ++m_cancels;
+    m_scheduler->Remove (ev);
+  }
+
+  /// \return the queue size at or under which a fraction of the inserts happened
+  uint64_t GetSizePercentile (double fraction) const
+  {
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < BUCKETS; ++b)
+      {
+        seen += m_histogram[b];
+        if (seen >= fraction * m_inserts)
+          {
+            return (uint64_t (2) << b) - 2;
+          }
+      }
+    return m_size;
+  }
+
+  BenchmarkRecord GetRecord (void) const
+  {
+    double mean = m_inserts ? m_delaySum / m_inserts : 0;
+    double variance = m_inserts ? std::max (m_delaySquares / m_inserts - mean * mean, 0.0) : 0;
+    BenchmarkRecord record;
+    record.SetString ("probe", m_schedulerType);
+    record.SetInteger ("inserts", m_inserts);
+    record.SetInteger ("cancels", m_cancels);
+    record.SetInteger ("p50Size", GetSizePercentile (0.5));
+    record.SetInteger ("p90Size", GetSizePercentile (0.9));
+    record.SetNumber ("meanDelayTicks", mean);
+    record.SetNumber ("delayCv", mean > 0 ? std::sqrt (variance) / mean : 0);
+    return record;
+  }
+
+  /**
+   * \brief Pick a scheduler for the queue a probe run saw
+   *
+   * A short queue is cheapest to keep as a sorted list. A long queue of
+   * events inserted about the same delay ahead (beacons, periodic timers)
+   * is what a timing wheel inserts and pops in constant time. Anything else
+   * goes to the heap, which unlike the default map does not allocate per
+   * event.
+   */
+  static std::string Recommend (double p90Size, double delayCv)
+  {
+    if (p90Size <= SHORT_QUEUE)
+      {
+        return "ns3::ListScheduler";
+      }
+    if (p90Size >= LONG_QUEUE && delayCv <= REGULAR_DELAYS)
+      {
+        return "ns3::TimingWheelScheduler";
+      }
+    return "ns3::HeapScheduler";
+  }
+
+protected:
+  void NotifyConstructionCompleted (void) override
+  {
+    ObjectFactory factory;
+    factory.SetTypeId (m_schedulerType);
+    m_scheduler = factory.Create<Scheduler> ();
+    Scheduler::NotifyConstructionCompleted ();
+  }
+
+private:
+  static constexpr double SHORT_QUEUE = 16;    ///< list below this many events
+  static constexpr double LONG_QUEUE = 1000;   ///< timing wheel from about this many events
+  static constexpr double REGULAR_DELAYS = 1;  ///< timing wheel at or below this delay spread
+
+  std::string m_schedulerType;
+  Ptr<Scheduler> m_scheduler;
+  uint64_t m_size;
+  uint64_t m_now;                  ///< timestamp of the last event removed
+  uint64_t m_histogram[BUCKETS];
+  uint64_t m_inserts;
+  uint64_t m_cancels;
+  double m_delaySum;
+  double m_delaySquares;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (ProbeScheduler);
+
+} // namespace ns3
+
+#endif /* PROBE_SCHEDULER_H */
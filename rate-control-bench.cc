@@ -0,0 +1,179 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Rate control benchmark matrix.
+ *
+ * Runs every rate control manager the wifi-adhoc scratches compare over
+ * the same fixed scenarios, 2, 3 and 5 nodes in a line (the first node
+ * saturating the last) and in a mesh (every node saturating every other),
+ * with fixed seeds. For every case it reports the simulated throughput and
+ * what the simulator paid for it: wall time, events, events/s and peak RSS,
+ * as JSON so that two versions of the tree can be compared case by case.
+ *
+ *   ./ns3 run "rate-control-bench --runs=3 --output=bench.json"
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/log.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/string.h"
+#include "ns3/yans-wifi-helper.h"
+#include "benchmark.h"
+#include "experiment-harness.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("RateControlBench");
+
+namespace {
+
+/// one fixed scenario of the matrix
+struct Scenario
+{
+  std::string name;
+  uint32_t nodes;
+  bool mesh; ///< every node sends to every other, else the first to the last
+};
+
+const char *const g_managers[] = {
+  "ns3::ArfWifiManager",  "ns3::AarfWifiManager",  "ns3::AarfcdWifiManager",
+  "ns3::CaraWifiManager", "ns3::RraaWifiManager",  "ns3::IdealWifiManager",
+  "ns3::MinstrelWifiManager",
+};
+
+std::vector<Scenario>
+GetScenarios (void)
+{
+  std::vector<Scenario> scenarios;
+  for (uint32_t nodes : {2, 3, 5})
+    {
+      scenarios.push_back ({"line" + std::to_string (nodes), nodes, false});
+      scenarios.push_back ({"mesh" + std::to_string (nodes), nodes, true});
+    }
+  return scenarios;
+}
+
+/// \brief Run one case of the matrix, in the forked child of RunIsolated
+BenchmarkRecord
+RunCase (const Scenario &scenario, std::string manager, uint32_t seed, uint32_t run,
+         double spacing, double duration)
+{
+  RngSeedManager::SetSeed (seed);
+  RngSeedManager::SetRun (run);
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211a);
+  wifi.SetRemoteStationManager (manager);
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  YansWifiPhyHelper wifiPhy;
+  YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
+
+  // a line keeps its nodes on the x axis, a mesh packs them in a square grid
+  uint32_t width = std::ceil (std::sqrt (scenario.nodes));
+  TopologyPolicy topology = scenario.mesh ? TopologyPolicy::Grid (scenario.nodes, width, spacing, spacing)
+                                          : TopologyPolicy::Line (scenario.nodes, spacing);
+  TrafficPolicy traffic = scenario.mesh ? TrafficPolicy::FullMesh ()
+                                        : TrafficPolicy::Pair (0, scenario.nodes - 1);
+  traffic.SetTimes (Seconds (0.5), Seconds (duration));
+
+  ExperimentHarness harness (scenario.name, topology, traffic, MobilityPolicy::Static ());
+  if (!scenario.mesh)
+    {
+      harness.SetReceivers ({scenario.nodes - 1});
+    }
+  harness.SetMeter (Seconds (1.0), 1, Seconds (0.5), Seconds (duration));
+  // rate managers may keep timers running once the traffic stopped
+  Simulator::Stop (Seconds (duration + 1.0));
+  harness.Run (wifi, wifiPhy, wifiMac, wifiChannel);
+
+  BenchmarkRecord record;
+  record.SetNumber ("throughputMbps", harness.GetBytes () * 8.0 / (duration - 0.5) / 1000000);
+  record.SetNumber ("wallSeconds", harness.GetWallTime ());
+  record.SetInteger ("events", harness.GetEventCount ());
+  record.SetNumber ("eventsPerSecond", harness.GetEventCount () / harness.GetWallTime ());
+  return record;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  uint32_t seed = 1;
+  uint32_t runs = 1;
+  double spacing = 30.0;
+  double duration = 30.0;
+  std::string managers;
+  std::string scenarios;
+  std::string output;
+  cmd.AddValue ("seed", "Seed of every case", seed);
+  cmd.AddValue ("runs", "Runs of every case, numbered from 1", runs);
+  cmd.AddValue ("spacing", "Metres between neighbouring nodes", spacing);
+  cmd.AddValue ("duration", "Simulated seconds of traffic", duration);
+  cmd.AddValue ("managers", "Comma separated managers to run, all when empty", managers);
+  cmd.AddValue ("scenarios", "Comma separated scenarios to run, all when empty", scenarios);
+  cmd.AddValue ("output", "File the JSON results go to, standard output when empty", output);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (duration <= 0.5, "The traffic starts at 0.5s, the duration must be longer");
+
+  // "," around the lists so that a name only matches a whole item
+  auto selected = [] (const std::string &list, const std::string &name) {
+    return list.empty () || ("," + list + ",").find ("," + name + ",") != std::string::npos;
+  };
+
+  BenchmarkRecord meta;
+  meta.SetString ("benchmark", "rate-control");
+  meta.SetInteger ("seed", seed);
+  meta.SetInteger ("runs", runs);
+  meta.SetNumber ("spacing", spacing);
+  meta.SetNumber ("duration", duration);
+
+  std::vector<BenchmarkRecord> results;
+  for (const Scenario &scenario : GetScenarios ())
+    {
+      if (!selected (scenarios, scenario.name))
+        {
+          continue;
+        }
+      for (const char *manager : g_managers)
+        {
+          if (!selected (managers, manager) && !selected (managers, std::string (manager).substr (5)))
+            {
+              continue;
+            }
+          for (uint32_t run = 1; run <= runs; ++run)
+            {
+              NS_LOG_UNCOND (scenario.name << " " << manager << " run " << run);
+              BenchmarkRecord record;
+              record.SetString ("scenario", scenario.name);
+              record.SetString ("manager", manager);
+              record.SetInteger ("nodes", scenario.nodes);
+              record.SetInteger ("run", run);
+              record.Merge (RunIsolated ([&] () {
+                return RunCase (scenario, manager, seed, run, spacing, duration);
+              }));
+              results.push_back (record);
+            }
+        }
+    }
+
+  if (output.empty ())
+    {
+      WriteBenchmarkJson (std::cout, meta, results);
+    }
+  else
+    {
+      std::ofstream os (output);
+      NS_ABORT_MSG_IF (!os, "Cannot write " << output);
+      WriteBenchmarkJson (os, meta, results);
+    }
+  return 0;
+}
@@ -0,0 +1,418 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef ROUTING_CLASSIFIER_H
+#define ROUTING_CLASSIFIER_H
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <array>
+#include <ostream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Sort the IPv4 packets of a MANET into routing message types
+ *
+ * The classifier hooks the Tx, Rx and Drop traces of Ipv4L3Protocol and
+ * reads the few bytes that tell the routing protocols apart: the IP
+ * protocol, the UDP destination port (654 AODV, 698 OLSR, 269 DSDV), then
+ * the message type of AODV and OLSR, or the first option of a DSR control
+ * packet. The bytes are copied to a buffer of the classifier, so a packet
+ * costs no allocation and no string work. OLSR bundles several messages in
+ * one packet: the packet counts for the type of its first message and
+ * every message counts for its own type.
+ *
+ * Transmissions are also counted per interval, from the start given to
+ * Start, into bins sized when it is called.
+ */
+class RoutingClassifier
+{
+public:
+  /// What a packet carries
+  enum Kind
+  {
+    AODV_RREQ,
+    AODV_RREP,
+    AODV_RERR,
+    AODV_RREP_ACK,
+    AODV_OTHER,
+    OLSR_HELLO,
+    OLSR_TC,
+    OLSR_MID,
+    OLSR_HNA,
+    OLSR_OTHER,
+    DSDV_UPDATE,
+    DSR_RREQ,
+    DSR_RREP,
+    DSR_RERR,
+    DSR_ACK,
+    DSR_OTHER,
+    DATA,
+    OTHER,
+    KINDS
+  };
+
+  /// Where a packet was seen
+  enum Direction
+  {
+    TX,
+    RX,
+    DROP,
+    DIRECTIONS
+  };
+
+  typedef std::array<uint64_t, KINDS> Counters;
+
+  RoutingClassifier ()
+    : m_interval (Seconds (1.0)),
+      m_start (Seconds (0)),
+      m_olsrMessages (0)
+  {
+    Reset ();
+  }
+
+  /// \return the name of a kind, "protocol.message"
+  static const char *GetName (Kind kind)
+  {
+    static const char *names[KINDS] = {
+      "aodv.rreq", "aodv.rrep", "aodv.rerr", "aodv.rrepAck", "aodv.other",
+      "olsr.hello", "olsr.tc", "olsr.mid", "olsr.hna", "olsr.other",
+      "dsdv.update",
+      "dsr.rreq", "dsr.rrep", "dsr.rerr", "dsr.ack", "dsr.other",
+      "data", "other"
+    };
+    return names[kind];
+  }
+
+  /// \return true for the control messages of a routing protocol
+  static bool IsRouting (Kind kind)
+  {
+    return kind < DATA;
+  }
+
+  /// \brief Hook the IPv4 traces of every node, which must have an Ipv4L3Protocol
+  void Install (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = (*i)->GetObject<Ipv4L3Protocol> ();
+        NS_ABORT_MSG_IF (!ipv4, "Node " << (*i)->GetId () << " has no IPv4 stack");
+        ipv4->TraceConnectWithoutContext ("Tx", MakeCallback (&RoutingClassifier::Tx, this));
+        ipv4->TraceConnectWithoutContext ("Rx", MakeCallback (&RoutingClassifier::Rx, this));
+        ipv4->TraceConnectWithoutContext ("Drop", MakeCallback (&RoutingClassifier::Drop, this));
+      }
+  }
+
+  /**
+   * \brief Count the transmissions of every interval between start and stop
+   *
+   * Later transmissions still count in the totals, and grow the bins.
+   */
+  void Start (Time interval, Time start, Time stop)
+  {
+    NS_ABORT_MSG_IF (interval.IsZero (), "RoutingClassifier needs a positive interval");
+    m_interval = interval;
+    m_start = start;
+    uint32_t bins = stop > start ? (stop - start).GetDouble () / interval.GetDouble () + 1 : 0;
+    m_bins.assign (bins, Counters ());
+  }
+
+  void Reset (void)
+  {
+    for (uint32_t d = 0; d < DIRECTIONS; ++d)
+      {
+        m_packets[d].fill (0);
+        m_bytes[d].fill (0);
+        m_messages[d].fill (0);
+      }
+    m_bins.clear ();
+  }
+
+  uint64_t GetPackets (Direction direction, Kind kind) const
+  {
+    return m_packets[direction][kind];
+  }
+
+  uint64_t GetBytes (Direction direction, Kind kind) const
+  {
+    return m_bytes[direction][kind];
+  }
+
+  uint64_t GetMessages (Direction direction, Kind kind) const
+  {
+    return m_messages[direction][kind];
+  }
+
+  /// \return the routing packets seen in a direction, of every protocol
+  uint64_t GetRoutingPackets (Direction direction) const
+  {
+    uint64_t total = 0;
+    for (uint32_t k = 0; k < DATA; ++k)
+      {
+        total += m_packets[direction][k];
+      }
+    return total;
+  }
+
+  uint64_t GetRoutingBytes (Direction direction) const
+  {
+    uint64_t total = 0;
+    for (uint32_t k = 0; k < DATA; ++k)
+      {
+        total += m_bytes[direction][k];
+      }
+    return total;
+  }
+
+  /// \return the packets transmitted per kind, one entry per interval
+  const std::vector<Counters> &GetSeries (void) const
+  {
+    return m_bins;
+  }
+
+  /// \brief Write the transmission series, one line per interval and one column per kind seen
+  void WriteSeries (std::ostream &os) const
+  {
+    os << "time";
+    for (uint32_t k = 0; k < KINDS; ++k)
+      {
+        if (m_packets[TX][k])
+          {
+            os << "," << GetName (static_cast<Kind> (k));
+          }
+      }
+    os << std::endl;
+    for (uint32_t b = 0; b < m_bins.size (); ++b)
+      {
+        os << (m_start + m_interval * (b + 1)).GetSeconds ();
+        for (uint32_t k = 0; k < KINDS; ++k)
+          {
+            if (m_packets[TX][k])
+              {
+                os << "," << m_bins[b][k];
+              }
+          }
+        os << std::endl;
+      }
+  }
+
+  /// \brief Classify a packet that starts with its IPv4 header
+  Kind Classify (Ptr<const Packet> packet)
+  {
+    uint32_t size = packet->CopyData (m_buffer, PEEK);
+    if (size < IPV4_MIN || (m_buffer[0] >> 4) != 4)
+      {
+        return OTHER;
+      }
+    uint32_t ihl = (m_buffer[0] & 0x0f) * 4;
+    uint8_t protocol = m_buffer[9];
+    if (protocol == UDP && Port (ihl, size) == OLSR_PORT)
+      {
+        // OLSR may need the whole packet to walk its messages
+        size = packet->CopyData (m_buffer, sizeof (m_buffer));
+      }
+    return ClassifyL4 (protocol, m_buffer + std::min (ihl, size), size - std::min (ihl, size));
+  }
+
+  /// \brief Classify the payload of an IPv4 packet, whose header is apart
+  Kind Classify (const Ipv4Header &header, Ptr<const Packet> packet)
+  {
+    uint32_t size = packet->CopyData (m_buffer, PEEK);
+    if (header.GetProtocol () == UDP && size >= UDP_HEADER
+        && ((m_buffer[2] << 8) | m_buffer[3]) == OLSR_PORT)
+      {
+        size = packet->CopyData (m_buffer, sizeof (m_buffer));
+      }
+    return ClassifyL4 (header.GetProtocol (), m_buffer, size);
+  }
+
+private:
+  static constexpr uint8_t TCP = 6;
+  static constexpr uint8_t UDP = 17;
+  static constexpr uint8_t DSR = 48;
+  static constexpr uint16_t AODV_PORT = 654;
+  static constexpr uint16_t OLSR_PORT = 698;
+  static constexpr uint16_t DSDV_PORT = 269;
+  static constexpr uint32_t IPV4_MIN = 20;
+  static constexpr uint32_t UDP_HEADER = 8;
+  /// enough for the IPv4, UDP and routing headers that tell the kinds apart
+  static constexpr uint32_t PEEK = 96;
+
+  /// \return the UDP destination port after an IPv4 header of ihl bytes, 0 if truncated
+  uint16_t Port (uint32_t ihl, uint32_t size) const
+  {
+    if (size < ihl + UDP_HEADER)
+      {
+        return 0;
+      }
+    return (m_buffer[ihl + 2] << 8) | m_buffer[ihl + 3];
+  }
+
+  /// \brief Classify the transport payload of size bytes at l4, and count the OLSR messages
+  Kind ClassifyL4 (uint8_t protocol, const uint8_t *l4, uint32_t size)
+  {
+    m_olsrMessages = 0;
+    if (protocol == DSR)
+      {
+        // DsrFsHeader, 8 bytes: next header, message type (1 control, 2 data),
+        // source id and destination id (2 bytes each), payload length (2 bytes);
+        // the options of a control packet follow, the first type at l4[8]
+        if (size < 2 || l4[1] != 1)
+          {
+            return size >= 2 && l4[1] == 2 ? DATA : DSR_OTHER;
+          }
+        switch (size > 8 ? l4[8] : 0)
+          {
+          case 1:
+            return DSR_RREQ;
+          case 2:
+            return DSR_RREP;
+          case 3:
+            return DSR_RERR;
+          case 32:
+          case 160:
+            return DSR_ACK;
+          default:
+            return DSR_OTHER;
+          }
+      }
+    if (protocol != UDP)
+      {
+        return protocol == TCP ? DATA : OTHER;
+      }
+    if (size < UDP_HEADER)
+      {
+        return OTHER;
+      }
+    uint16_t port = (l4[2] << 8) | l4[3];
+    const uint8_t *payload = l4 + UDP_HEADER;
+    uint32_t length = size - UDP_HEADER;
+    switch (port)
+      {
+      case AODV_PORT:
+        switch (length ? payload[0] : 0)
+          {
+          case 1:
+            return AODV_RREQ;
+          case 2:
+            return AODV_RREP;
+          case 3:
+            return AODV_RERR;
+          case 4:
+            return AODV_RREP_ACK;
+          default:
+            return AODV_OTHER;
+          }
+      case OLSR_PORT:
+        return ClassifyOlsr (payload, length);
+      case DSDV_PORT:
+        return DSDV_UPDATE;
+      default:
+        return DATA;
+      }
+  }
+
+  /// \brief Walk the messages after the 4 byte OLSR packet header
+  Kind ClassifyOlsr (const uint8_t *payload, uint32_t length)
+  {
+    Kind first = OLSR_OTHER;
+    uint32_t offset = 4;
+    // message header: type, vtime, then the size of the message, header included
+    while (offset + 4 <= length)
+      {
+        Kind kind = OlsrKind (payload[offset]);
+        if (m_olsrMessages == 0)
+          {
+            first = kind;
+          }
+        m_olsrKinds[m_olsrMessages++ % OLSR_BATCH] = kind;
+        uint16_t messageSize = (payload[offset + 2] << 8) | payload[offset + 3];
+        if (messageSize < 4 || m_olsrMessages == OLSR_BATCH)
+          {
+            break;
+          }
+        offset += messageSize;
+      }
+    return first;
+  }
+
+  static Kind OlsrKind (uint8_t type)
+  {
+    switch (type)
+      {
+      case 1:
+        return OLSR_HELLO;
+      case 2:
+        return OLSR_TC;
+      case 3:
+        return OLSR_MID;
+      case 4:
+        return OLSR_HNA;
+      default:
+        return OLSR_OTHER;
+      }
+  }
+
+  void Count (Direction direction, Kind kind, uint32_t bytes)
+  {
+    m_packets[direction][kind]++;
+    m_bytes[direction][kind] += bytes;
+    if (m_olsrMessages == 0)
+      {
+        m_messages[direction][kind]++;
+      }
+    for (uint32_t i = 0; i < m_olsrMessages; ++i)
+      {
+        m_messages[direction][m_olsrKinds[i]]++;
+      }
+    if (direction == TX && !m_bins.empty () && Simulator::Now () >= m_start)
+      {
+        uint64_t bin = (Simulator::Now () - m_start).GetDouble () / m_interval.GetDouble ();
+        if (bin >= m_bins.size ())
+          {
+            m_bins.resize (bin + 1, Counters ());
+          }
+        m_bins[bin][kind]++;
+      }
+  }
+
+  void Tx (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    Count (TX, Classify (packet), packet->GetSize ());
+  }
+
+  void Rx (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    Count (RX, Classify (packet), packet->GetSize ());
+  }
+
+  void Drop (const Ipv4Header &header, Ptr<const Packet> packet,
+             Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    Count (DROP, Classify (header, packet), header.GetSerializedSize () + packet->GetSize ());
+  }
+
+  /// messages of one OLSR packet counted per type, more are ignored
+  static constexpr uint32_t OLSR_BATCH = 16;
+
+  Time m_interval;
+  Time m_start;
+  Counters m_packets[DIRECTIONS];
+  Counters m_bytes[DIRECTIONS];
+  Counters m_messages[DIRECTIONS];
+  std::vector<Counters> m_bins;     ///< transmissions per interval since m_start
+  uint8_t m_buffer[1600];           ///< bytes of the packet being classified
+  Kind m_olsrKinds[OLSR_BATCH];     ///< messages of the last OLSR packet
+  uint32_t m_olsrMessages;          ///< messages in m_olsrKinds
+};
+
+} // namespace ns3
+
+#endif /* ROUTING_CLASSIFIER_H */
@@ -3,107 +3,445 @@
 #include "ns3/mobility-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/applications-module.h"
+#include "ns3/wifi-module.h"
 #include "ns3/aodv-module.h"
-#include "ns3/point-to-point-module.h"
-#include "ns3/netanim-module.h"
+#include "ns3/olsr-module.h"
+#include "ns3/dsdv-module.h"
+#include "ns3/dsr-module.h"
+#include "benchmark.h"
+#include "latency-histogram.h"
+#include "routing-classifier.h"
+#include "send-time-tag.h"
+#include "simulator-cost.h"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+/*
+ * MANET routing benchmark.
+ *
+ * Every case puts the given number of random-waypoint nodes on a square
+ * whose area grows with the node count, so that the density stays the same
+ * across sizes, runs one routing protocol (AODV, OLSR, DSDV or DSR) over
+ * 802.11b ad hoc devices and loads it with a traffic matrix of CBR UDP
+ * flows between random node pairs. It reports the packet delivery ratio,
+ * the mean and percentiles of the end-to-end delay, see SendTimeTag, the
+ * normalized routing load (routing packets sent, counting every hop, per
+ * data packet delivered), the transmissions of every routing message type,
+ * see RoutingClassifier, and what the simulator paid: setup and run wall
+ * time, events, events/s and peak RSS. Every case runs in its own forked
+ * process, see RunIsolated.
+ *
+ *   ./ns3 run "routing --protocols=aodv,olsr --nodes=100,500,1000,5000 --output=manet.json"
+ */
 
 using namespace ns3;
 
+NS_LOG_COMPONENT_DEFINE("ManetRouting");
+
 // Define data structures to collect performance metrics
-uint32_t totalPacketsSent = 0;
-uint32_t totalPacketsReceived = 0;
-uint32_t totalPacketDrops = 0;
-Time totalTimeDelay = Seconds(0);
-uint32_t totalRoutingOverhead = 0;
+uint64_t totalPacketsSent = 0;
+uint64_t totalPacketsReceived = 0;
+// routing control traffic, by message type
+RoutingClassifier classifier;
+// end-to-end delay of the data packets, per receiving node
+NodeLatency latency;
+
+// One case of the benchmark matrix
+struct Scenario
+{
+    std::string protocol;
+    uint32_t nodes;
+    uint32_t flows;
+    DataRate rate;
+    uint32_t packetSize;
+    double areaPerNode;
+    double warmup;
+    double duration;
+    double overheadInterval;
+    std::string overheadFile;
+};
+
+// A CBR UDP source that stamps its packets with SendTimeTag before sending
+// them: the socket sends a copy, so OnOffApplication, whose Tx trace fires
+// after the send, cannot stamp what reaches the sink
+class StampedCbrSource : public Application
+{
+public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::StampedCbrSource")
+                                .SetParent<Application>()
+                                .AddConstructor<StampedCbrSource>()
+                                .AddTraceSource("Tx",
+                                                "A packet was sent",
+                                                MakeTraceSourceAccessor(&StampedCbrSource::m_txTrace),
+                                                "ns3::Packet::TracedCallback");
+        return tid;
+    }
+
+    StampedCbrSource()
+        : m_packetSize(0)
+    {
+    }
+
+    void Setup(const Address &peer, DataRate rate, uint32_t packetSize)
+    {
+        m_peer = peer;
+        m_rate = rate;
+        m_packetSize = packetSize;
+    }
+
+protected:
+    void DoDispose() override
+    {
+        m_socket = nullptr;
+        Application::DoDispose();
+    }
+
+private:
+    void StartApplication() override
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind();
+        m_socket->Connect(m_peer);
+        m_socket->ShutdownRecv();
+        // the first packet one interval after the start, as OnOffApplication sends it
+        m_sendEvent = Simulator::Schedule(m_rate.CalculateBytesTxTime(m_packetSize),
+                                          &StampedCbrSource::SendPacket, this);
+    }
+
+    void StopApplication() override
+    {
+        Simulator::Cancel(m_sendEvent);
+        if (m_socket)
+        {
+            m_socket->Close();
+        }
+    }
+
+    void SendPacket()
+    {
+        Ptr<Packet> packet = Create<Packet>(m_packetSize);
+        SendTimeTag::Stamp(packet);
+        if (m_socket->Send(packet) == static_cast<int>(m_packetSize))
+        {
+            m_txTrace(packet);
+        }
+        m_sendEvent = Simulator::Schedule(m_rate.CalculateBytesTxTime(m_packetSize),
+                                          &StampedCbrSource::SendPacket, this);
+    }
+
+    Address m_peer;
+    DataRate m_rate;
+    uint32_t m_packetSize;
+    Ptr<Socket> m_socket;
+    EventId m_sendEvent;
+    TracedCallback<Ptr<const Packet>> m_txTrace;
+};
 
 void PacketSend(Ptr<const Packet> packet)
 {
     totalPacketsSent++;
 }
 
-void PacketReceive(Ptr<const Packet> packet, const Ipv4Header &header, Ptr<NetDevice> input, Ptr<NetDevice> ocb, Ptr<const Packet> oPacket, const Address &source)
+void PacketReceive(uint32_t node, Ptr<const Packet> packet, const Address &source)
 {
     totalPacketsReceived++;
-    // Calculate delay
-    Time now = Simulator::Now();
-    Time packetDelay = now - Time(header.GetTimestamp().GetMicroSeconds() * 1e-6); // Convert microseconds to seconds
-    totalTimeDelay += packetDelay;
+    Time delay;
+    if (SendTimeTag::GetDelay(packet, delay))
+    {
+        latency.Add(node, delay);
+    }
 }
 
-void PacketDrop(Ptr<const Packet> packet, const Ipv4Header &header)
+BenchmarkRecord RunCase(const Scenario &scenario)
 {
-    totalPacketDrops++;
-}
+    SimulatorCost::Enable();
+    std::chrono::steady_clock::time_point setupStart = std::chrono::steady_clock::now();
 
-int main(int argc, char *argv[])
-{
     // Step 1: Initialize nodes and containers
     NodeContainer nodes;
-    nodes.Create(100); // Create 100 vehicle nodes
+    nodes.Create(scenario.nodes);
+
+    // Step 2: 802.11b ad hoc devices
+    WifiHelper wifi;
+    wifi.SetStandard(WIFI_STANDARD_80211b);
+    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                 "DataMode", StringValue("DsssRate11Mbps"),
+                                 "ControlMode", StringValue("DsssRate11Mbps"));
+    YansWifiPhyHelper wifiPhy;
+    wifiPhy.Set("TxPowerStart", DoubleValue(7.5));
+    wifiPhy.Set("TxPowerEnd", DoubleValue(7.5));
+    YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default();
+    wifiPhy.SetChannel(wifiChannel.Create());
+    WifiMacHelper wifiMac;
+    wifiMac.SetType("ns3::AdhocWifiMac");
+    NetDeviceContainer devices = wifi.Install(wifiPhy, wifiMac, nodes);
+
+    // Step 3: Define the Mobility Model, over an area that keeps the density constant
+    double side = std::sqrt(scenario.nodes * scenario.areaPerNode);
+    std::ostringstream coordinate;
+    coordinate << "ns3::UniformRandomVariable[Min=0.0|Max=" << side << "]";
+    ObjectFactory positions;
+    positions.SetTypeId("ns3::RandomRectanglePositionAllocator");
+    positions.Set("X", StringValue(coordinate.str()));
+    positions.Set("Y", StringValue(coordinate.str()));
+    Ptr<PositionAllocator> positionAlloc = positions.Create()->GetObject<PositionAllocator>();
 
-    // Step 2: Define the Mobility Model
     MobilityHelper mobility;
-    mobility.SetPositionAllocator("ns3::GridPositionAllocator",
-                                  "MinX", DoubleValue(0.0),
-                                  "MinY", DoubleValue(0.0),
-                                  "DeltaX", DoubleValue(5.0),
-                                  "DeltaY", DoubleValue(5.0),
-                                  "GridWidth", UintegerValue(10),
-                                  "LayoutType", StringValue("RowFirst"));
+    mobility.SetPositionAllocator(positionAlloc);
     mobility.SetMobilityModel("ns3::RandomWaypointMobilityModel",
                               "Speed", StringValue("ns3::ConstantRandomVariable[Constant=20]"),
-                              "Pause", StringValue("ns3::ConstantRandomVariable[Constant=0.1]"));
-
+                              "Pause", StringValue("ns3::ConstantRandomVariable[Constant=0.1]"),
+                              "PositionAllocator", PointerValue(positionAlloc));
     mobility.Install(nodes);
 
-    // Step 3: Install the Internet Stack
+    // Step 4: Install the Internet Stack with the routing protocol, once
     InternetStackHelper internet;
-    internet.Install(nodes);
-
-    // Step 4: Implement the AODV Routing Protocol
     AodvHelper aodv;
+    OlsrHelper olsr;
+    DsdvHelper dsdv;
     Ipv4ListRoutingHelper list;
-    list.Add(aodv, 100);
-
-    InternetStackHelper internetStack;
-    internetStack.SetRoutingHelper(list);
-    internetStack.Install(nodes);
-
-    // Step 5: Define Traffic and Applications
-    UdpEchoClientHelper echoClient(Ipv4Address("1.2.3.4"), 9);
-    echoClient.SetAttribute("MaxPackets", UintegerValue(1));
-    echoClient.SetAttribute("Interval", TimeValue(Seconds(1.0)));
-    echoClient.SetAttribute("PacketSize", UintegerValue(512));
-
-    ApplicationContainer clientApps = echoClient.Install(nodes.Get(0));
-    clientApps.Start(Seconds(2.0));
-    clientApps.Stop(Seconds(10.0));
-
-    UdpEchoServerHelper echoServer(9);
-    ApplicationContainer serverApps = echoServer.Install(nodes.Get(9));
-    serverApps.Start(Seconds(1.0));
-    serverApps.Stop(Seconds(11.0));
-
-    // Install callbacks for packet send, receive, and drop events
-    Config::ConnectWithoutContext("/NodeList/*/$ns3::Ipv4L3Protocol/Tx", MakeCallback(&PacketSend));
-    Config::ConnectWithoutContext("/NodeList/*/$ns3::Ipv4L3Protocol/Rx", MakeCallback(&PacketReceive));
-    Config::ConnectWithoutContext("/NodeList/*/$ns3::Ipv4L3Protocol/Drop", MakeCallback(&PacketDrop));
-
-    // Step 8: Run the Simulation
-    Simulator::Stop(Seconds(12.0));
+    if (scenario.protocol == "aodv")
+    {
+        list.Add(aodv, 100);
+    }
+    else if (scenario.protocol == "olsr")
+    {
+        list.Add(olsr, 100);
+    }
+    else if (scenario.protocol == "dsdv")
+    {
+        list.Add(dsdv, 100);
+    }
+    else if (scenario.protocol != "dsr")
+    {
+        NS_FATAL_ERROR("Unknown routing protocol " << scenario.protocol);
+    }
+    if (scenario.protocol == "dsr")
+    {
+        internet.Install(nodes);
+        DsrHelper dsr;
+        DsrMainHelper dsrMain;
+        dsrMain.Install(dsr, nodes);
+    }
+    else
+    {
+        internet.SetRoutingHelper(list);
+        internet.Install(nodes);
+    }
+
+    Ipv4AddressHelper address;
+    address.SetBase("10.0.0.0", "255.255.0.0");
+    Ipv4InterfaceContainer interfaces = address.Assign(devices);
+
+    // Step 5: Traffic matrix, CBR flows between random pairs of distinct nodes
+    uint16_t port = 9;
+    Ptr<UniformRandomVariable> pick = CreateObject<UniformRandomVariable>();
+    std::vector<bool> hasSink(scenario.nodes, false);
+    for (uint32_t i = 0; i < scenario.flows; ++i)
+    {
+        uint32_t source = pick->GetInteger(0, scenario.nodes - 1);
+        uint32_t sink = pick->GetInteger(0, scenario.nodes - 2);
+        if (sink >= source)
+        {
+            ++sink;
+        }
+
+        if (!hasSink[sink])
+        {
+            PacketSinkHelper sinkHelper("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
+            ApplicationContainer sinkApps = sinkHelper.Install(nodes.Get(sink));
+            sinkApps.Get(0)->TraceConnectWithoutContext("Rx",
+                                                        MakeBoundCallback(&PacketReceive, nodes.Get(sink)->GetId()));
+            sinkApps.Start(Seconds(0.0));
+            hasSink[sink] = true;
+        }
+
+        Ptr<StampedCbrSource> client = CreateObject<StampedCbrSource>();
+        client->Setup(InetSocketAddress(interfaces.GetAddress(sink), port), scenario.rate, scenario.packetSize);
+        client->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSend));
+        nodes.Get(source)->AddApplication(client);
+        // staggered so that the flows do not all discover their routes at once
+        client->SetStartTime(Seconds(scenario.warmup + pick->GetValue(0.0, 1.0)));
+        client->SetStopTime(Seconds(scenario.warmup + scenario.duration));
+    }
+
+    // Classify what every node sends, receives and drops at the IPv4 layer
+    classifier.Install(nodes);
+    classifier.Start(Seconds(scenario.overheadInterval), Seconds(0),
+                     Seconds(scenario.warmup + scenario.duration + 1.0));
+
+    // Step 8: Run the Simulation, with time for the last packets to arrive
+    Simulator::Stop(Seconds(scenario.warmup + scenario.duration + 1.0));
+    std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
     Simulator::Run();
+    double run = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    double setup = std::chrono::duration<double>(runStart - setupStart).count();
+
+    // Step 9: Calculate the performance metrics
+    double packetDeliveryRatio = totalPacketsSent ? static_cast<double>(totalPacketsReceived) / totalPacketsSent : 0;
+    LatencyHistogram delays = latency.Merge();
+    double averageDelay = delays.GetMean().GetSeconds();
+    uint64_t routingPackets = classifier.GetRoutingPackets(RoutingClassifier::TX);
+    double normalizedRoutingLoad = totalPacketsReceived ? static_cast<double>(routingPackets) / totalPacketsReceived : 0;
 
-    // Step 9: Calculate and print the performance metrics
-    double packetDropRatio = static_cast<double>(totalPacketDrops) / totalPacketsSent;
-    double averageDelay = totalTimeDelay.GetSeconds() / totalPacketsReceived;
-    double normalizedRoutingLoad = static_cast<double>(totalRoutingOverhead) / totalPacketsSent;
+    NS_LOG_UNCOND(scenario.protocol << " " << scenario.nodes << " nodes:"
+                  << " PDR " << packetDeliveryRatio
+                  << ", average delay " << averageDelay << " s"
+                  << ", NRL " << normalizedRoutingLoad);
 
-    NS_LOG_UNCOND("Packet Drop Ratio: " << packetDropRatio);
-    NS_LOG_UNCOND("Average Delay: " << averageDelay << " seconds");
-    NS_LOG_UNCOND("Normalized Routing Load: " << normalizedRoutingLoad);
+    BenchmarkRecord record;
+    record.SetInteger("dataSent", totalPacketsSent);
+    record.SetInteger("dataReceived", totalPacketsReceived);
+    record.SetNumber("pdr", packetDeliveryRatio);
+    record.SetNumber("meanDelayMs", averageDelay * 1000);
+    record.SetNumber("p50DelayMs", delays.GetQuantile(0.5).GetSeconds() * 1000);
+    record.SetNumber("p90DelayMs", delays.GetQuantile(0.9).GetSeconds() * 1000);
+    record.SetNumber("p99DelayMs", delays.GetQuantile(0.99).GetSeconds() * 1000);
+    record.SetInteger("routingPackets", routingPackets);
+    record.SetInteger("routingBytes", classifier.GetRoutingBytes(RoutingClassifier::TX));
+    record.SetNumber("normalizedRoutingLoad", normalizedRoutingLoad);
+    uint64_t ipDrops = 0;
+    for (uint32_t k = 0; k < RoutingClassifier::KINDS; ++k)
+    {
+        RoutingClassifier::Kind kind = static_cast<RoutingClassifier::Kind>(k);
+        ipDrops += classifier.GetPackets(RoutingClassifier::DROP, kind);
+        if (RoutingClassifier::IsRouting(kind) && classifier.GetPackets(RoutingClassifier::TX, kind))
+        {
+            record.SetInteger(std::string("tx.") + RoutingClassifier::GetName(kind),
+                              classifier.GetPackets(RoutingClassifier::TX, kind));
+        }
+    }
+    record.SetInteger("ipDrops", ipDrops);
+    record.SetNumber("setupSeconds", setup);
+    record.SetNumber("runSeconds", run);
+    record.SetInteger("events", Simulator::GetEventCount());
+    record.SetNumber("eventsPerSecond", Simulator::GetEventCount() / run);
+
+    if (!scenario.overheadFile.empty())
+    {
+        std::ofstream os(scenario.overheadFile);
+        NS_ABORT_MSG_IF(!os, "Cannot write " << scenario.overheadFile);
+        classifier.WriteSeries(os);
+    }
 
     Simulator::Destroy();
+    return record;
+}
 
-    return 0;
+std::vector<std::string> SplitList(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::istringstream is(list);
+    std::string item;
+    while (std::getline(is, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
 }
 
+int main(int argc, char *argv[])
+{
+    std::string protocols = "aodv,olsr,dsdv,dsr";
+    std::string nodeCounts = "100";
+    uint32_t flows = 0;
+    std::string rate = "16kbps";
+    uint32_t packetSize = 512;
+    double areaPerNode = 9000.0;
+    double warmup = 10.0;
+    double duration = 60.0;
+    uint32_t seed = 1;
+    uint32_t run = 1;
+    bool isolate = true;
+    std::string output;
+    double overheadInterval = 1.0;
+    std::string overhead;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("protocols", "Comma separated protocols among aodv, olsr, dsdv and dsr", protocols);
+    cmd.AddValue("nodes", "Comma separated node counts", nodeCounts);
+    cmd.AddValue("flows", "CBR flows per case, 0 for one per ten nodes", flows);
+    cmd.AddValue("rate", "Rate of every flow", rate);
+    cmd.AddValue("packetSize", "Size of the data packets", packetSize);
+    cmd.AddValue("areaPerNode", "Square metres of the field per node", areaPerNode);
+    cmd.AddValue("warmup", "Seconds of routing before the flows start", warmup);
+    cmd.AddValue("duration", "Seconds the flows send for", duration);
+    cmd.AddValue("seed", "Seed of every case", seed);
+    cmd.AddValue("run", "Run number of every case", run);
+    cmd.AddValue("isolate", "Run every case in its own forked process", isolate);
+    cmd.AddValue("output", "File the JSON results go to, standard output when empty", output);
+    cmd.AddValue("overhead", "Prefix of the CSV routing transmissions per interval of every case, none when empty", overhead);
+    cmd.AddValue("overheadInterval", "Seconds of every interval of the routing transmissions", overheadInterval);
+    cmd.Parse(argc, argv);
+
+    std::vector<std::string> protocolList = SplitList(protocols);
+    std::vector<std::string> nodeList = SplitList(nodeCounts);
+    NS_ABORT_MSG_IF(!isolate && protocolList.size() * nodeList.size() != 1,
+                    "Without isolation only one case can run, ns-3 has one simulator per process");
+
+    BenchmarkRecord meta;
+    meta.SetString("benchmark", "manet-routing");
+    meta.SetString("rate", rate);
+    meta.SetInteger("packetSize", packetSize);
+    meta.SetNumber("areaPerNode", areaPerNode);
+    meta.SetNumber("warmup", warmup);
+    meta.SetNumber("duration", duration);
+    meta.SetInteger("seed", seed);
+    meta.SetInteger("run", run);
+
+    std::vector<BenchmarkRecord> results;
+    for (const std::string &protocol : protocolList)
+    {
+        for (const std::string &count : nodeList)
+        {
+            Scenario scenario;
+            scenario.protocol = protocol;
+            scenario.nodes = std::stoul(count);
+            NS_ABORT_MSG_IF(scenario.nodes < 2, "A case needs at least two nodes");
+            scenario.flows = flows ? flows : std::max<uint32_t>(scenario.nodes / 10, 1);
+            scenario.rate = DataRate(rate);
+            scenario.packetSize = packetSize;
+            scenario.areaPerNode = areaPerNode;
+            scenario.warmup = warmup;
+            scenario.duration = duration;
+            scenario.overheadInterval = overheadInterval;
+            if (!overhead.empty())
+            {
+                scenario.overheadFile = overhead + "-" + protocol + "-" + count + ".csv";
+            }
+
+            auto job = [&scenario, seed, run]() {
+                RngSeedManager::SetSeed(seed);
+                RngSeedManager::SetRun(run);
+                return RunCase(scenario);
+            };
+            BenchmarkRecord record;
+            record.SetString("protocol", protocol);
+            record.SetInteger("nodes", scenario.nodes);
+            record.SetInteger("flows", scenario.flows);
+            record.Merge(isolate ? RunIsolated(job) : job());
+            results.push_back(record);
+        }
+    }
+
+    if (output.empty())
+    {
+        WriteBenchmarkJson(std::cout, meta, results);
+    }
+    else
+    {
+        std::ofstream os(output);
+        NS_ABORT_MSG_IF(!os, "Cannot write " << output);
+        WriteBenchmarkJson(os, meta, results);
+    }
+
+    return 0;
+}
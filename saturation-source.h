@@ -0,0 +1,165 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef SATURATION_SOURCE_H
+#define SATURATION_SOURCE_H
+
+#include "ns3/abort.h"
+#include "ns3/application.h"
+#include "ns3/packet.h"
+#include "ns3/packet-socket-address.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/txop.h"
+#include "ns3/qos-txop.h"
+#include "ns3/uinteger.h"
+#include "ns3/wifi-mac.h"
+#include "ns3/wifi-mac-queue.h"
+#include "ns3/wifi-net-device.h"
+
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Keeps the wifi MAC queue of a node full without a send timer
+ *
+ * An OnOffApplication faster than the channel saturates a node by enqueuing
+ * packets on a timer and having the MAC queue drop what does not fit, one
+ * timer event and usually one drop per packet. This source instead watches
+ * the queue the packets go to: every time a frame leaves it (dequeued for
+ * transmission, dropped or expired) it tops the queue up to Depth packets.
+ * The MAC therefore always finds a frame waiting, which is all saturation
+ * needs, and a packet is only created when there is room for it.
+ *
+ * The destinations are served in turn, the way the per-destination
+ * OnOffApplications of a node share its queue. All destinations must be
+ * PacketSocketAddresses bound to the same wifi device of the node.
+ */
+class SaturationSource : public Application
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::SaturationSource")
+      .SetParent<Application> ()
+      .AddConstructor<SaturationSource> ()
+      .AddAttribute ("PacketSize",
+                     "The size of the packets sent",
+                     UintegerValue (2000),
+                     MakeUintegerAccessor (&SaturationSource::m_packetSize),
+                     MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("Depth",
+                     "The number of packets kept in the MAC queue",
+                     UintegerValue (2),
+                     MakeUintegerAccessor (&SaturationSource::m_depth),
+                     MakeUintegerChecker<uint32_t> (1))
+    ;
+    return tid;
+  }
+
+  SaturationSource ()
+    : m_packetSize (2000),
+      m_depth (2),
+      m_next (0),
+      m_sent (0)
+  {
+  }
+
+  /// \brief Add a destination, served in turn with the others
+  void AddDestination (const PacketSocketAddress &destination)
+  {
+    m_destinations.push_back (destination);
+  }
+
+  /// \return the number of packets handed to the device
+  uint64_t GetSent () const
+  {
+    return m_sent;
+  }
+
+protected:
+  void DoDispose (void) override
+  {
+    m_socket = 0;
+    m_queue = 0;
+    Application::DoDispose ();
+  }
+
+private:
+  void StartApplication (void) override
+  {
+    NS_ABORT_MSG_IF (m_destinations.empty (), "SaturationSource without destination");
+    Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (
+      GetNode ()->GetDevice (m_destinations.front ().GetSingleDevice ()));
+    NS_ABORT_MSG_IF (!device, "SaturationSource needs a wifi device");
+    Ptr<WifiMac> mac = device->GetMac ();
+    // the queue the packets of a data frame go to, AC_BE when QoS is used
+    m_queue = mac->GetQosSupported () ? mac->GetQosTxop (AC_BE)->GetWifiMacQueue ()
+                                      : mac->GetTxop ()->GetWifiMacQueue ();
+    m_queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&SaturationSource::NotifyLeave, this));
+    m_queue->TraceConnectWithoutContext ("Drop", MakeCallback (&SaturationSource::NotifyLeave, this));
+    m_queue->TraceConnectWithoutContext ("Expired", MakeCallback (&SaturationSource::NotifyLeave, this));
+
+    m_socket = Socket::CreateSocket (GetNode (), TypeId::LookupByName ("ns3::PacketSocketFactory"));
+    PacketSocketAddress local;
+    local.SetSingleDevice (m_destinations.front ().GetSingleDevice ());
+    local.SetProtocol (m_destinations.front ().GetProtocol ());
+    m_socket->Bind (local);
+    // send only, like OnOffApplication: nothing received may pile up in the socket
+    m_socket->ShutdownRecv ();
+    Refill ();
+  }
+
+  void StopApplication (void) override
+  {
+    m_refill.Cancel ();
+    if (m_queue)
+      {
+        m_queue->TraceDisconnectWithoutContext ("Dequeue", MakeCallback (&SaturationSource::NotifyLeave, this));
+        m_queue->TraceDisconnectWithoutContext ("Drop", MakeCallback (&SaturationSource::NotifyLeave, this));
+        m_queue->TraceDisconnectWithoutContext ("Expired", MakeCallback (&SaturationSource::NotifyLeave, this));
+      }
+    if (m_socket)
+      {
+        m_socket->Close ();
+      }
+  }
+
+  /// \brief Called from inside the queue, the refill waits until the MAC is done with it
+  void NotifyLeave (Ptr<const WifiMacQueueItem> item)
+  {
+    if (!m_refill.IsRunning ())
+      {
+        m_refill = Simulator::ScheduleNow (&SaturationSource::Refill, this);
+      }
+  }
+
+  void Refill (void)
+  {
+    while (m_queue->GetNPackets () < m_depth)
+      {
+        uint32_t before = m_queue->GetNPackets ();
+        m_socket->SendTo (Create<Packet> (m_packetSize), 0, m_destinations[m_next]);
+        m_next = (m_next + 1) % m_destinations.size ();
+        ++m_sent;
+        if (m_queue->GetNPackets () <= before)
+          {
+            break; // the device did not queue it, wait for the next frame to leave
+          }
+      }
+  }
+
+  uint32_t m_packetSize;
+  uint32_t m_depth;
+  std::vector<PacketSocketAddress> m_destinations;
+  uint32_t m_next;        ///< index of the next destination
+  uint64_t m_sent;
+  Ptr<Socket> m_socket;
+  Ptr<WifiMacQueue> m_queue;
+  EventId m_refill;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (SaturationSource);
+
+} // namespace ns3
+
+#endif /* SATURATION_SOURCE_H */
@@ -0,0 +1,272 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Scaling curve of a scratch program.
+ *
+ * Runs the program at geometric node counts (50, 100, ... 6400 by default)
+ * with every simulation cut at a short horizon, and records the setup and
+ * run wall time, the events and the peak RSS of each size, as reported by
+ * the SimulatorCost hook of the scratch. It then fits cost = a * nodes^b
+ * by least squares in log-log space over the largest sizes measured,
+ * extrapolates every cost to the target size and flags the phase, setup
+ * or run, whose exponent is the worst: an exponent well above 1 is a
+ * superlinear blowup (channel fan-out, global routing, range checks)
+ * found in minutes rather than after a run of days.
+ *
+ * The node count replaces {nodes} in the arguments, or is passed as
+ * --nodes=N if they have none. The run time and the events are fitted per
+ * simulated second, then scaled to targetTime. Sizes stop growing once
+ * one takes longer than budget seconds of wall time.
+ *
+ *   ./ns3 run "scaling-bench --program=build/scratch/ns3.36-routing-default
+ *              --args='--protocols=aodv --nodes={nodes}' --target=20000 --targetTime=600"
+ *   ./ns3 run "scaling-bench --program=build/scratch/ns3.36-Vanet-default
+ *              --args='--nodes={nodes} --totaltime=300' --horizon=5"
+ */
+
+#include "ns3/abort.h"
+#include "ns3/command-line.h"
+#include "ns3/log.h"
+#include "benchmark.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("ScalingBench");
+
+namespace {
+
+std::vector<std::string>
+Split (const std::string &list, char separator)
+{
+  std::vector<std::string> items;
+  std::istringstream is (list);
+  std::string item;
+  while (std::getline (is, item, separator))
+    {
+      if (!item.empty ())
+        {
+          items.push_back (item);
+        }
+    }
+  return items;
+}
+
+/// cost = coefficient * nodes^exponent
+struct PowerLaw
+{
+  double coefficient;
+  double exponent;
+  double r2; ///< of the fit in log-log space
+  uint32_t points;
+
+  double At (double nodes) const
+  {
+    return coefficient * std::pow (nodes, exponent);
+  }
+};
+
+/// \brief Fit a power law over the points whose cost is positive
+PowerLaw
+Fit (const std::vector<double> &nodes, const std::vector<double> &cost)
+{
+  double sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < nodes.size (); ++i)
+    {
+      if (cost[i] <= 0 || nodes[i] <= 0)
+        {
+          continue;
+        }
+      double x = std::log (nodes[i]);
+      double y = std::log (cost[i]);
+      sx += x;
+      sy += y;
+      sxx += x * x;
+      sxy += x * y;
+      syy += y * y;
+      ++n;
+    }
+  PowerLaw law = {0, NAN, NAN, n};
+  double vx = n * sxx - sx * sx;
+  if (n < 2 || vx <= 0)
+    {
+      return law;
+    }
+  law.exponent = (n * sxy - sx * sy) / vx;
+  law.coefficient = std::exp ((sy - law.exponent * sx) / n);
+  double vy = n * syy - sy * sy;
+  law.r2 = vy > 0 ? (n * sxy - sx * sy) * (n * sxy - sx * sy) / (vx * vy) : 1;
+  return law;
+}
+
+/// \return the arguments with {nodes} replaced, or --nodes appended
+std::vector<std::string>
+WithNodes (const std::vector<std::string> &args, uint32_t nodes)
+{
+  std::vector<std::string> result;
+  bool replaced = false;
+  for (std::string arg : args)
+    {
+      std::string::size_type at;
+      while ((at = arg.find ("{nodes}")) != std::string::npos)
+        {
+          arg.replace (at, 7, std::to_string (nodes));
+          replaced = true;
+        }
+      result.push_back (arg);
+    }
+  if (!replaced)
+    {
+      result.push_back ("--nodes=" + std::to_string (nodes));
+    }
+  return result;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  std::string program;
+  std::string args;
+  std::string nodeCounts = "50,100,200,400,800,1600,3200,6400";
+  double horizon = 10.0;
+  double budget = 3600.0;
+  uint32_t fitPoints = 4;
+  uint32_t target = 0;
+  double targetTime = 0;
+  std::string output;
+  cmd.AddValue ("program", "Scratch program to run", program);
+  cmd.AddValue ("args", "Space separated arguments of the program, {nodes} is the node count", args);
+  cmd.AddValue ("nodes", "Comma separated node counts, in increasing order", nodeCounts);
+  cmd.AddValue ("horizon", "Simulated seconds every simulation is cut at, 0 to let them end", horizon);
+  cmd.AddValue ("budget", "Wall seconds after which no larger size is run", budget);
+  cmd.AddValue ("fitPoints", "Largest sizes the power laws are fitted over, 0 for all", fitPoints);
+  cmd.AddValue ("target", "Node count to extrapolate to, 0 for ten times the largest", target);
+  cmd.AddValue ("targetTime", "Simulated seconds of the target run, 0 for those of the runs", targetTime);
+  cmd.AddValue ("output", "File the JSON results go to, standard output when empty", output);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (program.empty (), "--program is required");
+  std::vector<std::string> programArgs = Split (args, ' ');
+
+  std::vector<BenchmarkRecord> results;
+  std::vector<double> nodes, setup, runPerSecond, eventsPerSecond, rss;
+  for (const std::string &count : Split (nodeCounts, ','))
+    {
+      uint32_t n = std::stoul (count);
+      NS_LOG_UNCOND (n << " nodes");
+      std::vector<BenchmarkRecord> blocks;
+      BenchmarkRecord record;
+      record.SetInteger ("nodes", n);
+      record.Merge (RunProgram (program, WithNodes (programArgs, n), "", horizon, true, blocks));
+      results.push_back (record);
+      if (record.Has ("error"))
+        {
+          NS_LOG_UNCOND ("  failed, stopping here");
+          break;
+        }
+      double simulated = record.GetNumber ("simulatedSeconds");
+      nodes.push_back (n);
+      setup.push_back (record.GetNumber ("setupSeconds"));
+      runPerSecond.push_back (simulated > 0 ? record.GetNumber ("runSeconds") / simulated : 0);
+      eventsPerSecond.push_back (simulated > 0 ? record.GetNumber ("events") / simulated : 0);
+      rss.push_back (record.GetNumber ("peakRssKb"));
+      NS_LOG_UNCOND ("  setup " << setup.back () << " s, run " << record.GetNumber ("runSeconds")
+                     << " s, " << record.GetNumber ("events") << " events, " << rss.back () << " kB");
+      if (record.GetNumber ("wallSeconds") > budget)
+        {
+          NS_LOG_UNCOND ("  over the budget, stopping here");
+          break;
+        }
+    }
+  NS_ABORT_MSG_IF (nodes.size () < 2, "At least two sizes must run to fit a scaling curve");
+
+  // the smallest sizes are dominated by fixed costs, fit over the largest
+  uint32_t first = fitPoints && nodes.size () > fitPoints ? nodes.size () - fitPoints : 0;
+  auto tail = [first] (const std::vector<double> &v) {
+    return std::vector<double> (v.begin () + first, v.end ());
+  };
+  std::vector<double> fitNodes = tail (nodes);
+  if (target == 0)
+    {
+      target = nodes.back () * 10;
+    }
+  if (targetTime <= 0)
+    {
+      targetTime = horizon > 0 ? horizon : results[nodes.size () - 1].GetNumber ("simulatedSeconds");
+    }
+
+  BenchmarkRecord meta;
+  meta.SetString ("benchmark", "scaling");
+  meta.SetString ("program", program);
+  meta.SetString ("args", args);
+  meta.SetNumber ("horizon", horizon);
+  meta.SetInteger ("fitFrom", nodes[first]);
+  meta.SetInteger ("target", target);
+  meta.SetNumber ("targetTime", targetTime);
+
+  struct Phase
+  {
+    const char *name;
+    const std::vector<double> &cost;
+    double scale; ///< from the fitted cost to the target cost
+    PowerLaw law;
+  };
+  // run time and events are fitted per simulated second
+  Phase phases[] = {{"setupSeconds", setup, 1, {}},
+                    {"runSeconds", runPerSecond, targetTime, {}},
+                    {"events", eventsPerSecond, targetTime, {}},
+                    {"peakRssKb", rss, 1, {}}};
+  for (Phase &phase : phases)
+    {
+      PowerLaw law = Fit (fitNodes, tail (phase.cost));
+      phase.law = law;
+      std::string name = phase.name;
+      meta.SetNumber (name + "Exponent", law.exponent);
+      meta.SetNumber (name + "R2", law.r2);
+      meta.SetNumber (name + "AtTarget", law.At (target) * phase.scale);
+      NS_LOG_UNCOND (name << ": exponent " << law.exponent << " (r2 " << law.r2 << "), "
+                     << law.At (target) * phase.scale << " at " << target << " nodes");
+    }
+
+  // local exponents show where the curve bends
+  for (uint32_t i = 1; i < nodes.size (); ++i)
+    {
+      double x = std::log (nodes[i] / nodes[i - 1]);
+      BenchmarkRecord &record = results[i];
+      if (setup[i] > 0 && setup[i - 1] > 0)
+        {
+          record.SetNumber ("setupLocalExponent", std::log (setup[i] / setup[i - 1]) / x);
+        }
+      if (runPerSecond[i] > 0 && runPerSecond[i - 1] > 0)
+        {
+          record.SetNumber ("runLocalExponent", std::log (runPerSecond[i] / runPerSecond[i - 1]) / x);
+        }
+    }
+
+  double setupExponent = phases[0].law.exponent;
+  double runExponent = phases[1].law.exponent;
+  std::string worst = std::isnan (runExponent) || setupExponent > runExponent ? "setup" : "run";
+  meta.SetString ("worstPhase", worst);
+  NS_LOG_UNCOND ("worst phase: " << worst);
+
+  if (output.empty ())
+    {
+      WriteBenchmarkJson (std::cout, meta, results);
+    }
+  else
+    {
+      std::ofstream os (output);
+      NS_ABORT_MSG_IF (!os, "Cannot write " << output);
+      WriteBenchmarkJson (os, meta, results);
+    }
+  return 0;
+}
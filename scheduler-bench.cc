@@ -0,0 +1,172 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Scheduler benchmark and auto-selection.
+ *
+ * Runs a scratch program once per scheduler (map, heap, list, calendar and
+ * timingWheel by default) and reports the events/s of its simulations, as
+ * measured by the SimulatorCost hook of the scratch, together with the wall
+ * time and peak RSS of the whole program. The scheduler is passed in
+ * NS3_SCRATCH_SCHEDULER and installed by SimulatorCost::Enable, so the
+ * scratch needs no option for it.
+ *
+ * Before the measured runs the program is run once for calibrationTime
+ * simulated seconds under ProbeScheduler, and the scheduler
+ * ProbeScheduler::Recommend picks from the event queue it saw is reported
+ * too. With --auto the measured runs are skipped: the program is run for
+ * good under the recommended scheduler, output included.
+ *
+ *   ./ns3 run "scheduler-bench --program=build/scratch/ns3.36-Vanet-default
+ *              --args='--totaltime=100' --output=schedulers.json"
+ */
+
+#include "ns3/abort.h"
+#include "ns3/command-line.h"
+#include "ns3/log.h"
+#include "benchmark.h"
+#include "probe-scheduler.h"
+
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SchedulerBench");
+
+namespace {
+
+std::vector<std::string>
+Split (const std::string &list, char separator)
+{
+  std::vector<std::string> items;
+  std::istringstream is (list);
+  std::string item;
+  while (std::getline (is, item, separator))
+    {
+      if (!item.empty ())
+        {
+          items.push_back (item);
+        }
+    }
+  return items;
+}
+
+/// \return the TypeId name of a scheduler given by its short name or in full
+std::string
+GetSchedulerType (const std::string &name)
+{
+  if (name.find ("::") != std::string::npos)
+    {
+      return name;
+    }
+  std::string type = "ns3::" + name + "Scheduler";
+  type[5] = std::toupper (type[5]);
+  return type;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  std::string program;
+  std::string args;
+  std::string schedulers = "map,heap,list,calendar,timingWheel";
+  uint32_t runs = 1;
+  double calibrationTime = 10.0;
+  bool autoSelect = false;
+  std::string output;
+  cmd.AddValue ("program", "Scratch program to run", program);
+  cmd.AddValue ("args", "Space separated arguments of the program", args);
+  cmd.AddValue ("schedulers", "Comma separated schedulers, short names or TypeIds", schedulers);
+  cmd.AddValue ("runs", "Measured runs per scheduler", runs);
+  cmd.AddValue ("calibrationTime", "Simulated seconds of the calibration run, 0 to skip it", calibrationTime);
+  cmd.AddValue ("auto", "Run the program under the recommended scheduler instead of benchmarking", autoSelect);
+  cmd.AddValue ("output", "File the JSON results go to, standard output when empty", output);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (program.empty (), "--program is required");
+  NS_ABORT_MSG_IF (autoSelect && calibrationTime <= 0, "--auto needs a calibration run");
+  std::vector<std::string> programArgs = Split (args, ' ');
+
+  BenchmarkRecord meta;
+  meta.SetString ("benchmark", "scheduler");
+  meta.SetString ("program", program);
+  meta.SetString ("args", args);
+  meta.SetInteger ("runs", runs);
+
+  std::string recommended;
+  if (calibrationTime > 0)
+    {
+      NS_LOG_UNCOND ("calibrating over " << calibrationTime << "s");
+      std::vector<BenchmarkRecord> blocks;
+      BenchmarkRecord calibration = RunProgram (program, programArgs, "ns3::ProbeScheduler",
+                                                calibrationTime, true, blocks);
+      // the busiest simulation of the program decides
+      const BenchmarkRecord *probe = nullptr;
+      for (const BenchmarkRecord &block : blocks)
+        {
+          if (block.Has ("probe") && (!probe || block.GetNumber ("inserts") > probe->GetNumber ("inserts")))
+            {
+              probe = &block;
+            }
+        }
+      NS_ABORT_MSG_IF (!probe, "The calibration run did not report its event queue");
+      recommended = ProbeScheduler::Recommend (probe->GetNumber ("p90Size"), probe->GetNumber ("delayCv"));
+      meta.SetNumber ("calibrationTime", calibrationTime);
+      meta.SetNumber ("calibrationP50Size", probe->GetNumber ("p50Size"));
+      meta.SetNumber ("calibrationP90Size", probe->GetNumber ("p90Size"));
+      meta.SetNumber ("calibrationDelayCv", probe->GetNumber ("delayCv"));
+      meta.SetString ("recommended", recommended);
+      NS_LOG_UNCOND ("recommended scheduler: " << recommended);
+    }
+
+  if (autoSelect)
+    {
+      setenv ("NS3_SCRATCH_SCHEDULER", recommended.c_str (), 1);
+      std::vector<char *> programArgv;
+      programArgv.push_back (const_cast<char *> (program.c_str ()));
+      for (std::string &arg : programArgs)
+        {
+          programArgv.push_back (const_cast<char *> (arg.c_str ()));
+        }
+      programArgv.push_back (nullptr);
+      execvp (program.c_str (), programArgv.data ());
+      NS_FATAL_ERROR ("Cannot run " << program);
+    }
+
+  std::vector<BenchmarkRecord> results;
+  for (const std::string &name : Split (schedulers, ','))
+    {
+      std::string scheduler = GetSchedulerType (name);
+      for (uint32_t run = 1; run <= runs; ++run)
+        {
+          NS_LOG_UNCOND (scheduler << " run " << run);
+          std::vector<BenchmarkRecord> blocks;
+          BenchmarkRecord record;
+          record.SetString ("scheduler", scheduler);
+          record.Merge (RunProgram (program, programArgs, scheduler, 0, true, blocks));
+          record.SetInteger ("run", run);
+          results.push_back (record);
+        }
+    }
+
+  if (output.empty ())
+    {
+      WriteBenchmarkJson (std::cout, meta, results);
+    }
+  else
+    {
+      std::ofstream os (output);
+      NS_ABORT_MSG_IF (!os, "Cannot write " << output);
+      WriteBenchmarkJson (os, meta, results);
+    }
+  return 0;
+}
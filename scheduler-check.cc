@@ -0,0 +1,146 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Randomized check of TimingWheelScheduler against MapScheduler.
+ *
+ * Both schedulers get the same random sequence of inserts, removals of
+ * pending events, peeks and removals of the next event, with the delays
+ * spread over the current granule, the two wheels and beyond, the way a
+ * simulator uses them: events are never inserted before the time of the
+ * last event removed. Every peek and every next event must agree on the
+ * (time, uid) key; the program aborts at the first difference.
+ *
+ *   ./ns3 run "scheduler-check --operations=1000000 --seed=3"
+ */
+
+#include "ns3/abort.h"
+#include "ns3/command-line.h"
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/object-factory.h"
+#include "ns3/scheduler.h"
+#include "timing-wheel-scheduler.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SchedulerCheck");
+
+namespace {
+
+Ptr<Scheduler>
+CreateScheduler (const std::string &type, Time granularity)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (type);
+  if (type == "ns3::TimingWheelScheduler")
+    {
+      factory.Set ("Granularity", TimeValue (granularity));
+    }
+  return factory.Create<Scheduler> ();
+}
+
+void
+Compare (const Scheduler::Event &expected, const Scheduler::Event &actual, uint64_t operation)
+{
+  NS_ABORT_MSG_IF (expected.key.m_ts != actual.key.m_ts || expected.key.m_uid != actual.key.m_uid,
+                   "operation " << operation << ": MapScheduler has (" << expected.key.m_ts << ", "
+                   << expected.key.m_uid << "), TimingWheelScheduler (" << actual.key.m_ts << ", "
+                   << actual.key.m_uid << ")");
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  uint64_t operations = 200000;
+  uint32_t seed = 1;
+  Time granularity = MicroSeconds (100);
+  cmd.AddValue ("operations", "Random operations to run", operations);
+  cmd.AddValue ("seed", "Seed of the operation sequence", seed);
+  cmd.AddValue ("granularity", "Granularity of the timing wheel", granularity);
+  cmd.Parse (argc, argv);
+
+  Ptr<Scheduler> reference = CreateScheduler ("ns3::MapScheduler", granularity);
+  Ptr<Scheduler> wheel = CreateScheduler ("ns3::TimingWheelScheduler", granularity);
+
+  // delays within the granule, the first wheel, the second wheel and past it
+  uint64_t ticks = granularity.GetTimeStep ();
+  uint64_t spans[] = {ticks, ticks * TimingWheelScheduler::SLOTS,
+                      ticks * TimingWheelScheduler::SLOTS * TimingWheelScheduler::SLOTS,
+                      ticks * TimingWheelScheduler::SLOTS * TimingWheelScheduler::SLOTS * 4};
+  std::mt19937_64 random (seed);
+  // the pending events, and where each uid is in that vector
+  std::vector<Scheduler::Event> pending;
+  std::unordered_map<uint32_t, uint32_t> index;
+  auto forget = [&pending, &index] (uint32_t i) {
+    index.erase (pending[i].key.m_uid);
+    pending[i] = pending.back ();
+    pending.pop_back ();
+    if (i < pending.size ())
+      {
+        index[pending[i].key.m_uid] = i;
+      }
+  };
+  uint64_t now = 0;
+  uint32_t uid = 0;
+  uint64_t removed = 0;
+  uint64_t cancelled = 0;
+  for (uint64_t operation = 0; operation < operations; ++operation)
+    {
+      uint32_t choice = random () % 16;
+      if (choice < 8 || pending.empty ())
+        {
+          Scheduler::Event ev;
+          ev.impl = nullptr;
+          // some events share a time stamp, only the uid orders them
+          uint64_t delay = choice == 0 ? 0 : random () % spans[random () % 4];
+          ev.key.m_ts = now + delay;
+          ev.key.m_uid = uid++;
+          ev.key.m_context = 0;
+          reference->Insert (ev);
+          wheel->Insert (ev);
+          index[ev.key.m_uid] = pending.size ();
+          pending.push_back (ev);
+        }
+      else if (choice < 10)
+        {
+          uint32_t i = random () % pending.size ();
+          reference->Remove (pending[i]);
+          wheel->Remove (pending[i]);
+          forget (i);
+          ++cancelled;
+        }
+      else if (choice < 12)
+        {
+          // peeking may move the current slot of the wheel ahead of now
+          Compare (reference->PeekNext (), wheel->PeekNext (), operation);
+        }
+      else
+        {
+          Scheduler::Event expected = reference->RemoveNext ();
+          Compare (expected, wheel->RemoveNext (), operation);
+          now = expected.key.m_ts;
+          forget (index[expected.key.m_uid]);
+          ++removed;
+        }
+      NS_ABORT_MSG_IF (reference->IsEmpty () != wheel->IsEmpty (),
+                       "operation " << operation << ": the schedulers disagree on emptiness");
+    }
+  while (!reference->IsEmpty ())
+    {
+      Compare (reference->RemoveNext (), wheel->RemoveNext (), operations);
+      ++removed;
+    }
+  NS_ABORT_MSG_IF (!wheel->IsEmpty (), "TimingWheelScheduler has events left");
+
+  NS_LOG_UNCOND ("seed " << seed << ": " << uid << " inserted, " << removed << " run, "
+                 << cancelled << " removed, the schedulers agree");
+  return 0;
+}
@@ -0,0 +1,110 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef SEND_TIME_TAG_H
+#define SEND_TIME_TAG_H
+
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/tag.h"
+
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * \brief The time a packet was sent, in 8 bytes
+ *
+ * A byte tag, so that it stays on the payload through every layer and hop.
+ * Stamp the packet before it is handed to the socket and read it on
+ * delivery:
+ *
+ *   Ptr<Packet> packet = Create<Packet> (size);
+ *   SendTimeTag::Stamp (packet);
+ *   socket->Send (packet);
+ *   ...
+ *   Time delay;
+ *   if (SendTimeTag::GetDelay (packet, delay)) ...
+ *
+ * A socket sends a copy of the packet, so a tag added afterwards, for
+ * instance from the Tx trace of OnOffApplication, which fires after the
+ * send, never reaches the receiver.
+ */
+class SendTimeTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::SendTimeTag")
+      .SetParent<Tag> ()
+      .AddConstructor<SendTimeTag> ()
+    ;
+    return tid;
+  }
+
+  SendTimeTag ()
+    : m_sent (0)
+  {
+  }
+
+  explicit SendTimeTag (Time sent)
+    : m_sent (sent.GetTimeStep ())
+  {
+  }
+
+  TypeId GetInstanceTypeId (void) const override
+  {
+    return GetTypeId ();
+  }
+
+  uint32_t GetSerializedSize (void) const override
+  {
+    return 8;
+  }
+
+  void Serialize (TagBuffer i) const override
+  {
+    i.WriteU64 (m_sent);
+  }
+
+  void Deserialize (TagBuffer i) override
+  {
+    m_sent = i.ReadU64 ();
+  }
+
+  void Print (std::ostream &os) const override
+  {
+    os << "sent=" << GetSent ();
+  }
+
+  Time GetSent (void) const
+  {
+    return TimeStep (m_sent);
+  }
+
+  /// \brief Tag a packet with the current time
+  static void Stamp (Ptr<const Packet> packet)
+  {
+    packet->AddByteTag (SendTimeTag (Simulator::Now ()));
+  }
+
+  /// \return false if the packet was not stamped, else set delay to the time since it was
+  static bool GetDelay (Ptr<const Packet> packet, Time &delay)
+  {
+    SendTimeTag tag;
+    if (!packet->FindFirstMatchingByteTag (tag))
+      {
+        return false;
+      }
+    delay = Simulator::Now () - tag.GetSent ();
+    return true;
+  }
+
+private:
+  uint64_t m_sent; ///< time steps of the send time
+};
+
+NS_OBJECT_ENSURE_REGISTERED (SendTimeTag);
+
+} // namespace ns3
+
+#endif /* SEND_TIME_TAG_H */
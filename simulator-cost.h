@@ -0,0 +1,128 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef SIMULATOR_COST_H
+#define SIMULATOR_COST_H
+
+#include "benchmark.h"
+#include "probe-scheduler.h"
+#include "timing-wheel-scheduler.h"
+
+#include "ns3/global-value.h"
+#include "ns3/nstime.h"
+#include "ns3/object-factory.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief What a simulation cost, reported to a driving benchmark
+ *
+ * A scratch calls Enable once its command line is parsed, before building
+ * its topology. If the NS3_SCRATCH_COST environment variable names a file,
+ * the setup and run wall times, the event count, the scheduler and the
+ * peak RSS of the simulation are appended to it as a BenchmarkRecord block
+ * when the simulator is destroyed; otherwise Enable does nothing. Setup
+ * ends when the first event runs. NS3_SCRATCH_COST_STOP, in simulated
+ * seconds, stops the simulation early for short calibration runs.
+ *
+ * Enable can be called again for the next simulation of the process.
+ *
+ * If NS3_SCRATCH_SCHEDULER names a scheduler TypeId, Enable installs it,
+ * whether or not the cost is reported. This is how a benchmark picks the
+ * scheduler of a scratch that has no option for it: NS_GLOBAL_VALUE is
+ * read while libcore is loaded, before the schedulers defined in this
+ * directory are registered, so it cannot name ProbeScheduler or
+ * TimingWheelScheduler, which including this header links in.
+ */
+class SimulatorCost
+{
+public:
+  static void Enable (void)
+  {
+    State &state = GetState ();
+    const char *scheduler = std::getenv ("NS3_SCRATCH_SCHEDULER");
+    if (scheduler && *scheduler && !state.enabled)
+      {
+        ObjectFactory factory;
+        factory.SetTypeId (scheduler);
+        Simulator::SetScheduler (factory);
+      }
+    const char *path = std::getenv ("NS3_SCRATCH_COST");
+    if (!path || state.enabled)
+      {
+        return;
+      }
+    state.enabled = true;
+    state.path = path;
+    state.setupStart = std::chrono::steady_clock::now ();
+    state.runStart = state.setupStart;
+    const char *stop = std::getenv ("NS3_SCRATCH_COST_STOP");
+    if (stop)
+      {
+        Simulator::Stop (Seconds (std::atof (stop)));
+      }
+    Simulator::ScheduleNow (&SimulatorCost::NotifyRunStart);
+    Simulator::ScheduleDestroy (&SimulatorCost::NotifyDestroy);
+  }
+
+private:
+  struct State
+  {
+    bool enabled;
+    std::string path;
+    std::chrono::steady_clock::time_point setupStart;
+    std::chrono::steady_clock::time_point runStart;
+  };
+
+  static State &GetState (void)
+  {
+    static State state = {false, "", {}, {}};
+    return state;
+  }
+
+  static void NotifyRunStart (void)
+  {
+    GetState ().runStart = std::chrono::steady_clock::now ();
+  }
+
+  static void NotifyDestroy (void)
+  {
+    State &state = GetState ();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now ();
+    double setup = std::chrono::duration<double> (state.runStart - state.setupStart).count ();
+    double run = std::chrono::duration<double> (end - state.runStart).count ();
+    // the SchedulerType global value, unless Enable installed another one
+    StringValue scheduler;
+    GlobalValue::GetValueByName ("SchedulerType", scheduler);
+    const char *installed = std::getenv ("NS3_SCRATCH_SCHEDULER");
+    if (installed && *installed)
+      {
+        scheduler.Set (installed);
+      }
+    struct rusage usage = {};
+    getrusage (RUSAGE_SELF, &usage);
+
+    BenchmarkRecord record;
+    record.SetString ("scheduler", scheduler.Get ());
+    record.SetNumber ("setupSeconds", setup);
+    record.SetNumber ("runSeconds", run);
+    record.SetInteger ("events", Simulator::GetEventCount ());
+    record.SetNumber ("eventsPerSecond", Simulator::GetEventCount () / run);
+    record.SetNumber ("simulatedSeconds", Simulator::Now ().GetSeconds ());
+    record.SetInteger ("peakRssKb", usage.ru_maxrss);
+    std::ofstream os (state.path, std::ios::app);
+    os << record.Serialize () << std::endl;
+    state.enabled = false;
+  }
+};
+
+} // namespace ns3
+
+#endif /* SIMULATOR_COST_H */
@@ -0,0 +1,271 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef STEADY_STATE_MONITOR_H
+#define STEADY_STATE_MONITOR_H
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Stops the simulation once the watched metrics reached steady state
+ *
+ * The program records one observation per metric and per sampling interval,
+ * e.g. the sink throughput or the PDR of the last second. After every
+ * complete set of observations the warm-up of each metric is estimated with
+ * MSER-5: the series is averaged in batches of 5 and the truncation point d
+ * minimising the variance of the remaining batches divided by their count
+ * squared is searched over the first half. A warm-up reaching into the
+ * second half means the metric is still drifting. The truncated series is
+ * then cut into a fixed number of batches whose means give a Student t
+ * confidence interval. When the half width of that interval is within the
+ * relative precision for every metric, Simulator::Stop is called. A metric
+ * whose mean is 0 has no relative precision: a counter that has not moved
+ * yet, e.g. traffic that starts later, would otherwise pass at once. Such a
+ * metric only converges within an absolute tolerance, if one is given.
+ */
+class SteadyStateMonitor
+{
+public:
+  SteadyStateMonitor ()
+    : m_precision (0),
+      m_batches (10),
+      m_minTime (Seconds (0)),
+      m_tolerance (0),
+      m_steady (false),
+      m_stopTime (Seconds (0))
+  {
+  }
+
+  /**
+   * \brief Configure the stopping rule
+   * \param precision CI half width relative to the mean, 0 disables stopping
+   * \param batches number of batch means of the confidence interval
+   * \param minTime no stop before this simulation time
+   * \param tolerance CI half width that is precise enough whatever the mean,
+   *        0 for none; lets a metric that settles at 0 converge
+   */
+  void Configure (double precision, uint32_t batches = 10, Time minTime = Seconds (0),
+                  double tolerance = 0)
+  {
+    NS_ABORT_MSG_IF (batches < 2, "SteadyStateMonitor needs at least two batches");
+    NS_ABORT_MSG_IF (tolerance < 0, "SteadyStateMonitor tolerance must not be negative");
+    m_precision = precision;
+    m_batches = batches;
+    m_minTime = minTime;
+    m_tolerance = tolerance;
+  }
+
+  /// \return the index to pass to Record
+  uint32_t AddMetric (std::string name)
+  {
+    Metric metric;
+    metric.name = name;
+    metric.lastTotal = 0;
+    metric.truncated = 0;
+    metric.mean = 0;
+    metric.halfWidth = 0;
+    metric.estimated = false;
+    m_metrics.push_back (metric);
+    return m_metrics.size () - 1;
+  }
+
+  /// \brief Record the value a metric had over the last interval
+  void Record (uint32_t metric, double value)
+  {
+    NS_ASSERT (metric < m_metrics.size ());
+    m_metrics[metric].samples.push_back (value);
+    if (metric == 0)
+      {
+        m_times.push_back (Simulator::Now ());
+      }
+    Check ();
+  }
+
+  /// \brief Record a cumulative counter, the increment since the last call is the observation
+  void RecordCumulative (uint32_t metric, double total)
+  {
+    NS_ASSERT (metric < m_metrics.size ());
+    double value = total - m_metrics[metric].lastTotal;
+    m_metrics[metric].lastTotal = total;
+    Record (metric, value);
+  }
+
+  bool IsSteady () const
+  {
+    return m_steady;
+  }
+
+  /// \return the simulation time at which the monitor stopped the run
+  Time GetStopTime () const
+  {
+    return m_stopTime;
+  }
+
+  /// \brief Print warm-up, mean and CI of every metric
+  void Report (std::ostream &os) const
+  {
+    os << "Steady state: " << (m_steady ? "reached" : "not reached");
+    if (m_steady)
+      {
+        os << ", stopped at " << m_stopTime.As (Time::S);
+      }
+    os << std::endl;
+    for (const Metric &metric : m_metrics)
+      {
+        os << "  " << metric.name << ": " << metric.samples.size () << " samples";
+        if (metric.estimated)
+          {
+            os << ", warm-up " << metric.truncated << " samples";
+            if (metric.truncated < m_times.size ())
+              {
+                os << " (until " << m_times[metric.truncated].As (Time::S) << ")";
+              }
+            os << ", mean " << metric.mean << " +- " << metric.halfWidth;
+          }
+        os << std::endl;
+      }
+  }
+
+private:
+  /// MSER batch size
+  static const uint32_t MSER_BATCH = 5;
+
+  struct Metric
+  {
+    std::string name;
+    std::vector<double> samples;
+    double lastTotal;
+    uint32_t truncated; ///< warm-up samples of the last estimate
+    double mean;        ///< mean after the warm-up
+    double halfWidth;   ///< 95% CI half width
+    bool estimated;     ///< mean and halfWidth are set
+  };
+
+  /// 0.975 quantile of the Student t distribution
+  static double TQuantile (uint32_t df)
+  {
+    static const double table[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                     2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                     2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    return df >= 1 && df <= 30 ? table[df - 1] : 1.960;
+  }
+
+  /// \return true if the metric has passed its warm-up and its CI is tight enough
+  bool Converged (Metric &metric) const
+  {
+    uint32_t m = metric.samples.size () / MSER_BATCH;
+    if (m < 2 * m_batches)
+      {
+        return false;
+      }
+    std::vector<double> z (m);
+    for (uint32_t i = 0; i < m; ++i)
+      {
+        double sum = 0;
+        for (uint32_t j = 0; j < MSER_BATCH; ++j)
+          {
+            sum += metric.samples[i * MSER_BATCH + j];
+          }
+        z[i] = sum / MSER_BATCH;
+      }
+
+    // MSER over suffix sums, d in [0, m/2]
+    std::vector<double> sum (m + 1, 0), sumSq (m + 1, 0);
+    for (uint32_t i = m; i-- > 0; )
+      {
+        sum[i] = sum[i + 1] + z[i];
+        sumSq[i] = sumSq[i + 1] + z[i] * z[i];
+      }
+    uint32_t best = 0;
+    double bestMser = 0;
+    for (uint32_t d = 0; d <= m / 2; ++d)
+      {
+        double n = m - d;
+        double ss = sumSq[d] - sum[d] * sum[d] / n;
+        double mser = ss / (n * n);
+        if (d == 0 || mser < bestMser)
+          {
+            best = d;
+            bestMser = mser;
+          }
+      }
+    metric.truncated = best * MSER_BATCH;
+    if (best == m / 2 || m - best < m_batches)
+      {
+        return false;
+      }
+
+    // batch means of the truncated series, leftovers are taken from its start
+    uint32_t size = (m - best) / m_batches;
+    uint32_t first = m - size * m_batches;
+    double total = 0, totalSq = 0;
+    for (uint32_t k = 0; k < m_batches; ++k)
+      {
+        double y = 0;
+        for (uint32_t i = 0; i < size; ++i)
+          {
+            y += z[first + k * size + i];
+          }
+        y /= size;
+        total += y;
+        totalSq += y * y;
+      }
+    metric.mean = total / m_batches;
+    double variance = std::max (0.0, (totalSq - total * total / m_batches) / (m_batches - 1));
+    metric.halfWidth = TQuantile (m_batches - 1) * std::sqrt (variance / m_batches);
+    metric.estimated = true;
+    if (m_tolerance > 0 && metric.halfWidth <= m_tolerance)
+      {
+        return true;
+      }
+    return metric.mean != 0 && metric.halfWidth <= m_precision * std::fabs (metric.mean);
+  }
+
+  void Check ()
+  {
+    if (m_steady || m_precision <= 0 || m_metrics.empty () || Simulator::Now () < m_minTime)
+      {
+        return;
+      }
+    for (const Metric &metric : m_metrics)
+      {
+        if (metric.samples.size () != m_times.size ())
+          {
+            return; // wait for the rest of this interval
+          }
+      }
+    bool steady = true;
+    for (Metric &metric : m_metrics)
+      {
+        steady = Converged (metric) && steady;
+      }
+    if (steady)
+      {
+        m_steady = true;
+        m_stopTime = Simulator::Now ();
+        Simulator::Stop ();
+      }
+  }
+
+  double m_precision;
+  uint32_t m_batches;
+  Time m_minTime;
+  double m_tolerance; ///< absolute CI half width, 0 for none
+  std::vector<Metric> m_metrics;
+  std::vector<Time> m_times; ///< time of each set of observations
+  bool m_steady;
+  Time m_stopTime;
+};
+
+} // namespace ns3
+
+#endif /* STEADY_STATE_MONITOR_H */
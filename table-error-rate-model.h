@@ -0,0 +1,261 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef TABLE_ERROR_RATE_MODEL_H
+#define TABLE_ERROR_RATE_MODEL_H
+
+#include "ns3/double.h"
+#include "ns3/error-rate-model.h"
+#include "ns3/log.h"
+#include "ns3/object-factory.h"
+#include "ns3/string.h"
+#include "ns3/wifi-mode.h"
+#include "ns3/wifi-tx-vector.h"
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Error rate model answering from precomputed SNR tables
+ *
+ * The Yans, NIST and DSSS models all compute the chunk success rate as
+ * (1 - pe)^nbits, where the bit error probability pe is a closed-form
+ * function of the SNR and the mode. This model tabulates ln (1 - pe) once
+ * per mode of the reference model, over a grid of SNR values in dB, and
+ * answers exp (nbits * ln (1 - pe)) with ln (1 - pe) itself linearly
+ * interpolated in dB between grid points, and taken from the first or last
+ * point outside the grid. Since the frame size only enters through the
+ * exponent, one table per mode and channel width serves every frame size.
+ *
+ * Tables are kept in CacheFile between runs, keyed by reference model, mode
+ * name and channel width, and rewritten atomically when a run adds a table,
+ * so forked workers may share the file.
+ */
+class TableErrorRateModel : public ErrorRateModel
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::TableErrorRateModel")
+      .SetParent<ErrorRateModel> ()
+      .AddConstructor<TableErrorRateModel> ()
+      .AddAttribute ("Reference",
+                     "The error rate model the tables are computed from",
+                     StringValue ("ns3::YansErrorRateModel"),
+                     MakeStringAccessor (&TableErrorRateModel::m_referenceType),
+                     MakeStringChecker ())
+      .AddAttribute ("CacheFile",
+                     "The file the tables are kept in between runs, empty for no cache",
+                     StringValue ("error-rate-tables.cache"),
+                     MakeStringAccessor (&TableErrorRateModel::m_cacheFile),
+                     MakeStringChecker ())
+      .AddAttribute ("MinSnr",
+                     "The lowest SNR of the tables (dB)",
+                     DoubleValue (-10.0),
+                     MakeDoubleAccessor (&TableErrorRateModel::m_minSnrDb),
+                     MakeDoubleChecker<double> ())
+      .AddAttribute ("MaxSnr",
+                     "The highest SNR of the tables (dB)",
+                     DoubleValue (50.0),
+                     MakeDoubleAccessor (&TableErrorRateModel::m_maxSnrDb),
+                     MakeDoubleChecker<double> ())
+      .AddAttribute ("Step",
+                     "The SNR step of the tables (dB)",
+                     DoubleValue (0.05),
+                     MakeDoubleAccessor (&TableErrorRateModel::m_stepDb),
+                     MakeDoubleChecker<double> (0.001))
+    ;
+    return tid;
+  }
+
+  TableErrorRateModel ()
+    : m_loaded (false)
+  {
+  }
+
+private:
+  /// ln (1 - pe) over the SNR grid of one mode
+  typedef std::vector<double> Table;
+
+  /// bits of the reference query, large enough to resolve small error probabilities
+  static const uint32_t REFERENCE_BITS = 1024;
+
+  double DoGetChunkSuccessRate (WifiMode mode, const WifiTxVector& txVector, double snr, uint64_t nbits,
+                                uint8_t /* numRxAntennas */, WifiPpduField /* field */,
+                                uint16_t /* staId */) const override
+  {
+    const Table &table = GetTable (mode, txVector);
+    double snrDb = snr > 0 ? 10.0 * std::log10 (snr) : m_minSnrDb;
+    double position = (snrDb - m_minSnrDb) / m_stepDb;
+    double lnSuccess;
+    if (position <= 0)
+      {
+        lnSuccess = table.front ();
+      }
+    else if (position >= table.size () - 1)
+      {
+        lnSuccess = table.back ();
+      }
+    else
+      {
+        uint32_t i = static_cast<uint32_t> (position);
+        double fraction = position - i;
+        lnSuccess = table[i] + fraction * (table[i + 1] - table[i]);
+      }
+    return std::exp (lnSuccess * nbits);
+  }
+
+  const Table &GetTable (WifiMode mode, const WifiTxVector &txVector) const
+  {
+    // the same mode has a different error rate at every channel width
+    uint16_t width = txVector.GetChannelWidth ();
+    uint64_t id = (static_cast<uint64_t> (mode.GetUid ()) << 16) | width;
+    std::unordered_map<uint64_t, Table>::const_iterator it = m_tables.find (id);
+    if (it != m_tables.end ())
+      {
+        return it->second;
+      }
+    if (!m_loaded)
+      {
+        Load ();
+      }
+    std::ostringstream key;
+    key << m_referenceType << " " << mode.GetUniqueName () << "@" << width;
+    std::map<std::string, Table>::const_iterator cached = m_cached.find (key.str ());
+    if (cached != m_cached.end () && cached->second.size () == GetTableSize ())
+      {
+        return m_tables[id] = cached->second;
+      }
+    Table table = Compute (mode, txVector);
+    m_cached[key.str ()] = table;
+    Save ();
+    return m_tables[id] = table;
+  }
+
+  Table Compute (WifiMode mode, const WifiTxVector &txVector) const
+  {
+    if (!m_reference)
+      {
+        ObjectFactory factory;
+        factory.SetTypeId (m_referenceType);
+        m_reference = factory.Create<ErrorRateModel> ();
+      }
+    Table table (GetTableSize ());
+    for (uint32_t i = 0; i < table.size (); ++i)
+      {
+        double snr = std::pow (10.0, (m_minSnrDb + i * m_stepDb) / 10.0);
+        double success = m_reference->GetChunkSuccessRate (mode, txVector, snr, REFERENCE_BITS);
+        if (success > 0)
+          {
+            table[i] = std::log (success) / REFERENCE_BITS;
+          }
+        else
+          {
+            // too many errors for the reference query, fall back to one bit
+            success = m_reference->GetChunkSuccessRate (mode, txVector, snr, 1);
+            table[i] = success > 0 ? std::log (success) : -1e9;
+          }
+      }
+    return table;
+  }
+
+  uint32_t GetTableSize () const
+  {
+    return static_cast<uint32_t> (std::floor ((m_maxSnrDb - m_minSnrDb) / m_stepDb + 0.5)) + 1;
+  }
+
+  /// \return the grid description stored with the tables
+  std::string GetGrid () const
+  {
+    std::ostringstream oss;
+    oss << m_minSnrDb << " " << m_maxSnrDb << " " << m_stepDb;
+    return oss.str ();
+  }
+
+  /// Read the tables of the cache file computed on the same grid
+  void Load () const
+  {
+    m_loaded = true;
+    if (m_cacheFile.empty ())
+      {
+        return;
+      }
+    std::ifstream in (m_cacheFile.c_str ());
+    std::string line;
+    if (!std::getline (in, line) || line != GetGrid ())
+      {
+        return;
+      }
+    // one table per line: reference type, mode name@channel width, values
+    while (std::getline (in, line))
+      {
+        std::istringstream iss (line);
+        std::string reference, modeName;
+        iss >> reference >> modeName;
+        if (modeName.find ('@') == std::string::npos)
+          {
+            // a table of an older cache, computed for one channel width only
+            continue;
+          }
+        Table table;
+        double value;
+        while (iss >> value)
+          {
+            table.push_back (value);
+          }
+        m_cached[reference + " " + modeName] = table;
+      }
+  }
+
+  /// Write all known tables, through a temporary file renamed over the cache
+  void Save () const
+  {
+    if (m_cacheFile.empty ())
+      {
+        return;
+      }
+    std::ostringstream tmp;
+    tmp << m_cacheFile << "." << getpid ();
+    std::ofstream out (tmp.str ().c_str ());
+    out.precision (17);
+    out << GetGrid () << "\n";
+    for (std::map<std::string, Table>::const_iterator it = m_cached.begin (); it != m_cached.end (); ++it)
+      {
+        out << it->first;
+        for (double value : it->second)
+          {
+            out << " " << value;
+          }
+        out << "\n";
+      }
+    out.close ();
+    if (!out || std::rename (tmp.str ().c_str (), m_cacheFile.c_str ()) != 0)
+      {
+        std::remove (tmp.str ().c_str ());
+      }
+  }
+
+  std::string m_referenceType;
+  std::string m_cacheFile;
+  double m_minSnrDb;
+  double m_maxSnrDb;
+  double m_stepDb;
+  mutable Ptr<ErrorRateModel> m_reference;
+  mutable bool m_loaded;
+  mutable std::map<std::string, Table> m_cached;          ///< tables by "reference mode@width" key
+  mutable std::unordered_map<uint64_t, Table> m_tables;   ///< tables in use, by WifiMode uid and channel width
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TableErrorRateModel);
+
+} // namespace ns3
+
+#endif /* TABLE_ERROR_RATE_MODEL_H */
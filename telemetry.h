@@ -0,0 +1,182 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+
+/**
+ * Diagnostics for the per-packet paths of the scratches.
+ *
+ * Unlike NS_LOG, whose arguments are built whenever the code is compiled
+ * with logging, telemetry is compiled only when NS3_SCRATCH_TELEMETRY is
+ * set (the NS3_SCRATCH_TELEMETRY option of the scratch CMakeLists). Without
+ * it TELEMETRY_SAMPLE is the constant false, so the code guarded by it is
+ * dead, and TELEMETRY_EMIT never evaluates its message. With it, a call
+ * site lets through one call in every \p every, and a component never
+ * prints more than its budget of lines per simulated second:
+ *
+ * \code
+ *   if (TELEMETRY_SAMPLE ("Wifi-Adhoc", 100))
+ *     {
+ *       Vector position = GetPosition (node);        // only on sampled packets
+ *       TELEMETRY_EMIT ("Wifi-Adhoc", "at " << position);
+ *     }
+ * \endcode
+ *
+ * The component and the sampling period of a call site must be constants:
+ * the call site keeps its state in a static.
+ */
+#ifndef NS3_SCRATCH_TELEMETRY
+#define NS3_SCRATCH_TELEMETRY 0
+#endif
+
+#if NS3_SCRATCH_TELEMETRY
+#define TELEMETRY_SAMPLE(component, every)                                                    \
+  ([] () -> ns3::TelemetryPoint & {                                                        \
+    static ns3::TelemetryPoint telemetryPoint (component, every);                          \
+    return telemetryPoint;                                                                 \
+  }().Sample ())
+#define TELEMETRY_EMIT(component, msg)                                                        \
+  do                                                                                       \
+    {                                                                                      \
+      std::clog << "+" << ns3::Simulator::Now ().As (ns3::Time::S) << " " << component     \
+                << ": " << msg << std::endl;                                               \
+    }                                                                                      \
+  while (false)
+#else
+#define TELEMETRY_SAMPLE(component, every) false
+// dead code, kept so that the arguments still type check and count as used
+#define TELEMETRY_EMIT(component, msg)                                                        \
+  do                                                                                       \
+    {                                                                                      \
+      if (false)                                                                           \
+        {                                                                                  \
+          std::clog << component << ": " << msg << std::endl;                              \
+        }                                                                                  \
+    }                                                                                      \
+  while (false)
+#endif
+
+/// \brief Sampled one-line telemetry: TELEMETRY_EMIT guarded by TELEMETRY_SAMPLE
+#define TELEMETRY(component, every, msg)                                                      \
+  do                                                                                       \
+    {                                                                                      \
+      if (TELEMETRY_SAMPLE (component, every))                                             \
+        {                                                                                  \
+          TELEMETRY_EMIT (component, msg);                                                 \
+        }                                                                                  \
+    }                                                                                      \
+  while (false)
+
+namespace ns3 {
+
+/**
+ * \brief Lines per simulated second allowed to the components
+ *
+ * Budgets can be set whether or not telemetry is compiled, so that the
+ * scratches configure them unconditionally.
+ */
+class Telemetry
+{
+public:
+  struct Budget
+  {
+    uint32_t perSecond; ///< 0 for no limit
+    uint32_t used;      ///< lines of the current second
+    int64_t second;     ///< the current second
+    uint64_t dropped;   ///< lines over budget, in total
+
+    /// \return whether one more line fits in the budget
+    bool Take (void)
+    {
+      int64_t now = Simulator::Now ().GetSeconds ();
+      if (now != second)
+        {
+          second = now;
+          used = 0;
+        }
+      if (perSecond != 0 && used >= perSecond)
+        {
+          ++dropped;
+          return false;
+        }
+      ++used;
+      return true;
+    }
+  };
+
+  /// \param perSecond lines per simulated second, 0 for no limit
+  static void SetBudget (std::string component, uint32_t perSecond)
+  {
+    GetBudget (component)->perSecond = perSecond;
+  }
+
+  /// \return the budget of a component, unlimited until set; the pointer stays valid
+  static Budget *GetBudget (const std::string &component)
+  {
+    std::map<std::string, Budget> &budgets = Budgets ();
+    std::map<std::string, Budget>::iterator it = budgets.find (component);
+    if (it == budgets.end ())
+      {
+        Budget budget = {0, 0, -1, 0};
+        it = budgets.insert (std::make_pair (component, budget)).first;
+      }
+    return &it->second;
+  }
+
+  /// \return the lines of a component dropped for being over budget
+  static uint64_t GetDropped (const std::string &component)
+  {
+    return GetBudget (component)->dropped;
+  }
+
+private:
+  static std::map<std::string, Budget> &Budgets (void)
+  {
+    static std::map<std::string, Budget> budgets;
+    return budgets;
+  }
+};
+
+/**
+ * \brief State of one TELEMETRY_SAMPLE call site
+ *
+ * The component budget is looked up once, when the call site is first
+ * reached, so a sample costs a counter increment and, one call in every
+ * m_every, a budget check.
+ */
+class TelemetryPoint
+{
+public:
+  TelemetryPoint (const char *component, uint32_t every)
+    : m_every (std::max<uint32_t> (every, 1)),
+      m_count (0),
+      m_budget (Telemetry::GetBudget (component))
+  {
+  }
+
+  /// \return whether this call is sampled and fits in the budget
+  bool Sample (void)
+  {
+    if (m_count++ % m_every != 0)
+      {
+        return false;
+      }
+    return m_budget->Take ();
+  }
+
+private:
+  uint32_t m_every;
+  uint64_t m_count;
+  Telemetry::Budget *m_budget;
+};
+
+} // namespace ns3
+
+#endif /* TELEMETRY_H */
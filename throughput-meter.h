@@ -0,0 +1,257 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef THROUGHPUT_METER_H
+#define THROUGHPUT_METER_H
+
+#include "ns3/abort.h"
+#include "ns3/address.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Per-receiver throughput sampled on its own timer
+ *
+ * Every receiver counts its bytes, in total and per source address, and
+ * the meter samples all receivers at once every interval. The bytes of the
+ * last window intervals are kept in a ring buffer per receiver, so a sample
+ * is the throughput over a sliding window whatever the order of the other
+ * events of the same instant. The buffers and the sample vectors are sized
+ * when the meter starts; the only allocation while the simulation runs is
+ * the first packet of a new flow. A receiver whose x stops moving, e.g. at
+ * the end of a walk, should be stopped, or its curve ends in samples that
+ * all share the last x.
+ */
+class ThroughputMeter
+{
+public:
+  /// (x, Mb/s) samples of one receiver
+  typedef std::vector<std::pair<double, double> > Points;
+  /// suffixed curves, the layout of ParallelExperiments::Curves
+  typedef std::vector<std::pair<std::string, Points> > Curves;
+  /// x of a sample, given the receiving node
+  typedef std::function<double (Ptr<Node>)> Abscissa;
+
+  ThroughputMeter ()
+    : m_interval (Seconds (1.0)),
+      m_window (1),
+      m_stop (Seconds (0))
+  {
+  }
+
+  /**
+   * \param interval time between two samples
+   * \param window number of intervals a sample averages over
+   */
+  void Configure (Time interval, uint32_t window)
+  {
+    NS_ABORT_MSG_IF (window == 0, "ThroughputMeter needs a window of at least one interval");
+    m_interval = interval;
+    m_window = window;
+  }
+
+  /// \brief Set the x of the samples, the simulation time in seconds by default
+  void SetAbscissa (Abscissa abscissa)
+  {
+    m_abscissa = abscissa;
+  }
+
+  /// \return the index of the receiver, used by the getters
+  uint32_t AddReceiver (Ptr<Node> node)
+  {
+    uint32_t id = node->GetId ();
+    if (id >= m_index.size ())
+      {
+        m_index.resize (id + 1, NONE);
+      }
+    NS_ABORT_MSG_IF (m_index[id] != NONE, "Node " << id << " is already a receiver");
+    m_index[id] = m_receivers.size ();
+    Receiver receiver;
+    receiver.node = node;
+    receiver.total = 0;
+    receiver.current = 0;
+    receiver.sum = 0;
+    receiver.head = 0;
+    receiver.filled = 0;
+    receiver.stopped = false;
+    m_receivers.push_back (receiver);
+    return m_receivers.size () - 1;
+  }
+
+  /// \brief Count bytes received by a node from a source
+  void Receive (Ptr<Node> node, const Address &from, uint32_t bytes)
+  {
+    uint32_t id = node->GetId ();
+    if (id >= m_index.size () || m_index[id] == NONE)
+      {
+        return;
+      }
+    Receiver &receiver = m_receivers[m_index[id]];
+    receiver.total += bytes;
+    receiver.current += bytes;
+    for (Flow &flow : receiver.flows)
+      {
+        if (flow.source == from)
+          {
+            flow.bytes += bytes;
+            return;
+          }
+      }
+    Flow flow;
+    flow.source = from;
+    flow.bytes = bytes;
+    receiver.flows.push_back (flow);
+  }
+
+  /// \brief Sample every interval after start, up to stop included, counting the bytes from start on
+  void Start (Time start, Time stop)
+  {
+    m_stop = stop;
+    uint32_t samples = stop > start ? (stop - start).GetDouble () / m_interval.GetDouble () + 1 : 0;
+    for (Receiver &receiver : m_receivers)
+      {
+        receiver.ring.assign (m_window, 0);
+        receiver.points.reserve (samples);
+        receiver.flows.reserve (m_receivers.size ());
+      }
+    Simulator::Schedule (start - Simulator::Now (), &ThroughputMeter::Restart, this);
+    Simulator::Schedule (start - Simulator::Now () + m_interval, &ThroughputMeter::Sample, this);
+  }
+
+  /**
+   * \brief Take no more samples of the receiver on a node, if it is one
+   *
+   * Sampling ends at the stop time given to Start, or once every receiver
+   * is stopped. The bytes received are still counted.
+   */
+  void Stop (Ptr<Node> node)
+  {
+    uint32_t id = node->GetId ();
+    if (id < m_index.size () && m_index[id] != NONE)
+      {
+        m_receivers[m_index[id]].stopped = true;
+      }
+  }
+
+  uint32_t GetNReceivers () const
+  {
+    return m_receivers.size ();
+  }
+
+  /// \return the id of the node of a receiver
+  uint32_t GetNodeId (uint32_t receiver) const
+  {
+    return m_receivers[receiver].node->GetId ();
+  }
+
+  const Points &GetPoints (uint32_t receiver) const
+  {
+    return m_receivers[receiver].points;
+  }
+
+  uint64_t GetBytes (uint32_t receiver) const
+  {
+    return m_receivers[receiver].total;
+  }
+
+  /// \return one curve per receiver suffixed with its node, no suffix for a single receiver
+  Curves GetCurves () const
+  {
+    Curves curves;
+    for (const Receiver &receiver : m_receivers)
+      {
+        std::string suffix = m_receivers.size () > 1 ? " node " + std::to_string (receiver.node->GetId ()) : "";
+        curves.push_back (std::make_pair (suffix, receiver.points));
+      }
+    return curves;
+  }
+
+  /// \brief Print the bytes of every flow of every receiver
+  void Report (std::ostream &os) const
+  {
+    for (const Receiver &receiver : m_receivers)
+      {
+        os << "node " << receiver.node->GetId () << ": " << receiver.total << " bytes" << std::endl;
+        for (const Flow &flow : receiver.flows)
+          {
+            os << "  from " << flow.source << ": " << flow.bytes << " bytes" << std::endl;
+          }
+      }
+  }
+
+private:
+  static constexpr uint32_t NONE = 0xffffffff;
+
+  struct Flow
+  {
+    Address source;
+    uint64_t bytes;
+  };
+
+  struct Receiver
+  {
+    Ptr<Node> node;
+    uint64_t total;
+    uint64_t current;           ///< bytes of the running interval
+    std::vector<uint64_t> ring; ///< bytes of the last window intervals
+    uint64_t sum;               ///< sum of ring
+    uint32_t head;              ///< oldest slot of ring
+    uint32_t filled;            ///< slots of ring in use
+    bool stopped;               ///< no more samples, see Stop
+    std::vector<Flow> flows;
+    Points points;
+  };
+
+  /// \brief Forget the bytes received before the first interval
+  void Restart (void)
+  {
+    for (Receiver &receiver : m_receivers)
+      {
+        receiver.current = 0;
+      }
+  }
+
+  void Sample (void)
+  {
+    bool running = false;
+    for (Receiver &receiver : m_receivers)
+      {
+        if (receiver.stopped)
+          {
+            continue;
+          }
+        running = true;
+        receiver.sum += receiver.current - receiver.ring[receiver.head];
+        receiver.ring[receiver.head] = receiver.current;
+        receiver.head = (receiver.head + 1) % m_window;
+        receiver.filled = std::min (receiver.filled + 1, m_window);
+        receiver.current = 0;
+        double mbs = receiver.sum * 8.0 / (receiver.filled * m_interval.GetSeconds ()) / 1000000;
+        double x = m_abscissa ? m_abscissa (receiver.node) : Simulator::Now ().GetSeconds ();
+        receiver.points.push_back (std::make_pair (x, mbs));
+      }
+    if (running && Simulator::Now () + m_interval <= m_stop)
+      {
+        Simulator::Schedule (m_interval, &ThroughputMeter::Sample, this);
+      }
+  }
+
+  Time m_interval;
+  uint32_t m_window;
+  Time m_stop;
+  Abscissa m_abscissa;
+  std::vector<uint32_t> m_index; ///< receiver index by node id
+  std::vector<Receiver> m_receivers;
+};
+
+} // namespace ns3
+
+#endif /* THROUGHPUT_METER_H */
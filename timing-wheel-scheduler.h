@@ -0,0 +1,315 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+#ifndef TIMING_WHEEL_SCHEDULER_H
+#define TIMING_WHEEL_SCHEDULER_H
+
+#include "ns3/abort.h"
+#include "ns3/assert.h"
+#include "ns3/nstime.h"
+#include "ns3/scheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief A two-level timing wheel for periodic, near-future events
+ *
+ * Time is cut into slots of Granularity. The first wheel has one slot per
+ * granule of the current block of SLOTS granules, the second wheel one
+ * slot per block of the next SLOTS - 1 blocks; events further away wait
+ * in a binary heap. Inserting into a wheel is a push_back, and the wheels
+ * keep a bitmap of their non-empty slots, so that finding the next event
+ * only looks at a few words. The slot the simulation is in is kept as a
+ * small binary heap, which is what orders events at the granule level.
+ * When the simulation leaves a block, the slot of the next block is
+ * spread over the first wheel and the heap events that came in range
+ * move to the wheels.
+ *
+ * With the default 100us granularity the first wheel covers 25.6 ms (MAC
+ * and PHY timers) and the second 6.55 s (100 ms beacons, 1 s timers).
+ *
+ * Select it with --SchedulerType=ns3::TimingWheelScheduler on the command line
+ * of a scratch, or with NS3_SCRATCH_SCHEDULER=ns3::TimingWheelScheduler in one that
+ * calls SimulatorCost::Enable. NS_GLOBAL_VALUE cannot name it: libcore
+ * reads that before the scratch registers this TypeId.
+ */
+class TimingWheelScheduler : public Scheduler
+{
+public:
+  /// slots of each wheel
+  static constexpr uint32_t SLOTS = 256;
+
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::TimingWheelScheduler")
+      .SetParent<Scheduler> ()
+      .AddConstructor<TimingWheelScheduler> ()
+      .AddAttribute ("Granularity",
+                     "The time covered by one slot of the first wheel",
+                     TimeValue (MicroSeconds (100)),
+                     MakeTimeAccessor (&TimingWheelScheduler::m_granularityTime),
+                     MakeTimeChecker ())
+    ;
+    return tid;
+  }
+
+  TimingWheelScheduler ()
+    : m_granularity (1),
+      m_block (0),
+      m_slot (0),
+      m_size (0)
+  {
+    std::fill (m_bits0, m_bits0 + WORDS, 0);
+    std::fill (m_bits1, m_bits1 + WORDS, 0);
+  }
+
+  void Insert (const Event &ev) override
+  {
+    ++m_size;
+    Place (ev);
+  }
+
+  bool IsEmpty (void) const override
+  {
+    return m_size == 0;
+  }
+
+  Event PeekNext (void) const override
+  {
+    // advancing only moves events between the internal containers
+    const_cast<TimingWheelScheduler *> (this)->Advance ();
+    return m_current.front ();
+  }
+
+  Event RemoveNext (void) override
+  {
+    Advance ();
+    std::pop_heap (m_current.begin (), m_current.end (), &TimingWheelScheduler::Later);
+    Event ev = m_current.back ();
+    m_current.pop_back ();
+    --m_size;
+    return ev;
+  }
+
+  void Remove (const Event &ev) override
+  {
+    uint64_t granule = ev.key.m_ts / m_granularity;
+    uint64_t block = granule / SLOTS;
+    bool removed;
+    // the same tests as Place: PeekNext may have moved the current slot past
+    // the granule of an event inserted since, which then went to m_current
+    if (granule <= m_block * SLOTS + m_slot)
+      {
+        removed = EraseFromHeap (m_current, ev);
+      }
+    else if (block == m_block)
+      {
+        removed = EraseFromSlot (m_wheel0[granule % SLOTS], m_bits0, granule % SLOTS, ev);
+      }
+    else if (block < m_block + SLOTS)
+      {
+        removed = EraseFromSlot (m_wheel1[block % SLOTS], m_bits1, block % SLOTS, ev);
+      }
+    else
+      {
+        removed = EraseFromHeap (m_far, ev);
+      }
+    NS_ABORT_MSG_IF (!removed, "TimingWheelScheduler cannot find the event to remove");
+    --m_size;
+  }
+
+protected:
+  void NotifyConstructionCompleted (void) override
+  {
+    NS_ABORT_MSG_IF (m_granularityTime.GetTimeStep () <= 0, "TimingWheelScheduler needs a positive Granularity");
+    m_granularity = m_granularityTime.GetTimeStep ();
+    Scheduler::NotifyConstructionCompleted ();
+  }
+
+private:
+  static constexpr uint32_t WORDS = SLOTS / 64;
+
+  /// \brief Heap order: the earliest event, by time then uid, at the front
+  static bool Later (const Event &a, const Event &b)
+  {
+    return a.key.m_ts > b.key.m_ts || (a.key.m_ts == b.key.m_ts && a.key.m_uid > b.key.m_uid);
+  }
+
+  /// \brief Put an event where it belongs relative to the current slot
+  void Place (const Event &ev)
+  {
+    uint64_t granule = ev.key.m_ts / m_granularity;
+    uint64_t block = granule / SLOTS;
+    if (granule <= m_block * SLOTS + m_slot)
+      {
+        m_current.push_back (ev);
+        std::push_heap (m_current.begin (), m_current.end (), &TimingWheelScheduler::Later);
+      }
+    else if (block == m_block)
+      {
+        m_wheel0[granule % SLOTS].push_back (ev);
+        SetBit (m_bits0, granule % SLOTS);
+      }
+    else if (block < m_block + SLOTS)
+      {
+        m_wheel1[block % SLOTS].push_back (ev);
+        SetBit (m_bits1, block % SLOTS);
+      }
+    else
+      {
+        m_far.push_back (ev);
+        std::push_heap (m_far.begin (), m_far.end (), &TimingWheelScheduler::Later);
+      }
+  }
+
+  /// \brief Make the current slot the first non-empty one
+  void Advance (void)
+  {
+    NS_ABORT_MSG_IF (m_size == 0, "TimingWheelScheduler is empty");
+    while (m_current.empty ())
+      {
+        int32_t slot = m_slot + 1 < SLOTS ? FindBit (m_bits0, m_slot + 1) : -1;
+        if (slot >= 0)
+          {
+            m_slot = slot;
+            m_current.swap (m_wheel0[slot]);
+            ClearBit (m_bits0, slot);
+            std::make_heap (m_current.begin (), m_current.end (), &TimingWheelScheduler::Later);
+            continue;
+          }
+        NextBlock ();
+      }
+  }
+
+  /// \brief Move to the next block holding events and spread it over the first wheel
+  void NextBlock (void)
+  {
+    uint64_t next = UINT64_MAX;
+    for (uint32_t i = 1; i < SLOTS; ++i)
+      {
+        uint32_t slot = (m_block + i) % SLOTS;
+        if (m_bits1[slot / 64] == 0)
+          {
+            // skip to the next word
+            i += 63 - slot % 64;
+            continue;
+          }
+        if (TestBit (m_bits1, slot))
+          {
+            next = m_block + i;
+            break;
+          }
+      }
+    if (!m_far.empty ())
+      {
+        next = std::min (next, m_far.front ().key.m_ts / m_granularity / SLOTS);
+      }
+    NS_ASSERT (next != UINT64_MAX);
+
+    m_block = next;
+    m_slot = 0;
+    std::vector<Event> events;
+    events.swap (m_wheel1[next % SLOTS]);
+    ClearBit (m_bits1, next % SLOTS);
+    while (!m_far.empty () && m_far.front ().key.m_ts / m_granularity / SLOTS < m_block + SLOTS)
+      {
+        std::pop_heap (m_far.begin (), m_far.end (), &TimingWheelScheduler::Later);
+        events.push_back (m_far.back ());
+        m_far.pop_back ();
+      }
+    for (const Event &ev : events)
+      {
+        Place (ev);
+      }
+    // give the slot its buffer back for the block SLOTS blocks later
+    events.clear ();
+    m_wheel1[next % SLOTS].swap (events);
+  }
+
+  static bool EraseFromHeap (std::vector<Event> &heap, const Event &ev)
+  {
+    for (uint32_t i = 0; i < heap.size (); ++i)
+      {
+        if (heap[i].key.m_uid == ev.key.m_uid && heap[i].key.m_ts == ev.key.m_ts)
+          {
+            heap[i] = heap.back ();
+            heap.pop_back ();
+            std::make_heap (heap.begin (), heap.end (), &TimingWheelScheduler::Later);
+            return true;
+          }
+      }
+    return false;
+  }
+
+  static bool EraseFromSlot (std::vector<Event> &slot, uint64_t *bits, uint32_t index, const Event &ev)
+  {
+    for (uint32_t i = 0; i < slot.size (); ++i)
+      {
+        if (slot[i].key.m_uid == ev.key.m_uid && slot[i].key.m_ts == ev.key.m_ts)
+          {
+            slot[i] = slot.back ();
+            slot.pop_back ();
+            if (slot.empty ())
+              {
+                ClearBit (bits, index);
+              }
+            return true;
+          }
+      }
+    return false;
+  }
+
+  static void SetBit (uint64_t *bits, uint32_t i)
+  {
+    bits[i / 64] |= uint64_t (1) << (i % 64);
+  }
+
+  static void ClearBit (uint64_t *bits, uint32_t i)
+  {
+    bits[i / 64] &= ~(uint64_t (1) << (i % 64));
+  }
+
+  static bool TestBit (const uint64_t *bits, uint32_t i)
+  {
+    return bits[i / 64] & (uint64_t (1) << (i % 64));
+  }
+
+  /// \return the first set bit at or after from, -1 if none
+  static int32_t FindBit (const uint64_t *bits, uint32_t from)
+  {
+    uint32_t word = from / 64;
+    uint64_t masked = bits[word] & (~uint64_t (0) << (from % 64));
+    while (true)
+      {
+        if (masked != 0)
+          {
+            return word * 64 + __builtin_ctzll (masked);
+          }
+        if (++word == WORDS)
+          {
+            return -1;
+          }
+        masked = bits[word];
+      }
+  }
+
+  Time m_granularityTime;
+  uint64_t m_granularity;                  ///< ticks per slot of the first wheel
+  uint64_t m_block;                        ///< the current block of SLOTS granules
+  uint32_t m_slot;                         ///< the current granule of the block
+  uint64_t m_size;
+  std::vector<Event> m_current;            ///< heap of the events of the current granule
+  std::vector<Event> m_wheel0[SLOTS];      ///< granules of the current block
+  std::vector<Event> m_wheel1[SLOTS];      ///< the next SLOTS - 1 blocks
+  std::vector<Event> m_far;                ///< heap of the events past the second wheel
+  uint64_t m_bits0[WORDS];                 ///< non-empty slots of m_wheel0
+  uint64_t m_bits1[WORDS];                 ///< non-empty slots of m_wheel1
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TimingWheelScheduler);
+
+} // namespace ns3
+
+#endif /* TIMING_WHEEL_SCHEDULER_H */
@@ -20,308 +20,184 @@
 
 #include "ns3/gnuplot.h"
 #include "ns3/command-line.h"
-#include "ns3/config.h"
-#include "ns3/uinteger.h"
 #include "ns3/string.h"
 #include "ns3/log.h"
 #include "ns3/yans-wifi-helper.h"
-#include "ns3/mobility-helper.h"
-#include "ns3/ipv4-address-helper.h"
-#include "ns3/on-off-helper.h"
-#include "ns3/yans-wifi-channel.h"
-#include "ns3/mobility-model.h"
-#include "ns3/packet-socket-helper.h"
-#include "ns3/packet-socket-address.h"
-#include "ns3/netanim-module.h"
+#include "experiment-harness.h"
+#include "table-error-rate-model.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("Wifi-Adhoc");
 
-/**
- * WiFi adhoc experiment class.
- * 
- * It handles the creation and run of an experiment.
- */
-class Experiment
+/// How each configuration is measured, see the --sweep option.
+struct SweepOptions
 {
-public:
-  Experiment ();
-  /**
-   * Constructor.
-   * \param name The name of the experiment.
-   */
-  Experiment (std::string name);
-
-  /**
-   * Run an experiment.
-   * \param wifi      //!< The WifiHelper class.
-   * \param wifiPhy   //!< The YansWifiPhyHelper class.
-   * \param wifiMac   //!< The WifiMacHelper class.
-   * \param wifiChannel //!< The YansWifiChannelHelper class.
-   * \return a 2D dataset of the experiment data. 
-   */
-  Gnuplot2dDataset Run (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
-                        const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel);
-private:
-  /**
-   * Receive a packet.
-   * \param socket The recieving socket.
-   */
-  void ReceivePacket (Ptr<Socket> socket);
-  /**
-   * Set the position of a node.
-   * \param node The node.
-   * \param position The position of the node.
-   */
-  void SetPosition (Ptr<Node> node, Vector position);
-  /**
-   * Get the position of a node.
-   * \param node The node.
-   * \return the position of the node.
-   */
-  Vector GetPosition (Ptr<Node> node);
-  /**
-   * Move a node by 1m on the x axis, stops at 210m.
-   * \param node The node.
-   */
-  void AdvancePosition (Ptr<Node> node);
-  /**
-   * Setup the receiving socket.
-   * \param node The receiving node.
-   * \return the socket.
-   */
-  Ptr<Socket> SetupPacketReceive (Ptr<Node> node);
-
-  uint32_t m_bytesTotal;      //!< The number of received bytes.
-  Gnuplot2dDataset m_output;  //!< The output dataset.
+  bool points;   //!< One short simulation per distance instead of the 210 s walk.
+  double step;   //!< The distance between two points (m).
+  Time warmup;   //!< The unmeasured time at the start of each point.
+  Time window;   //!< The measurement window of each point.
 };
 
-Experiment::Experiment ()
-{
-}
-
-Experiment::Experiment (std::string name)
-  : m_output (name)
-{
-  m_output.SetStyle (Gnuplot2dDataset::LINES);
-}
-
-void
-Experiment::SetPosition (Ptr<Node> node, Vector position)
-{
-  Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
-  mobility->SetPosition (position);
-}
-
-Vector
-Experiment::GetPosition (Ptr<Node> node)
+/**
+ * Node 0 sends to node 1 at 60 Mb/s, distance metres away.
+ */
+static ExperimentHarness
+MakeHarness (std::string name, double distance, const MobilityPolicy &mobility)
 {
-  Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
-  return mobility->GetPosition ();
+  TrafficPolicy traffic = TrafficPolicy::Pair (0, 1);
+  traffic.SetRate (DataRate (60000000));
+  traffic.SetProtocol (1);
+  ExperimentHarness harness (name, TopologyPolicy::Line (2, distance), traffic, mobility);
+  harness.SetReceivers ({1});
+  return harness;
 }
 
-void
-Experiment::AdvancePosition (Ptr<Node> node)
+/**
+ * Queue the jobs measuring one configuration: the walk, where the receiver
+ * starts 5 m away and steps 1 m away every second from 1.5 s, or one job per
+ * distance from 5 m to 210 m. The points land in the same dataset.
+ */
+static void
+AddSweep (ParallelExperiments &experiments, std::string name, const SweepOptions &sweep,
+          const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
+          const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel)
 {
-  Vector pos = GetPosition (node);
-  double mbs = ((m_bytesTotal * 8.0) / 1000000);
-  m_bytesTotal = 0;
-  m_output.Add (pos.x, mbs);
-  pos.x += 1.0;
-  if (pos.x >= 210.0)
+  if (!sweep.points)
     {
+      experiments.AddCurves (name, [wifi, wifiPhy, wifiMac, wifiChannel] (std::string title) {
+        MobilityPolicy walk = MobilityPolicy::Walk ({1}, 1.0, 210.0);
+        walk.SetTimes (Seconds (1.5), Seconds (1.0));
+        ExperimentHarness harness = MakeHarness (title, 5.0, walk);
+        harness.SetMeter (Seconds (1.0), 1, Seconds (0.5), Seconds (210.0));
+        harness.SetAnimation ("third");
+        return harness.Run (wifi, wifiPhy, wifiMac, wifiChannel);
+      });
       return;
     }
-  SetPosition (node, pos);
-  Simulator::Schedule (Seconds (1.0), &Experiment::AdvancePosition, this, node);
-}
-
-void
-Experiment::ReceivePacket (Ptr<Socket> socket)
-{
-  Ptr<Packet> packet;
-  while ((packet = socket->Recv ()))
+  for (double distance = 5.0; distance < 210.0; distance += sweep.step)
     {
-      m_bytesTotal += packet->GetSize ();
+      experiments.AddCurves (name, [wifi, wifiPhy, wifiMac, wifiChannel, distance, sweep] (std::string title) {
+        ExperimentHarness harness = MakeHarness (title, distance, MobilityPolicy::Static ());
+        // the sender starts at 0.5 s, the rate manager and the MAC settle during the warm-up;
+        // a single sample covers the window
+        Time start = Seconds (0.5) + sweep.warmup;
+        harness.SetMeter (sweep.window, 1, start, start + sweep.window);
+        harness.SetStopTime (start + sweep.window);
+        return harness.Run (wifi, wifiPhy, wifiMac, wifiChannel);
+      });
     }
 }
 
-Ptr<Socket>
-Experiment::SetupPacketReceive (Ptr<Node> node)
-{
-  TypeId tid = TypeId::LookupByName ("ns3::PacketSocketFactory");
-  Ptr<Socket> sink = Socket::CreateSocket (node, tid);
-  sink->Bind ();
-  sink->SetRecvCallback (MakeCallback (&Experiment::ReceivePacket, this));
-  return sink;
-}
-
-Gnuplot2dDataset
-Experiment::Run (const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
-                 const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel)
-{
-  m_bytesTotal = 0;
-
-  NodeContainer c;
-  c.Create (2);
-
-  PacketSocketHelper packetSocket;
-  packetSocket.Install (c);
-
-  YansWifiPhyHelper phy = wifiPhy;
-  phy.SetChannel (wifiChannel.Create ());
-
-  WifiMacHelper mac = wifiMac;
-  NetDeviceContainer devices = wifi.Install (phy, mac, c);
-
-  MobilityHelper mobility;
-  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
-  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
-  positionAlloc->Add (Vector (5.0, 0.0, 0.0));
-  mobility.SetPositionAllocator (positionAlloc);
-  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-
-  mobility.Install (c);
-
-  PacketSocketAddress socket;
-  socket.SetSingleDevice (devices.Get (0)->GetIfIndex ());
-  socket.SetPhysicalAddress (devices.Get (1)->GetAddress ());
-  socket.SetProtocol (1);
-
-  OnOffHelper onoff ("ns3::PacketSocketFactory", Address (socket));
-  onoff.SetConstantRate (DataRate (60000000));
-  onoff.SetAttribute ("PacketSize", UintegerValue (2000));
-
-  ApplicationContainer apps = onoff.Install (c.Get (0));
-  apps.Start (Seconds (0.5));
-  apps.Stop (Seconds (250.0));
-
-  Simulator::Schedule (Seconds (1.5), &Experiment::AdvancePosition, this, c.Get (1));
-  Ptr<Socket> recvSink = SetupPacketReceive (c.Get (1));
-  
-  AnimationInterface anim("third.xml");
-
-  Simulator::Run ();
-
-  Simulator::Destroy ();
-
-  return m_output;
-}
-
 int main (int argc, char *argv[])
 {
   CommandLine cmd (__FILE__);
+  uint32_t jobs = 0;
+  bool tableErrors = false;
+  std::string mode = "walk";
+  SweepOptions sweep;
+  sweep.step = 5.0;
+  sweep.warmup = Seconds (1.0);
+  sweep.window = Seconds (1.0);
+  cmd.AddValue ("jobs", "Experiments run in parallel, 0 for one per core", jobs);
+  cmd.AddValue ("tableErrors", "Look chunk success rates up in precomputed SNR tables", tableErrors);
+  cmd.AddValue ("sweep", "walk: move the receiver 1 m per second; points: one simulation per distance", mode);
+  cmd.AddValue ("step", "Distance between two points of the points sweep (m)", sweep.step);
+  cmd.AddValue ("warmup", "Unmeasured time at the start of each point", sweep.warmup);
+  cmd.AddValue ("window", "Measurement window of each point", sweep.window);
   cmd.Parse (argc, argv);
 
+  if (mode != "walk" && mode != "points")
+    {
+      NS_FATAL_ERROR ("Unknown sweep " << mode);
+    }
+  sweep.points = mode == "points";
+
   Gnuplot gnuplot = Gnuplot ("reference-rates.png");
 
-  Experiment experiment;
   WifiHelper wifi;
   wifi.SetStandard (WIFI_STANDARD_80211a);
   WifiMacHelper wifiMac;
   YansWifiPhyHelper wifiPhy;
+  if (tableErrors)
+    {
+      wifiPhy.SetErrorRateModel ("ns3::TableErrorRateModel");
+    }
   YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
-  Gnuplot2dDataset dataset;
 
   wifiMac.SetType ("ns3::AdhocWifiMac");
+  ParallelExperiments experiments (jobs);
 
   NS_LOG_DEBUG ("54");
-  experiment = Experiment ("54mb");
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode", StringValue ("OfdmRate54Mbps"));
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "54mb", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("48");
-  experiment = Experiment ("48mb");
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode", StringValue ("OfdmRate48Mbps"));
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "48mb", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("36");
-  experiment = Experiment ("36mb");
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode", StringValue ("OfdmRate36Mbps"));
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "36mb", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("24");
-  experiment = Experiment ("24mb");
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode", StringValue ("OfdmRate24Mbps"));
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "24mb", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("18");
-  experiment = Experiment ("18mb");
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode", StringValue ("OfdmRate18Mbps"));
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "18mb", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("12");
-  experiment = Experiment ("12mb");
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode", StringValue ("OfdmRate12Mbps"));
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "12mb", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("9");
-  experiment = Experiment ("9mb");
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode", StringValue ("OfdmRate9Mbps"));
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "9mb", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("6");
-  experiment = Experiment ("6mb");
   wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
                                 "DataMode", StringValue ("OfdmRate6Mbps"));
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "6mb", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
+  experiments.Run (gnuplot);
   gnuplot.GenerateOutput (std::cout);
 
   gnuplot = Gnuplot ("rate-control.png");
 
   NS_LOG_DEBUG ("arf");
-  experiment = Experiment ("arf");
   wifi.SetRemoteStationManager ("ns3::ArfWifiManager");
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "arf", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("aarf");
-  experiment = Experiment ("aarf");
   wifi.SetRemoteStationManager ("ns3::AarfWifiManager");
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "aarf", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("aarf-cd");
-  experiment = Experiment ("aarf-cd");
   wifi.SetRemoteStationManager ("ns3::AarfcdWifiManager");
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "aarf-cd", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("cara");
-  experiment = Experiment ("cara");
   wifi.SetRemoteStationManager ("ns3::CaraWifiManager");
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "cara", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("rraa");
-  experiment = Experiment ("rraa");
   wifi.SetRemoteStationManager ("ns3::RraaWifiManager");
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "rraa", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
   NS_LOG_DEBUG ("ideal");
-  experiment = Experiment ("ideal");
   wifi.SetRemoteStationManager ("ns3::IdealWifiManager");
-  dataset = experiment.Run (wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset (dataset);
+  AddSweep (experiments, "ideal", sweep, wifi, wifiPhy, wifiMac, wifiChannel);
 
+  experiments.Run (gnuplot);
   gnuplot.GenerateOutput (std::cout);
 
   return 0;
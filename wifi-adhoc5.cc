@@ -32,6 +32,8 @@
 #include "ns3/mobility-model.h"
 #include "ns3/packet-socket-helper.h"
 #include "ns3/packet-socket-address.h"
+#include "parallel-experiments.h"
+#include "table-error-rate-model.h"
 
 using namespace ns3;
 
@@ -62,6 +64,8 @@ public:
    */
   Gnuplot2dDataset Run(const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
                        const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel);
+  /// \return the points of the output dataset, as sent back by ParallelExperiments
+  const ParallelExperiments::Points &GetPoints() const { return m_points; }
 
 private:
   /**
@@ -94,7 +98,9 @@ private:
   Ptr<Socket> SetupPacketReceive(Ptr<Node> node);
 
   uint32_t m_bytesTotal;      //!< The number of received bytes.
+  std::string m_name;         //!< The name of the experiment.
   Gnuplot2dDataset m_output;  //!< The output dataset.
+  ParallelExperiments::Points m_points; //!< The points of m_output.
 };
 
 Experiment::Experiment()
@@ -102,7 +108,8 @@ Experiment::Experiment()
 }
 
 Experiment::Experiment(std::string name)
-  : m_output(name)
+  : m_name(name),
+    m_output(name)
 {
   m_output.SetStyle(Gnuplot2dDataset::LINES);
 }
@@ -125,6 +132,7 @@ void Experiment::AdvancePosition(Ptr<Node> node, NodeContainer& nodes) // Add th
   double mbs = ((m_bytesTotal * 8.0) / 1000000);
   m_bytesTotal = 0;
   m_output.Add(pos.x, mbs);
+  m_points.push_back(std::make_pair(pos.x, mbs));
   pos.x += 1.0;
   if (pos.x >= 210.0)
   {
@@ -221,71 +229,81 @@ Gnuplot2dDataset Experiment::Run(const WifiHelper &wifi, const YansWifiPhyHelper
   return m_output;
 }
 
+/**
+ * All five nodes send to node 1 at 60 Mb/s; from 1.5 s nodes 1 to 4 each
+ * step 1 m along x in turn, one a second, and node 1 is metered.
+ */
+static ParallelExperiments::Job
+MakeJob(const WifiHelper &wifi, const YansWifiPhyHelper &wifiPhy,
+        const WifiMacHelper &wifiMac, const YansWifiChannelHelper &wifiChannel)
+{
+  return [wifi, wifiPhy, wifiMac, wifiChannel](std::string name) {
+    Experiment experiment(name);
+    experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
+    return experiment.GetPoints();
+  };
+}
+
 int main(int argc, char *argv[])
 {
   CommandLine cmd(__FILE__);
+  uint32_t jobs = 0;
+  bool tableErrors = false;
+  cmd.AddValue("jobs", "Experiments run in parallel, 0 for one per core", jobs);
+  cmd.AddValue("tableErrors", "Look chunk success rates up in precomputed SNR tables", tableErrors);
   cmd.Parse(argc, argv);
 
   Gnuplot gnuplot = Gnuplot("reference-rates.png");
 
-  Experiment experiment;
   WifiHelper wifi;
   wifi.SetStandard(WIFI_STANDARD_80211a);
   WifiMacHelper wifiMac;
   YansWifiPhyHelper wifiPhy;
+  if (tableErrors)
+  {
+    wifiPhy.SetErrorRateModel("ns3::TableErrorRateModel");
+  }
   YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default();
-  Gnuplot2dDataset dataset;
 
   wifiMac.SetType("ns3::AdhocWifiMac");
+  ParallelExperiments experiments(jobs);
 
   for (uint32_t i = 0; i < 5; ++i)
   {
-    experiment = Experiment("Node" + std::to_string(i + 1) + "-54mb");
     wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager", "DataMode", StringValue("OfdmRate54Mbps"));
-    dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-    gnuplot.AddDataset(dataset);
+    experiments.Add("Node" + std::to_string(i + 1) + "-54mb", MakeJob(wifi, wifiPhy, wifiMac, wifiChannel));
   }
 
+  experiments.Run(gnuplot);
   gnuplot.GenerateOutput(std::cout);
 
   gnuplot = Gnuplot("rate-control.png");
 
   NS_LOG_DEBUG("arf");
-  experiment = Experiment("arf");
   wifi.SetRemoteStationManager("ns3::ArfWifiManager");
-  dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset(dataset);
+  experiments.Add("arf", MakeJob(wifi, wifiPhy, wifiMac, wifiChannel));
 
   NS_LOG_DEBUG("aarf");
-  experiment = Experiment("aarf");
   wifi.SetRemoteStationManager("ns3::AarfWifiManager");
-  dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset(dataset);
+  experiments.Add("aarf", MakeJob(wifi, wifiPhy, wifiMac, wifiChannel));
 
   NS_LOG_DEBUG("aarf-cd");
-  experiment = Experiment("aarf-cd");
   wifi.SetRemoteStationManager("ns3::AarfcdWifiManager");
-  dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset(dataset);
+  experiments.Add("aarf-cd", MakeJob(wifi, wifiPhy, wifiMac, wifiChannel));
 
   NS_LOG_DEBUG("cara");
-  experiment = Experiment("cara");
   wifi.SetRemoteStationManager("ns3::CaraWifiManager");
-  dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset(dataset);
+  experiments.Add("cara", MakeJob(wifi, wifiPhy, wifiMac, wifiChannel));
 
   NS_LOG_DEBUG("rraa");
-  experiment = Experiment("rraa");
   wifi.SetRemoteStationManager("ns3::RraaWifiManager");
-  dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset(dataset);
+  experiments.Add("rraa", MakeJob(wifi, wifiPhy, wifiMac, wifiChannel));
 
   NS_LOG_DEBUG("ideal");
-  experiment = Experiment("ideal");
   wifi.SetRemoteStationManager("ns3::IdealWifiManager");
-  dataset = experiment.Run(wifi, wifiPhy, wifiMac, wifiChannel);
-  gnuplot.AddDataset(dataset);
+  experiments.Add("ideal", MakeJob(wifi, wifiPhy, wifiMac, wifiChannel));
 
+  experiments.Run(gnuplot);
   gnuplot.GenerateOutput(std::cout);
 
   return 0;